@@ -0,0 +1,520 @@
+
+// nftw
+#define _GNU_SOURCE
+
+#include "API.h"
+#include "Compactador.h"
+#include "Config.h"
+#include "Durabilidad.h"
+#include "Estadisticas.h"
+#include "FileSystem.h"
+#include "KeyFilter.h"
+#include "Memtable.h"
+#include "WAL.h"
+#include <AppenderConsole.h>
+#include <Consistency.h>
+#include <ftw.h>
+#include <libcommons/config.h>
+#include <Logger.h>
+#include <Malloc.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Timer.h>
+
+/*
+ * Benchmark del almacenamiento del LFS, sin sockets: corre la API en el mismo proceso contra un punto de
+ * montaje propio. Todas las claves de lfs_bench.conf son opcionales.
+ *
+ * Fases, en orden:
+ *  INSERT:            INSERTS registros repartidos en RONDAS, entre HILOS hilos
+ *  DUMP:              un dump completo de la memtable al final de cada ronda
+ *  SELECT:            SELECTS lecturas con los temporales todavia sin compactar
+ *  COMPACTACION:      una compactacion por tabla
+ *  SELECT_COMPACTADO: SELECTS lecturas despues de compactar
+ *
+ * Las claves salen de una distribucion UNIFORME o ZIPF sobre [0, CLAVES) y los values tienen un largo
+ * uniforme en [VALOR_MIN, VALOR_MAX]. Con la misma SEMILLA la carga generada es la misma.
+ * El resultado se escribe en JSON en ARCHIVO_RESULTADOS, o por stdout si no se especifica.
+ */
+
+t_config_FS confLFS = { 0 };
+
+typedef enum
+{
+    DISTRIBUCION_UNIFORME,
+    DISTRIBUCION_ZIPF
+} Distribucion;
+
+static struct
+{
+    char PuntoMontaje[PATH_MAX];
+    bool MontajeTemporal;
+
+    uint32_t Tablas;
+    uint16_t Particiones;
+    uint32_t Claves;
+
+    Distribucion Distribucion;
+    double ZipfS;
+
+    uint32_t ValorMin;
+    uint32_t ValorMax;
+
+    size_t Inserts;
+    size_t Selects;
+    uint32_t Rondas;
+    uint32_t Hilos;
+    uint64_t Semilla;
+
+    // como vienen en la config, para el reporte
+    char ModoWal[16];
+    char Durabilidad[16];
+
+    char ArchivoResultados[PATH_MAX];
+    char ArchivoEstadisticas[PATH_MAX];
+} confBench;
+
+// zipf: probabilidad acumulada de cada rango, la clave de rango i es i
+static double* acumuladaZipf = NULL;
+
+typedef enum
+{
+    FASE_INSERT,
+    FASE_DUMP,
+    FASE_SELECT,
+    FASE_COMPACTACION,
+    FASE_SELECT_COMPACTADO,
+
+    NUM_FASES
+} Fase;
+
+static char const* const NombresFase[NUM_FASES] =
+{
+    "INSERT",
+    "DUMP",
+    "SELECT",
+    "COMPACTACION",
+    "SELECT_COMPACTADO"
+};
+
+typedef struct
+{
+    // latencia de cada operacion, cada hilo escribe solo en su tramo
+    uint64_t* Latencias;
+    size_t Operaciones;
+    uint64_t DuracionNs;
+
+    // solo SELECT: cuantas claves se encontraron
+    _Atomic size_t Encontradas;
+} t_resultado_fase;
+
+static t_resultado_fase resultados[NUM_FASES];
+
+typedef struct
+{
+    Fase Fase;
+    size_t Desde;
+    size_t Hasta;
+    uint64_t Estado;
+} t_trabajo;
+
+static char* _nombreTabla(uint32_t i, char nombre[NAME_MAX + 1])
+{
+    snprintf(nombre, NAME_MAX + 1, "BENCH%u", i);
+    return nombre;
+}
+
+// xorshift64*, uno por hilo
+static inline uint64_t _aleatorio(uint64_t* estado)
+{
+    uint64_t x = *estado;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *estado = x;
+    return x * UINT64_C(2685821657736338717);
+}
+
+static inline double _aleatorioUnitario(uint64_t* estado)
+{
+    return (_aleatorio(estado) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint16_t _siguienteClave(uint64_t* estado)
+{
+    if (confBench.Distribucion == DISTRIBUCION_UNIFORME)
+        return (uint16_t) (_aleatorio(estado) % confBench.Claves);
+
+    // primer rango cuya acumulada supera u
+    double const u = _aleatorioUnitario(estado);
+    size_t ini = 0;
+    size_t fin = confBench.Claves - 1;
+    while (ini < fin)
+    {
+        size_t const medio = ini + (fin - ini) / 2;
+        if (acumuladaZipf[medio] < u)
+            ini = medio + 1;
+        else
+            fin = medio;
+    }
+
+    return (uint16_t) ini;
+}
+
+static void _generarValor(uint64_t* estado, char* valor)
+{
+    uint32_t const rango = confBench.ValorMax - confBench.ValorMin + 1;
+    uint32_t const len = confBench.ValorMin + (uint32_t) (_aleatorio(estado) % rango);
+    for (uint32_t i = 0; i < len; ++i)
+        valor[i] = (char) ('a' + _aleatorio(estado) % 26);
+    valor[len] = '\0';
+}
+
+static void* _trabajar(void* arg)
+{
+    t_trabajo* const t = arg;
+    t_resultado_fase* const r = &resultados[t->Fase];
+
+    char nombre[NAME_MAX + 1];
+    char valor[confBench.ValorMax + 1];
+    size_t encontradas = 0;
+
+    for (size_t i = t->Desde; i < t->Hasta; ++i)
+    {
+        _nombreTabla((uint32_t) (_aleatorio(&t->Estado) % confBench.Tablas), nombre);
+        uint16_t const key = _siguienteClave(&t->Estado);
+
+        uint64_t inicio;
+        if (t->Fase == FASE_INSERT)
+        {
+            _generarValor(&t->Estado, valor);
+
+            inicio = GetNSTime();
+            api_insert(nombre, key, valor, GetMSEpoch());
+        }
+        else
+        {
+            uint64_t timestamp;
+
+            inicio = GetNSTime();
+            if (api_select(nombre, key, valor, &timestamp) == Ok)
+                ++encontradas;
+        }
+
+        r->Latencias[i] = GetNSTime() - inicio;
+    }
+
+    atomic_fetch_add(&r->Encontradas, encontradas);
+    return NULL;
+}
+
+// corre [desde, hasta) de la fase repartido entre los hilos
+static void _correrFase(Fase fase, size_t desde, size_t hasta, uint64_t semilla)
+{
+    uint32_t const numHilos = confBench.Hilos;
+    size_t const total = hasta - desde;
+
+    pthread_t hilos[numHilos];
+    t_trabajo trabajos[numHilos];
+
+    uint64_t const inicio = GetNSTime();
+    for (uint32_t i = 0; i < numHilos; ++i)
+    {
+        trabajos[i].Fase = fase;
+        trabajos[i].Desde = desde + total * i / numHilos;
+        trabajos[i].Hasta = desde + total * (i + 1) / numHilos;
+
+        // nunca 0, xorshift se queda ahi
+        trabajos[i].Estado = (semilla * 0x9E3779B97F4A7C15 + i + 1) | 1;
+        pthread_create(hilos + i, NULL, _trabajar, trabajos + i);
+    }
+
+    for (uint32_t i = 0; i < numHilos; ++i)
+        pthread_join(hilos[i], NULL);
+
+    resultados[fase].DuracionNs += GetNSTime() - inicio;
+}
+
+static void _medirDump(size_t ronda)
+{
+    uint64_t const inicio = GetNSTime();
+    memtable_dump();
+
+    uint64_t const ns = GetNSTime() - inicio;
+    resultados[FASE_DUMP].Latencias[ronda] = ns;
+    resultados[FASE_DUMP].DuracionNs += ns;
+}
+
+static void _medirCompactaciones(void)
+{
+    char nombre[NAME_MAX + 1];
+    for (uint32_t i = 0; i < confBench.Tablas; ++i)
+    {
+        uint64_t const inicio = GetNSTime();
+        compactar(_nombreTabla(i, nombre), 0);
+
+        uint64_t const ns = GetNSTime() - inicio;
+        resultados[FASE_COMPACTACION].Latencias[i] = ns;
+        resultados[FASE_COMPACTACION].DuracionNs += ns;
+    }
+}
+
+static int _compararLatencias(void const* a, void const* b)
+{
+    uint64_t const x = *(uint64_t const*) a;
+    uint64_t const y = *(uint64_t const*) b;
+    return (x > y) - (x < y);
+}
+
+// con las latencias ya ordenadas
+static uint64_t _percentil(t_resultado_fase const* r, double p)
+{
+    size_t i = (size_t) ceil(p * r->Operaciones);
+    if (i)
+        --i;
+    return r->Latencias[i] / 1000;
+}
+
+static void _escribirResultados(FILE* salida)
+{
+    fprintf(salida, "{\n  \"configuracion\": {\n");
+    fprintf(salida, "    \"tablas\": %u,\n    \"particiones\": %hu,\n    \"claves\": %u,\n", confBench.Tablas,
+            confBench.Particiones, confBench.Claves);
+    fprintf(salida, "    \"distribucion\": \"%s\",\n    \"zipf_s\": %.3f,\n",
+            confBench.Distribucion == DISTRIBUCION_ZIPF ? "ZIPF" : "UNIFORME", confBench.ZipfS);
+    fprintf(salida, "    \"valor_min\": %u,\n    \"valor_max\": %u,\n", confBench.ValorMin, confBench.ValorMax);
+    fprintf(salida, "    \"inserts\": %zu,\n    \"selects\": %zu,\n    \"rondas\": %u,\n    \"hilos\": %u,\n",
+            confBench.Inserts, confBench.Selects, confBench.Rondas, confBench.Hilos);
+    fprintf(salida, "    \"semilla\": %" PRIu64 ",\n    \"block_size\": %zu,\n    \"blocks\": %zu,\n", confBench.Semilla,
+            confLFS.TAMANIO_BLOQUES, confLFS.CANTIDAD_BLOQUES);
+    fprintf(salida, "    \"modo_wal\": \"%s\",\n    \"durabilidad\": \"%s\"\n  },\n", confBench.ModoWal,
+            confBench.Durabilidad);
+
+    fprintf(salida, "  \"fases\": {");
+    for (uint8_t f = 0; f < NUM_FASES; ++f)
+    {
+        t_resultado_fase* const r = &resultados[f];
+        qsort(r->Latencias, r->Operaciones, sizeof(uint64_t), _compararLatencias);
+
+        double const segundos = r->DuracionNs / 1e9;
+        fprintf(salida, "%s\n    \"%s\": { \"operaciones\": %zu, \"segundos\": %.6f, \"ops_por_segundo\": %.1f",
+                f ? "," : "", NombresFase[f], r->Operaciones, segundos, segundos > 0 ? r->Operaciones / segundos : 0.0);
+
+        if (r->Operaciones)
+            fprintf(salida, ", \"p50_us\": %" PRIu64 ", \"p90_us\": %" PRIu64 ", \"p99_us\": %" PRIu64 ", \"p999_us\": %"
+                    PRIu64 ", \"max_us\": %" PRIu64, _percentil(r, 0.50), _percentil(r, 0.90), _percentil(r, 0.99),
+                    _percentil(r, 0.999), r->Latencias[r->Operaciones - 1] / 1000);
+
+        if (f == FASE_SELECT || f == FASE_SELECT_COMPACTADO)
+            fprintf(salida, ", \"encontradas\": %zu", atomic_load(&r->Encontradas));
+
+        fprintf(salida, " }");
+    }
+
+    fprintf(salida, "\n  }\n}\n");
+}
+
+static long _opcional(t_config const* config, char const* clave, long defecto)
+{
+    return config && config_has_property(config, clave) ? config_get_long_value(config, clave) : defecto;
+}
+
+static char const* _opcionalString(t_config const* config, char const* clave, char const* defecto)
+{
+    return config && config_has_property(config, clave) ? config_get_string_value(config, clave) : defecto;
+}
+
+static void CargarConfig(char const* fileName)
+{
+    // sin archivo se corre con los valores por defecto
+    t_config* config = config_create(fileName);
+    if (!config)
+        LISSANDRA_LOG_INFO("No se encontro %s, usando la configuracion por defecto", fileName);
+
+    snprintf(confBench.PuntoMontaje, PATH_MAX, "%s", _opcionalString(config, "PUNTO_MONTAJE", ""));
+    confBench.Tablas = _opcional(config, "TABLAS", 4);
+    confBench.Particiones = _opcional(config, "PARTICIONES", 4);
+    confBench.Claves = _opcional(config, "CLAVES", 10000);
+    confBench.ValorMin = _opcional(config, "VALOR_MIN", 16);
+    confBench.ValorMax = _opcional(config, "VALOR_MAX", 64);
+    confBench.Inserts = _opcional(config, "INSERTS", 100000);
+    confBench.Selects = _opcional(config, "SELECTS", 100000);
+    confBench.Rondas = _opcional(config, "RONDAS", 4);
+    confBench.Hilos = _opcional(config, "HILOS", 1);
+    confBench.Semilla = _opcional(config, "SEMILLA", 1);
+
+    confBench.Distribucion = DISTRIBUCION_UNIFORME;
+    confBench.ZipfS = 0.99;
+    if (!strcmp(_opcionalString(config, "DISTRIBUCION", "UNIFORME"), "ZIPF"))
+        confBench.Distribucion = DISTRIBUCION_ZIPF;
+    if (config && config_has_property(config, "ZIPF_S"))
+        confBench.ZipfS = config_get_double_value(config, "ZIPF_S");
+
+    snprintf(confBench.ArchivoResultados, PATH_MAX, "%s", _opcionalString(config, "ARCHIVO_RESULTADOS", ""));
+    snprintf(confBench.ArchivoEstadisticas, PATH_MAX, "%s", _opcionalString(config, "ARCHIVO_ESTADISTICAS", ""));
+
+    // los del LFS que afectan al almacenamiento, con los mismos nombres que en lissandra.conf
+    confLFS.TAMANIO_VALUE = confBench.ValorMax;
+    confLFS.TAMANIO_BLOQUES = _opcional(config, "BLOCK_SIZE", 4096);
+    confLFS.CANTIDAD_BLOQUES = _opcional(config, "BLOCKS", 16384);
+    confLFS.VENTANA_WAL_US = _opcional(config, "VENTANA_WAL_US", 0);
+    atomic_store(&confLFS.GRACIA_TOMBSTONE, _opcional(config, "GRACIA_TOMBSTONE", 60000));
+
+    snprintf(confBench.ModoWal, sizeof confBench.ModoWal, "%s", _opcionalString(config, "MODO_WAL", "GROUP"));
+    if (!wal_modo_desde_string(confBench.ModoWal, &confLFS.MODO_WAL))
+        exit(EXIT_FAILURE);
+
+    snprintf(confBench.Durabilidad, sizeof confBench.Durabilidad, "%s", _opcionalString(config, "DURABILIDAD", "BATCH"));
+    if (!durabilidad_modo_desde_string(confBench.Durabilidad, &confLFS.DURABILIDAD))
+        exit(EXIT_FAILURE);
+
+    if (config)
+        config_destroy(config);
+
+    // sin retardo ni dumps ni compactaciones periodicas, las fases los piden explicitamente
+    atomic_store(&confLFS.RETARDO, 0);
+    confLFS.TIEMPO_DUMP = 0;
+    confLFS.TIEMPO_DEFRAG = 0;
+
+    if (!confBench.Tablas || !confBench.Particiones || !confBench.Hilos || !confBench.Rondas ||
+        !confBench.Claves || confBench.Claves > UINT16_MAX + 1 || confBench.ValorMin > confBench.ValorMax)
+    {
+        LISSANDRA_LOG_FATAL("Configuracion invalida: TABLAS, PARTICIONES, HILOS, RONDAS y CLAVES (hasta 65536) deben ser "
+                            "positivos y VALOR_MIN no puede superar a VALOR_MAX");
+        exit(EXIT_FAILURE);
+    }
+
+    // sin punto de montaje se usa uno temporal que se borra al terminar
+    if (!*confBench.PuntoMontaje)
+    {
+        char plantilla[] = "/tmp/lfs_bench.XXXXXX";
+        if (!mkdtemp(plantilla))
+        {
+            LISSANDRA_LOG_SYSERROR("mkdtemp");
+            exit(EXIT_FAILURE);
+        }
+
+        snprintf(confBench.PuntoMontaje, PATH_MAX, "%s", plantilla);
+        confBench.MontajeTemporal = true;
+    }
+
+    // con la / agregada tiene que seguir entrando, si no los paths del FS quedarian cortados
+    if (snprintf(confLFS.PUNTO_MONTAJE, PATH_MAX, "%s/", confBench.PuntoMontaje) >= PATH_MAX)
+    {
+        LISSANDRA_LOG_FATAL("El punto de montaje %s es demasiado largo!", confBench.PuntoMontaje);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void _armarZipf(void)
+{
+    acumuladaZipf = Malloc(confBench.Claves * sizeof(double));
+
+    double suma = 0.0;
+    for (uint32_t i = 0; i < confBench.Claves; ++i)
+    {
+        suma += 1.0 / pow(i + 1, confBench.ZipfS);
+        acumuladaZipf[i] = suma;
+    }
+
+    for (uint32_t i = 0; i < confBench.Claves; ++i)
+        acumuladaZipf[i] /= suma;
+}
+
+static int _borrarEntrada(char const* path, struct stat const* sb, int tipo, struct FTW* ftw)
+{
+    (void) sb;
+    (void) tipo;
+    (void) ftw;
+
+    if (remove(path) < 0)
+        LISSANDRA_LOG_SYSERROR("remove");
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    Logger_Init();
+    Logger_AddAppender(AppenderConsole_Create(LOG_LEVEL_ERROR, APPENDER_FLAGS_PREFIX_LOGLEVEL,
+                                              WHITE, WHITE, WHITE, YELLOW, LRED, LRED));
+
+    CargarConfig(argc > 1 ? argv[1] : "lfs_bench.conf");
+    if (confBench.Distribucion == DISTRIBUCION_ZIPF)
+        _armarZipf();
+
+    estadisticas_init();
+    iniciarFileSystem();
+    memtable_create();
+    keyfilter_init();
+
+    // tablas nuevas, sin compactacion periodica (el compactador duerme el maximo)
+    char nombre[NAME_MAX + 1];
+    for (uint32_t i = 0; i < confBench.Tablas; ++i)
+    {
+        _nombreTabla(i, nombre);
+        if (api_create(nombre, CRITERIA_SC, confBench.Particiones, UINT32_MAX, 0) != EXIT_SUCCESS)
+        {
+            LISSANDRA_LOG_FATAL("No se pudo crear la tabla %s (ya existe o no hay bloques)", nombre);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    size_t const operaciones[NUM_FASES] =
+    {
+        confBench.Inserts, confBench.Rondas, confBench.Selects, confBench.Tablas, confBench.Selects
+    };
+
+    for (uint8_t f = 0; f < NUM_FASES; ++f)
+    {
+        resultados[f].Latencias = Calloc(operaciones[f] ? operaciones[f] : 1, sizeof(uint64_t));
+        resultados[f].Operaciones = operaciones[f];
+        atomic_init(&resultados[f].Encontradas, 0);
+    }
+
+    for (uint32_t ronda = 0; ronda < confBench.Rondas; ++ronda)
+    {
+        size_t const desde = confBench.Inserts * ronda / confBench.Rondas;
+        size_t const hasta = confBench.Inserts * (ronda + 1) / confBench.Rondas;
+        _correrFase(FASE_INSERT, desde, hasta, confBench.Semilla + ronda);
+        _medirDump(ronda);
+    }
+
+    // las lecturas usan otra semilla, asi no repiten exactamente la secuencia de los inserts
+    _correrFase(FASE_SELECT, 0, confBench.Selects, ~confBench.Semilla);
+    _medirCompactaciones();
+    _correrFase(FASE_SELECT_COMPACTADO, 0, confBench.Selects, ~confBench.Semilla);
+
+    FILE* salida = stdout;
+    if (*confBench.ArchivoResultados && !(salida = fopen(confBench.ArchivoResultados, "w")))
+    {
+        LISSANDRA_LOG_SYSERROR("fopen");
+        salida = stdout;
+    }
+
+    _escribirResultados(salida);
+    if (salida != stdout)
+        fclose(salida);
+
+    // el costo por tabla que registra el propio LFS, mismo formato que ARCHIVO_ESTADISTICAS del LFS
+    if (*confBench.ArchivoEstadisticas)
+        estadisticas_guardar(confBench.ArchivoEstadisticas);
+
+    for (uint8_t f = 0; f < NUM_FASES; ++f)
+        Free(resultados[f].Latencias);
+    Free(acumuladaZipf);
+
+    memtable_destroy();
+    keyfilter_destroy();
+    terminarFileSystem();
+    estadisticas_destroy();
+
+    if (confBench.MontajeTemporal)
+        nftw(confBench.PuntoMontaje, _borrarEntrada, 16, FTW_DEPTH | FTW_PHYS);
+
+    Logger_Terminate();
+    return EXIT_SUCCESS;
+}
@@ -15,6 +15,7 @@ ScriptCommand const ScriptCommands[] =
     { "CREATE",   HandleCreate   },
     { "DESCRIBE", HandleDescribe },
     { "DROP",     HandleDrop     },
+    { "DELETE",   HandleDelete   },
     { "JOURNAL",  HandleJournal  },
     { "ADD",      HandleAdd      },
     { "RUN",      HandleRun      },
@@ -27,6 +28,7 @@ ScriptCommand const ScriptCommands[] =
 // del Kernel que esa operación no se pudo realizar correctamente por una falla y seguí con la siguiente en el script
 // (o si es la última finalizá el script)
 #define LOG_MEMORY_DOWN() LISSANDRA_LOG_ERROR("La memoria se desconecto mientras corria script")
+#define LOG_FS_DOWN(cmd) LISSANDRA_LOG_ERROR(cmd ": la memoria no pudo comunicarse con el FileSystem")
 
 bool HandleSelect(Vector const* args)
 {
@@ -98,6 +100,10 @@ bool HandleSelect(Vector const* args)
             LISSANDRA_LOG_FATAL("SELECT: tabla %s no existe en el FS! Esto no deberia estar pasando...", table);
             Packet_Destroy(p);
             return false;
+        case MSG_ERR_FS_UNAVAILABLE:
+            LOG_FS_DOWN("SELECT");
+            Packet_Destroy(p);
+            return false;
         default:
             LISSANDRA_LOG_FATAL("SELECT: recibido opcode no esperado %hu", Packet_GetOpcode(p));
             Packet_Destroy(p);
@@ -202,12 +208,12 @@ bool HandleInsert(Vector const* args)
 bool HandleCreate(Vector const* args)
 {
     //           cmd args
-    //           0      1       2          3            4
-    // sintaxis: CREATE <table> <criteria> <partitions> <compaction_time>
+    //           0      1       2          3            4                 5 (opcional)
+    // sintaxis: CREATE <table> <criteria> <partitions> <compaction_time> <ttl>
 
-    if (Vector_size(args) != 5)
+    if (Vector_size(args) != 5 && Vector_size(args) != 6)
     {
-        LISSANDRA_LOG_ERROR("CREATE: Uso - CREATE <tabla> <criterio> <particiones> <tiempo entre compactaciones>");
+        LISSANDRA_LOG_ERROR("CREATE: Uso - CREATE <tabla> <criterio> <particiones> <tiempo entre compactaciones> [TTL]");
         return false;
     }
 
@@ -236,6 +242,7 @@ bool HandleCreate(Vector const* args)
     dbr.Data.Create.Consistency = ct;
     dbr.Data.Create.Partitions = strtoul(partitions, NULL, 10);
     dbr.Data.Create.CompactTime = strtoul(compaction_time, NULL, 10);
+    dbr.Data.Create.TTL = Vector_size(args) == 6 ? strtoul(tokens[5], NULL, 10) : 0;
 
     Memory* mem = Criteria_GetMemoryFor(ct, OP_CREATE, &dbr);
     if (!mem) // no hay memorias conectadas? criteria loguea el error
@@ -314,6 +321,14 @@ bool HandleDescribe(Vector const* args)
         return true;
     }
 
+    // sin respuesta del FS no se tocan los metadatos
+    if (Packet_GetOpcode(p) == MSG_ERR_FS_UNAVAILABLE)
+    {
+        LOG_FS_DOWN("DESCRIBE");
+        Packet_Destroy(p);
+        return false;
+    }
+
     if (Packet_GetOpcode(p) != MSG_ERR_TABLE_NOT_EXISTS && Packet_GetOpcode(p) != MSG_DESCRIBE && Packet_GetOpcode(p) != MSG_DESCRIBE_GLOBAL)
     {
         LISSANDRA_LOG_FATAL("DESCRIBE: recibido opcode no esperado %hu", Packet_GetOpcode(p));
@@ -386,6 +401,76 @@ bool HandleDrop(Vector const* args)
     return true;
 }
 
+bool HandleDelete(Vector const* args)
+{
+    //           cmd args
+    //           0      1       2
+    // sintaxis: DELETE <table> <key>
+
+    // obs: igual que INSERT, desde kernel va sin Timestamp
+    if (Vector_size(args) != 3)
+    {
+        LISSANDRA_LOG_ERROR("DELETE: Uso - DELETE <tabla> <key>");
+        return false;
+    }
+
+    char** const tokens = Vector_data(args);
+
+    char* const table = tokens[1];
+    char* const key = tokens[2];
+
+    if (!ValidateTableName(table))
+        return false;
+
+    CriteriaType ct;
+    if (!Metadata_Get(table, &ct))
+    {
+        LISSANDRA_LOG_ERROR("DELETE: Tabla %s no encontrada en metadata", table);
+        return false;
+    }
+
+    uint16_t k;
+    if (!ValidateKey(key, &k))
+        return false;
+
+    DBRequest dbr;
+    dbr.TableName = table;
+    dbr.Data.Delete.Key = k;
+
+    Memory* mem = Criteria_GetMemoryFor(ct, OP_DELETE, &dbr);
+    if (!mem) // no hay memorias conectadas? criteria loguea el error
+        return false;
+
+    Packet* p = Memory_SendRequestWithAnswer(mem, OP_DELETE, &dbr);
+
+    // se desconecto la memoria! el sendrequest ya lo logueó
+    if (!p)
+    {
+        LOG_MEMORY_DOWN();
+        return true;
+    }
+
+    if (Packet_GetOpcode(p) != MSG_DELETE_RESPUESTA)
+    {
+        LISSANDRA_LOG_FATAL("DELETE: recibido opcode no esperado %hu", Packet_GetOpcode(p));
+        Packet_Destroy(p);
+        return false;
+    }
+
+    uint8_t res;
+    Packet_Read(p, &res);
+    Packet_Destroy(p);
+
+    if (res == EXIT_FAILURE)
+    {
+        LISSANDRA_LOG_ERROR("DELETE: error al borrar la key %s de la tabla %s!", key, table);
+        return false;
+    }
+
+    LISSANDRA_LOG_INFO("DELETE: tabla: %s, key: %s", table, key);
+    return true;
+}
+
 bool HandleJournal(Vector const* args)
 {
     //           cmd args
@@ -17,6 +17,7 @@ ScriptHandlerFn HandleInsert;
 ScriptHandlerFn HandleCreate;
 ScriptHandlerFn HandleDescribe;
 ScriptHandlerFn HandleDrop;
+ScriptHandlerFn HandleDelete;
 ScriptHandlerFn HandleJournal;
 ScriptHandlerFn HandleAdd;
 ScriptHandlerFn HandleRun;
@@ -581,6 +581,10 @@ static Memory* _shc_get(MemoryOps op, DBRequest const* dbr)
         case OP_INSERT:
             hash = keyHash(dbr->Data.Insert.Key);
             break;
+        case OP_DELETE:
+            // misma memoria que los INSERT de esa key, asi el DELETE pisa lo que haya en su cache
+            hash = keyHash(dbr->Data.Delete.Key);
+            break;
         default:
             break;
     }
@@ -685,6 +689,7 @@ static void _send_one(Memory* mem, MemoryOps op, DBRequest const* dbr)
         BuildCreate,
         BuildDescribe,
         BuildDrop,
+        BuildDelete,
         BuildJournal
     };
 
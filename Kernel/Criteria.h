@@ -17,6 +17,7 @@ typedef enum
     OP_CREATE,
     OP_DESCRIBE,
     OP_DROP,
+    OP_DELETE,
     OP_JOURNAL,
 
     NUM_OPS
@@ -38,11 +39,17 @@ typedef struct
             char const* Value;
         } Insert;
 
+        struct
+        {
+            uint16_t Key;
+        } Delete;
+
         struct
         {
             CriteriaType Consistency;
             uint16_t Partitions;
             uint32_t CompactTime;
+            uint32_t TTL;
         } Create;
     } Data;
 } DBRequest;
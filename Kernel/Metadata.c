@@ -86,9 +86,15 @@ void Metadata_Update(char const* tableName, Packet* p)
         uint32_t compaction_time;
         Packet_Read(p, &compaction_time);
 
+        uint32_t ttl;
+        Packet_Read(p, &ttl);
+
+        uint64_t expired;
+        Packet_Read(p, &expired);
+
         LISSANDRA_LOG_INFO(
-                "DESCRIBE: Tabla nº %u: nombre: %s, tipo consistencia %u, particiones: %u, tiempo entre compactaciones %u",
-                i + 1, name, type, partitions, compaction_time);
+                "DESCRIBE: Tabla nº %u: nombre: %s, tipo consistencia %u, particiones: %u, tiempo entre compactaciones %u, "
+                "TTL %u, registros expirados %" PRIu64, i + 1, name, type, partitions, compaction_time, ttl, expired);
 
         _addMetadata(name, type);
         Free(name);
@@ -25,11 +25,12 @@ static inline Packet* BuildInsert(DBRequest const* dbr)
 
 static inline Packet* BuildCreate(DBRequest const* dbr)
 {
-    Packet* p = Packet_Create(LQL_CREATE, 23);
+    Packet* p = Packet_Create(LQL_CREATE, 27);
     Packet_Append(p, dbr->TableName);
     Packet_Append(p, (uint8_t) dbr->Data.Create.Consistency);
     Packet_Append(p, dbr->Data.Create.Partitions);
     Packet_Append(p, dbr->Data.Create.CompactTime);
+    Packet_Append(p, dbr->Data.Create.TTL);
     return p;
 }
 
@@ -52,6 +53,14 @@ static inline Packet* BuildDrop(DBRequest const* dbr)
     return p;
 }
 
+static inline Packet* BuildDelete(DBRequest const* dbr)
+{
+    Packet* p = Packet_Create(LQL_DELETE, 20);
+    Packet_Append(p, dbr->TableName);
+    Packet_Append(p, dbr->Data.Delete.Key);
+    return p;
+}
+
 static inline Packet* BuildJournal(DBRequest const* dbr)
 {
     (void) dbr;
@@ -2,22 +2,23 @@
 #include "API.h"
 #include "Compactador.h"
 #include "Config.h"
+#include "Durabilidad.h"
+#include "Estadisticas.h"
+#include "FileSystem.h"
+#include "KeyFilter.h"
 #include "LissandraLibrary.h"
+#include "TablaFijada.h"
 #include <Consistency.h>
-#include <fcntl.h>
 #include <Logger.h>
 #include <Malloc.h>
 #include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/file.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
-SelectResult api_select(char* nombreTabla, uint16_t key, char* value, uint64_t* timestamp)
+static SelectResult _select(char* nombreTabla, uint16_t key, char* value, uint64_t* timestamp)
 {
-    MSSleep(atomic_load(&confLFS.RETARDO));
-
     char path[PATH_MAX];
     generarPathTabla(nombreTabla, path);
 
@@ -28,74 +29,98 @@ SelectResult api_select(char* nombreTabla, uint16_t key, char* value, uint64_t*
         return TableNotFound;
     }
 
-    //Obtener la metadata asociada a dicha tabla
-    t_describe infoTabla;
-    if (!get_table_metadata(nombreTabla, &infoTabla))
-        return TableNotFound;
-
-    //Calcular cual es la particion que contiene dicho KEY
-    uint16_t const particion = get_particion(infoTabla.partitions, key);
-    char pathParticion[PATH_MAX];
-    generarPathParticion(particion, path, pathParticion);
-
-    // bloqueo sugerido compartido tabla (lectura)
-    int fd = open(path, O_RDONLY);
-    if (fd == -1)
+    //Si el filtro dice que la clave no existe me ahorro escanear particion, temporales y memtable
+    if (!keyfilter_may_contain(nombreTabla, key))
     {
-        LISSANDRA_LOG_SYSERROR("open");
-        return TableNotFound;
+        LISSANDRA_LOG_TRACE("SELECT: la key %hu no existe en la tabla %s (filtro)", key, nombreTabla);
+        return KeyNotFound;
     }
 
-    // dump bloquea select/compactacion durante el renombre y el bajado a archivo
-    flock(fd, LOCK_SH);
+    //Las fuentes se consultan de la mas nueva a la mas vieja: memtable, temporales (del ultimo dump al primero)
+    //y por ultimo la particion. Ante un empate de timestamps gana la mas vieja, igual que al compactar
+    t_registro* const mayor = Malloc(REGISTRO_SIZE);
+    t_registro* const registro = Malloc(REGISTRO_SIZE);
 
-    //Escanear la particion objetivo
-    t_registro* resultadoParticion = Malloc(REGISTRO_SIZE);
-    if (!scanParticion(pathParticion, key, resultadoParticion))
-    {
-        Free(resultadoParticion);
-        resultadoParticion = NULL;
-    }
+    //Escanear la memoria temporal de dicha tabla buscando la key deseada
+    //va antes de fijar la version: un dump en curso sigue visible en la memtable hasta que publica su temporal
+    bool encontrado = memtable_get_biggest_timestamp(nombreTabla, key, mayor);
 
-    //Escanear todos los archivos temporales
-    t_registro* resultadoTemporales = Malloc(REGISTRO_SIZE);
-    if (!temporales_get_biggest_timestamp(path, key, resultadoTemporales))
+    //Fijar la version actual de la tabla, dumps y compactaciones publican versiones nuevas sin bloquearnos
+    t_snapshot* snapshot = snapshot_pin(nombreTabla);
+    if (!snapshot)
     {
-        Free(resultadoTemporales);
-        resultadoTemporales = NULL;
+        Free(registro);
+        Free(mayor);
+        return TableNotFound;
     }
 
-    //Escanear la memoria temporal de dicha tabla buscando la key deseada
-    t_registro* resultadoMemtable = Malloc(REGISTRO_SIZE);
-    if (!memtable_get_biggest_timestamp(nombreTabla, key, resultadoMemtable))
+    //Escanear los temporales y la particion que contiene dicha KEY
+    //si la tabla esta fijada la particion ya esta decodificada en memoria, no se lee de los bloques
+    size_t const numTemporales = Vector_size(&snapshot->Temporales);
+    t_archivo* const* const temporales = Vector_data(&snapshot->Temporales);
+    t_archivo const* const particion = snapshot->Particiones[get_particion(snapshot->NumParticiones, key)];
+    for (size_t i = numTemporales + 1; i-- > 0;)
     {
-        Free(resultadoMemtable);
-        resultadoMemtable = NULL;
+        t_archivo const* const archivo = i ? temporales[i - 1] : particion;
+
+        //Un archivo cuyos registros son todos anteriores a lo encontrado no puede cambiar el resultado
+        if (encontrado && archivo->TimestampMax < mayor->timestamp)
+            continue;
+
+        bool const leido = !i && snapshot->Fijada ? fijada_buscar(snapshot->Fijada, key, registro) :
+                                                    scanArchivo(archivo, key, registro);
+        if (leido && (!encontrado || registro->timestamp >= mayor->timestamp))
+        {
+            encontrado = true;
+            memcpy(mayor, registro, REGISTRO_SIZE);
+        }
     }
 
-    // quita el bloqueo sugerido
-    close(fd);
+    uint32_t const ttl = snapshot->TTL;
+    snapshot_unpin(snapshot);
+
+    //si lo mas nuevo es un DELETE la key no existe
+    if (encontrado && mayor->tombstone)
+        encontrado = false;
+
+    //Si la tabla tiene TTL, un registro vencido tampoco existe aunque la compactacion todavia no lo haya borrado
+    if (encontrado && ttl && mayor->timestamp + ttl < GetMSEpoch())
+        encontrado = false;
 
-    //Encontradas las entradas para dicha KEY, se retorna el valor con el Timestamp más grande
-    t_registro const* maximo = get_newest(resultadoParticion, resultadoTemporales, resultadoMemtable);
-    if (maximo)
+    if (encontrado)
     {
-        strncpy(value, maximo->value, confLFS.TAMANIO_VALUE + 1);
-        *timestamp = maximo->timestamp;
+        strncpy(value, mayor->value, confLFS.TAMANIO_VALUE + 1);
+        *timestamp = mayor->timestamp;
     }
 
-    Free(resultadoMemtable);
-    Free(resultadoTemporales);
-    Free(resultadoParticion);
+    Free(registro);
+    Free(mayor);
 
-    if (!maximo)
+    if (!encontrado)
         return KeyNotFound;
     return Ok;
 }
 
+SelectResult api_select(char* nombreTabla, uint16_t key, char* value, uint64_t* timestamp)
+{
+    MSSleep(atomic_load(&confLFS.RETARDO));
+
+    // el retardo simulado no cuenta como costo de la operacion
+    estadisticas_inicio();
+
+    SelectResult const res = _select(nombreTabla, key, value, timestamp);
+
+    // las tablas inexistentes no generan estadisticas
+    if (res != TableNotFound)
+        estadisticas_fin(nombreTabla, OPERACION_SELECT);
+
+    return res;
+}
+
 uint8_t api_insert(char* nombreTabla, uint16_t key, char const* value, uint64_t timestamp)
 {
     MSSleep(atomic_load(&confLFS.RETARDO));
+    estadisticas_inicio();
 
     //Verifica si la tabla existe en el File System
     char path[PATH_MAX];
@@ -109,12 +134,61 @@ uint8_t api_insert(char* nombreTabla, uint16_t key, char const* value, uint64_t
 
     //Verifica si hay datos a dumpear, y si no existen aloca memoria
     memtable_new_elem(nombreTabla, key, value, timestamp);
+    keyfilter_add(nombreTabla, key);
+
+    estadisticas_fin(nombreTabla, OPERACION_INSERT);
 
     LISSANDRA_LOG_INFO("Se inserto un nuevo registro en la tabla %s", nombreTabla);
     return EXIT_SUCCESS;
 }
 
-uint8_t api_create(char* nombreTabla, uint8_t tipoConsistencia, uint16_t numeroParticiones, uint32_t compactionTime)
+uint8_t api_insert_batch(char* nombreTabla, t_insert const* inserts, size_t cantidad)
+{
+    MSSleep(atomic_load(&confLFS.RETARDO));
+
+    char path[PATH_MAX];
+    generarPathTabla(nombreTabla, path);
+
+    if (!existeDir(path))
+    {
+        LISSANDRA_LOG_ERROR("La tabla ingresada para INSERT: %s no existe en el File System", nombreTabla);
+        return EXIT_FAILURE;
+    }
+
+    estadisticas_inicio();
+
+    memtable_new_elems(nombreTabla, inserts, cantidad);
+    for (size_t i = 0; i < cantidad; ++i)
+        keyfilter_add(nombreTabla, inserts[i].key);
+
+    estadisticas_fin(nombreTabla, OPERACION_INSERT);
+
+    LISSANDRA_LOG_INFO("Se insertaron %zu registros en la tabla %s", cantidad, nombreTabla);
+    return EXIT_SUCCESS;
+}
+
+uint8_t api_delete(char* nombreTabla, uint16_t key, uint64_t timestamp)
+{
+    MSSleep(atomic_load(&confLFS.RETARDO));
+
+    char path[PATH_MAX];
+    generarPathTabla(nombreTabla, path);
+
+    if (!existeDir(path))
+    {
+        LISSANDRA_LOG_ERROR("La tabla ingresada para DELETE: %s no existe en el File System", nombreTabla);
+        return EXIT_FAILURE;
+    }
+
+    //El DELETE es un registro mas (tombstone), oculta a los anteriores hasta que la compactacion los descarte
+    //no se agrega al filtro: si la key no estaba, sigue sin existir
+    memtable_new_elem(nombreTabla, key, NULL, timestamp);
+
+    LISSANDRA_LOG_INFO("Se borro la key %hu de la tabla %s", key, nombreTabla);
+    return EXIT_SUCCESS;
+}
+
+uint8_t api_create(char* nombreTabla, uint8_t tipoConsistencia, uint16_t numeroParticiones, uint32_t compactionTime, uint32_t ttl)
 {
     MSSleep(atomic_load(&confLFS.RETARDO));
 
@@ -126,48 +200,63 @@ uint8_t api_create(char* nombreTabla, uint8_t tipoConsistencia, uint16_t numeroP
     //Si la tabla no existe la crea, crea su metadata y las particiones
     if (!existeDir(path))
     {
+        // hasta que esten todas las particiones nadie carga la tabla a medio crear
+        snapshot_create_table(nombreTabla);
         mkdir(path, 0700);
 
-        //Crea el path de la metadata de la tabla y le carga los datos
-        char pathMetadataTabla[PATH_MAX];
-        generarPathArchivo(nombreTabla, "Metadata", pathMetadataTabla);
+        //Crea la metadata de la tabla y le carga los datos
+        {
+            t_describe metadata;
+            snprintf(metadata.table, NAME_MAX + 1, "%s", nombreTabla);
+            metadata.consistency = tipoConsistencia;
+            metadata.partitions = numeroParticiones;
+            metadata.compaction_time = compactionTime;
+            metadata.ttl = ttl;
+            metadata.pinned = false;
+            set_table_metadata(&metadata);
+        }
 
+        //Le asigna un bloque a cada particion
+        size_t bloques[numeroParticiones + 1];
+        if (!pedirBloquesLFS(numeroParticiones, bloques))
         {
-            FILE* metadata = fopen(pathMetadataTabla, "w");
-            fprintf(metadata, "CONSISTENCY=%s\n", CriteriaString[tipoConsistencia].String);
-            fprintf(metadata, "PARTITIONS=%d\n", numeroParticiones);
-            fprintf(metadata, "COMPACTION_TIME=%d\n", compactionTime);
-            fclose(metadata);
+            LISSANDRA_LOG_ERROR("No hay espacio en el File System");
+
+            // api_drop(nombreTabla), porque si no puede crear todas las particiones
+            // para una tabla nueva, no tiene sentido que la tabla exista en si.
+            uint8_t resDrop = api_drop(nombreTabla);
+            if (resDrop == EXIT_FAILURE)
+                LISSANDRA_LOG_ERROR("Se produjo un error intentado borrar la tabla %s", nombreTabla);
+
+            return EXIT_FAILURE;
         }
 
-        //Crea cada particion, le carga los datos y le asigna un bloque
+        // el bitmap tiene que estar en disco antes que las particiones que apuntan a esos bloques
+        durabilidad_barrera();
+
+        //Crea cada particion y le carga los datos
         for (uint16_t j = 0; j < numeroParticiones; ++j)
         {
             char pathParticion[PATH_MAX];
             snprintf(pathParticion, PATH_MAX, "%s/%hu.bin", path, j);
 
-            if (!existeArchivo(pathParticion))
-            {
-                size_t bloqueLibre;
-                if (!buscarBloqueLibre(&bloqueLibre))
-                {
-                    LISSANDRA_LOG_ERROR("No hay espacio en el File System");
-
-                    // api_drop(nombreTabla), porque si no puede crear todas las particiones
-                    // para una tabla nueva, no tiene sentido que la tabla exista en si.
-                    uint8_t resDrop = api_drop(nombreTabla);
-                    if (resDrop == EXIT_FAILURE)
-                        LISSANDRA_LOG_ERROR("Se produjo un error intentado borrar la tabla %s", nombreTabla);
+            crearArchivoLFS(pathParticion, bloques[j]);
+        }
 
-                    return EXIT_FAILURE;
-                }
+        durabilidad_confirmar(path);
 
-                crearArchivoLFS(pathParticion, bloqueLibre);
-            }
-        }
+        // y la entrada de la tabla nueva
+        char pathTablas[PATH_MAX];
+        if (snprintf(pathTablas, PATH_MAX, "%sTables", confLFS.PUNTO_MONTAJE) < PATH_MAX)
+            durabilidad_confirmar(pathTablas);
 
+        snapshot_desbloquear(nombreTabla);
         LISSANDRA_LOG_DEBUG("Se finalizo la creacion de la tabla");
 
+        // tabla nueva: el filtro de claves arranca vacio y ya cargado
+        keyfilter_create_table(nombreTabla);
+        estadisticas_agregar_tabla(nombreTabla);
+
         // creo un hilo compactador para la tabla
         agregarTablaCompactador(nombreTabla, compactionTime);
         return EXIT_SUCCESS;
@@ -192,8 +281,10 @@ uint8_t api_drop(char* nombreTabla)
 
     LISSANDRA_LOG_INFO("Se esta borrando la tabla %s...", nombreTabla);
 
+    bloquearDescubrimiento();
     if (!existeDir(pathAbsoluto))
     {
+        desbloquearDescubrimiento();
         LISSANDRA_LOG_ERROR("La tabla %s no existe...", nombreTabla);
         return EXIT_FAILURE;
     }
@@ -204,8 +295,21 @@ uint8_t api_drop(char* nombreTabla)
     //Se elimina el hilo compactador de la tabla
     quitarTablaCompactador(nombreTabla);
 
-    //Se eliminan los archivos de la tabla
-    if (traverse_to_drop(pathAbsoluto) != 0 || rmdir(pathAbsoluto) != 0)
+    //Se elimina el filtro de claves de la tabla, despues del compactador que tambien le agrega claves
+    keyfilter_delete_table(nombreTabla);
+
+    //Se descartan las estadisticas de la tabla
+    estadisticas_quitar_tabla(nombreTabla);
+
+    //Se quitan los archivos de la version actual, sus bloques se liberan cuando ningun SELECT los este leyendo
+    snapshot_drop_table(nombreTabla);
+
+    //Se eliminan los archivos restantes de la tabla
+    bool const borrada = traverse_to_drop(pathAbsoluto) == 0 && rmdir(pathAbsoluto) == 0;
+    snapshot_desbloquear(nombreTabla);
+    desbloquearDescubrimiento();
+
+    if (!borrada)
     {
         LISSANDRA_LOG_ERROR("Se produjo un error al intentar borrar la tabla: %s", nombreTabla);
         return EXIT_FAILURE;
@@ -215,6 +319,12 @@ uint8_t api_drop(char* nombreTabla)
     return EXIT_SUCCESS;
 }
 
+static void _agregarExpirados(void* describe)
+{
+    t_describe* const desc = describe;
+    desc->expirados = registrosExpiradosTabla(desc->table);
+}
+
 void* api_describe(char* nombreTabla)
 {
     MSSleep(atomic_load(&confLFS.RETARDO));
@@ -232,6 +342,7 @@ void* api_describe(char* nombreTabla)
             return NULL;
         }
 
+        list_iterate(listTableMetadata, _agregarExpirados);
         return listTableMetadata;
     }
 
@@ -242,5 +353,55 @@ void* api_describe(char* nombreTabla)
         return NULL;
     }
 
+    _agregarExpirados(desc);
     return desc;
 }
+
+//Verificar que la tabla exista en el file system.
+//La reescritura con la nueva cantidad de particiones la hace el compactador de la tabla en su proxima pasada,
+//al publicarla se actualiza la metadata y los DESCRIBE siguientes ya informan la nueva cantidad
+
+uint8_t api_repartition(char* nombreTabla, uint16_t numeroParticiones)
+{
+    char path[PATH_MAX];
+    generarPathTabla(nombreTabla, path);
+
+    if (!existeDir(path))
+    {
+        LISSANDRA_LOG_ERROR("La tabla %s no existe...", nombreTabla);
+        return EXIT_FAILURE;
+    }
+
+    if (!reparticionarTabla(nombreTabla, numeroParticiones))
+    {
+        LISSANDRA_LOG_ERROR("La tabla %s no tiene compactador asignado!", nombreTabla);
+        return EXIT_FAILURE;
+    }
+
+    LISSANDRA_LOG_INFO("Tabla %s: se reparticionara a %hu particiones en la proxima compactacion", nombreTabla, numeroParticiones);
+    return EXIT_SUCCESS;
+}
+
+//Verificar que la tabla exista en el file system.
+//La tabla queda fijada (o deja de estarlo) ya mismo y se guarda en su metadata para los proximos arranques
+
+uint8_t api_pin(char* nombreTabla, bool fijar)
+{
+    char path[PATH_MAX];
+    generarPathTabla(nombreTabla, path);
+
+    if (!existeDir(path))
+    {
+        LISSANDRA_LOG_ERROR("La tabla %s no existe...", nombreTabla);
+        return EXIT_FAILURE;
+    }
+
+    if (!snapshot_fijar(nombreTabla, fijar))
+    {
+        LISSANDRA_LOG_ERROR("No se pudo actualizar la metadata de la tabla %s!", nombreTabla);
+        return EXIT_FAILURE;
+    }
+
+    LISSANDRA_LOG_INFO("Tabla %s %s", nombreTabla, fijar ? "fijada en memoria" : "ya no esta fijada en memoria");
+    return EXIT_SUCCESS;
+}
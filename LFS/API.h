@@ -2,6 +2,8 @@
 #ifndef LFS_API_h__
 #define LFS_API_h__
 
+#include "Memtable.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef enum
@@ -13,8 +15,13 @@ typedef enum
 
 SelectResult api_select(char* nombreTabla, uint16_t key, char* value, uint64_t* timestamp);
 uint8_t api_insert(char* nombreTabla, uint16_t key, char const* value, uint64_t timestamp);
-uint8_t api_create(char* nombreTabla, uint8_t tipoConsistencia, uint16_t numeroParticiones, uint32_t compactionTime);
+// todos los registros a la misma tabla, es una sola operacion
+uint8_t api_insert_batch(char* nombreTabla, t_insert const* inserts, size_t cantidad);
+uint8_t api_delete(char* nombreTabla, uint16_t key, uint64_t timestamp);
+uint8_t api_create(char* nombreTabla, uint8_t tipoConsistencia, uint16_t numeroParticiones, uint32_t compactionTime, uint32_t ttl);
 void* api_describe(char* nombreTabla);
 uint8_t api_drop(char* nombreTabla);
+uint8_t api_repartition(char* nombreTabla, uint16_t numeroParticiones);
+uint8_t api_pin(char* nombreTabla, bool fijar);
 
 #endif //LFS_API_h__
@@ -0,0 +1,227 @@
+
+#include "Bitmap.h"
+#include <Logger.h>
+#include <Malloc.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// el bit i de una palabra de 64 leida de memoria es el bit i % 8 del byte i / 8 (LSB_FIRST)
+_Static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "el bitmap se accede por palabras little endian");
+
+// bloques por region, multiplo de 64
+#define BLOQUES_REGION 4096
+#define PALABRAS_REGION (BLOQUES_REGION / 64)
+
+static _Atomic uint64_t* palabras = NULL;
+static size_t numPalabras = 0;
+static size_t totalBloques = 0;
+
+// bits validos de la ultima palabra, los demas cuentan como ocupados
+static uint64_t mascaraUltima = ~UINT64_C(0);
+
+static atomic_size_t* libresRegion = NULL;
+static size_t numRegiones = 0;
+
+static atomic_bool* paginaSucia = NULL;
+static size_t numPaginas = 0;
+static size_t tamPagina = 0;
+
+static inline uint64_t _leerPalabra(size_t i)
+{
+    uint64_t const w = atomic_load_explicit(palabras + i, memory_order_relaxed);
+    return i == numPalabras - 1 ? w | ~mascaraUltima : w;
+}
+
+static inline void _ensuciar(size_t palabra)
+{
+    atomic_store_explicit(paginaSucia + palabra * sizeof(uint64_t) / tamPagina, true, memory_order_release);
+}
+
+// true si el bloque estaba libre y ahora es mio
+static inline bool _tomar(size_t bloque)
+{
+    uint64_t const bit = UINT64_C(1) << (bloque % 64);
+    if (atomic_fetch_or(palabras + bloque / 64, bit) & bit)
+        return false;
+
+    atomic_fetch_sub_explicit(libresRegion + bloque / BLOQUES_REGION, 1, memory_order_relaxed);
+    _ensuciar(bloque / 64);
+    return true;
+}
+
+static inline void _soltar(size_t bloque)
+{
+    uint64_t const bit = UINT64_C(1) << (bloque % 64);
+    if (!(atomic_fetch_and(palabras + bloque / 64, ~bit) & bit))
+        return;
+
+    atomic_fetch_add_explicit(libresRegion + bloque / BLOQUES_REGION, 1, memory_order_relaxed);
+    _ensuciar(bloque / 64);
+}
+
+void bitmap_init(void* mapping, size_t numBloques)
+{
+    palabras = mapping;
+    totalBloques = numBloques;
+    numPalabras = (numBloques + 63) / 64;
+    if (numBloques % 64)
+        mascaraUltima = (UINT64_C(1) << (numBloques % 64)) - 1;
+
+    numRegiones = (numBloques + BLOQUES_REGION - 1) / BLOQUES_REGION;
+    libresRegion = Malloc(numRegiones * sizeof(atomic_size_t));
+    for (size_t r = 0; r < numRegiones; ++r)
+    {
+        size_t libres = 0;
+        for (size_t i = r * PALABRAS_REGION; i < (r + 1) * PALABRAS_REGION && i < numPalabras; ++i)
+            libres += 64 - __builtin_popcountll(_leerPalabra(i));
+
+        atomic_init(libresRegion + r, libres);
+    }
+
+    tamPagina = sysconf(_SC_PAGESIZE);
+    numPaginas = (numPalabras * sizeof(uint64_t) + tamPagina - 1) / tamPagina;
+    paginaSucia = Malloc(numPaginas * sizeof(atomic_bool));
+    for (size_t p = 0; p < numPaginas; ++p)
+        atomic_init(paginaSucia + p, false);
+
+    LISSANDRA_LOG_TRACE("BITMAP: %zu bloques en %zu regiones, %zu libres", numBloques, numRegiones, bitmap_libres());
+}
+
+bool bitmap_reservar(size_t* bloque)
+{
+    for (size_t r = 0; r < numRegiones; ++r)
+    {
+        if (!atomic_load_explicit(libresRegion + r, memory_order_relaxed))
+            continue;
+
+        for (size_t i = r * PALABRAS_REGION; i < (r + 1) * PALABRAS_REGION && i < numPalabras; ++i)
+        {
+            // otro hilo puede ganarme el bit, reintento con lo que quede libre en la palabra
+            uint64_t w;
+            while (~(w = _leerPalabra(i)))
+            {
+                size_t const candidato = i * 64 + __builtin_ctzll(~w);
+                if (_tomar(candidato))
+                {
+                    *bloque = candidato;
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+bool bitmap_reservar_contiguos(size_t n, size_t* bloques)
+{
+    if (!n)
+        return true;
+
+    size_t inicio = 0;
+    while (inicio + n <= totalBloques)
+    {
+        // primer tramo libre de n bloques a partir de inicio
+        size_t largo = 0;
+        size_t i = inicio;
+        while (i < totalBloques && largo < n)
+        {
+            // palabra o region completa ocupada: la salto entera
+            if (i % BLOQUES_REGION == 0 && !atomic_load_explicit(libresRegion + i / BLOQUES_REGION, memory_order_relaxed))
+            {
+                i += BLOQUES_REGION;
+                inicio = i;
+                largo = 0;
+                continue;
+            }
+
+            if (i % 64 == 0 && !~_leerPalabra(i / 64))
+            {
+                i += 64;
+                inicio = i;
+                largo = 0;
+                continue;
+            }
+
+            if (_leerPalabra(i / 64) & (UINT64_C(1) << (i % 64)))
+            {
+                inicio = i + 1;
+                largo = 0;
+            }
+            else
+                ++largo;
+
+            ++i;
+        }
+
+        if (largo < n)
+            return false;
+
+        // lo reclamo; si otro hilo tomo alguno en el medio, devuelvo lo tomado y sigo buscando despues de ese
+        size_t tomados = 0;
+        while (tomados < n && _tomar(inicio + tomados))
+        {
+            bloques[tomados] = inicio + tomados;
+            ++tomados;
+        }
+
+        if (tomados == n)
+            return true;
+
+        for (size_t j = 0; j < tomados; ++j)
+            _soltar(inicio + j);
+
+        inicio += tomados + 1;
+    }
+
+    return false;
+}
+
+void bitmap_marcar(size_t bloque, bool ocupado)
+{
+    if (ocupado)
+        _tomar(bloque);
+    else
+        _soltar(bloque);
+}
+
+size_t bitmap_libres(void)
+{
+    size_t libres = 0;
+    for (size_t r = 0; r < numRegiones; ++r)
+        libres += atomic_load_explicit(libresRegion + r, memory_order_relaxed);
+    return libres;
+}
+
+void bitmap_flush(void)
+{
+    // junto las paginas sucias consecutivas en un solo msync
+    char* const base = (char*) palabras;
+    size_t p = 0;
+    while (p < numPaginas)
+    {
+        if (!atomic_exchange(paginaSucia + p, false))
+        {
+            ++p;
+            continue;
+        }
+
+        size_t fin = p + 1;
+        while (fin < numPaginas && atomic_exchange(paginaSucia + fin, false))
+            ++fin;
+
+        if (msync(base + p * tamPagina, (fin - p) * tamPagina, MS_SYNC) < 0)
+            LISSANDRA_LOG_SYSERROR("msync");
+
+        p = fin;
+    }
+}
+
+void bitmap_destroy(void)
+{
+    Free(paginaSucia);
+    Free(libresRegion);
+    palabras = NULL;
+}
@@ -0,0 +1,36 @@
+
+#ifndef LISSANDRA_BITMAP_H
+#define LISSANDRA_BITMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Asignador de bloques sobre el mmap de Metadata/Bitmap.bin (bit i = bloque i, LSB primero).
+ *
+ * Sin lock global: cada bloque se toma o se libera con una operacion atomica sobre la palabra de 64 bits
+ * que lo contiene. El bitmap se divide en regiones con un contador de bloques libres, las regiones llenas
+ * se saltean sin mirar sus bits.
+ * Las paginas modificadas se marcan sucias y se bajan juntas en bitmap_flush (ver Durabilidad.h).
+ */
+
+// mapping tiene que cubrir el bitmap redondeado a multiplo de 8 bytes
+void bitmap_init(void* mapping, size_t numBloques);
+
+// reserva el primer bloque libre
+bool bitmap_reservar(size_t* bloque);
+
+// reserva n bloques consecutivos, o ninguno si no hay un tramo libre tan largo
+bool bitmap_reservar_contiguos(size_t n, size_t* bloques);
+
+// marca un bloque como ocupado o libre
+void bitmap_marcar(size_t bloque, bool ocupado);
+
+size_t bitmap_libres(void);
+
+// msync de las paginas modificadas desde el ultimo flush
+void bitmap_flush(void);
+
+void bitmap_destroy(void);
+
+#endif //LISSANDRA_BITMAP_H
@@ -2,6 +2,8 @@
 #include "CLIHandlers.h"
 #include "API.h"
 #include "Config.h"
+#include "Defragmentador.h"
+#include "Estadisticas.h"
 #include "LissandraLibrary.h"
 #include <Consistency.h>
 #include <ConsoleInput.h>
@@ -105,12 +107,12 @@ void HandleInsert(Vector const* args)
 void HandleCreate(Vector const* args)
 {
     //           cmd args
-    //           0      1       2          3            4
-    // sintaxis: CREATE <table> <consistency> <partitions> <compaction_time>
+    //           0      1       2          3            4                 5 (opcional)
+    // sintaxis: CREATE <table> <consistency> <partitions> <compaction_time> <ttl>
 
-    if (Vector_size(args) != 5)
+    if (Vector_size(args) != 5 && Vector_size(args) != 6)
     {
-        LISSANDRA_LOG_ERROR("CREATE: Uso - CREATE <tabla> <consistencia> <particiones> <tiempo entre compactaciones>");
+        LISSANDRA_LOG_ERROR("CREATE: Uso - CREATE <tabla> <consistencia> <particiones> <tiempo entre compactaciones> [TTL]");
         return;
     }
 
@@ -130,8 +132,9 @@ void HandleCreate(Vector const* args)
 
     uint32_t const parts = strtoul(partitions, NULL, 10);
     uint32_t const compTime = strtoul(compaction_time, NULL, 10);
+    uint32_t const ttl = Vector_size(args) == 6 ? strtoul(tokens[5], NULL, 10) : 0;
 
-    uint8_t resultadoCreate = api_create(table, ct, parts, compTime);
+    uint8_t resultadoCreate = api_create(table, ct, parts, compTime, ttl);
     if (resultadoCreate != EXIT_SUCCESS)
     {
         LISSANDRA_LOG_ERROR("No pude crear la tabla %s!", table);
@@ -149,6 +152,10 @@ static void _printDescribe(void* elem)
     LISSANDRA_LOG_INFO("Consistencia: %s", CriteriaString[elemento->consistency].String);
     LISSANDRA_LOG_INFO("Particiones: %u", elemento->partitions);
     LISSANDRA_LOG_INFO("Tiempo entre compactaciones: %u ms", elemento->compaction_time);
+    if (elemento->ttl)
+        LISSANDRA_LOG_INFO("TTL: %u ms (%" PRIu64 " registros expirados)", elemento->ttl, elemento->expirados);
+    if (elemento->pinned)
+        LISSANDRA_LOG_INFO("Fijada en memoria");
 }
 
 void HandleDescribe(Vector const* args)
@@ -220,3 +227,153 @@ void HandleDrop(Vector const* args)
 
     LISSANDRA_LOG_INFO("Se borro con exito la tabla: %s", table);
 }
+
+void HandleDelete(Vector const* args)
+{
+    //           cmd args
+    //           0      1       2     3 (opcional)
+    // sintaxis: DELETE <table> <key> <timestamp>
+
+    if (Vector_size(args) != 3 && Vector_size(args) != 4)
+    {
+        LISSANDRA_LOG_ERROR("DELETE: Uso - DELETE <table> <key> <timestamp>");
+        return;
+    }
+
+    char** const tokens = Vector_data(args);
+
+    char* const table = tokens[1];
+    char* const key = tokens[2];
+
+    if (!ValidateTableName(table))
+        return;
+
+    uint16_t k;
+    if (!ValidateKey(key, &k))
+        return;
+
+    uint64_t ts = GetMSEpoch();
+    if (Vector_size(args) == 4)
+        ts = strtoull(tokens[3], NULL, 10);
+
+    if (api_delete(table, k, ts) != EXIT_SUCCESS)
+    {
+        LISSANDRA_LOG_ERROR("No se pudo realizar el DELETE: la tabla ingresada no existe en el File System");
+        return;
+    }
+
+    LISSANDRA_LOG_INFO("Se completo DELETE de la key %hu en la tabla: %s", k, table);
+}
+
+void HandleRepartition(Vector const* args)
+{
+    //           cmd args
+    //           0           1       2
+    // sintaxis: REPARTITION <table> <partitions>
+
+    if (Vector_size(args) != 3)
+    {
+        LISSANDRA_LOG_ERROR("REPARTITION: Uso - REPARTITION <tabla> <particiones>");
+        return;
+    }
+
+    char** const tokens = Vector_data(args);
+
+    char* const table = tokens[1];
+    char* const partitions = tokens[2];
+
+    if (!ValidateTableName(table))
+        return;
+
+    uint32_t const parts = strtoul(partitions, NULL, 10);
+    if (!parts || parts > UINT16_MAX)
+    {
+        LISSANDRA_LOG_ERROR("REPARTITION: cantidad de particiones invalida: %s", partitions);
+        return;
+    }
+
+    if (api_repartition(table, parts) != EXIT_SUCCESS)
+        LISSANDRA_LOG_ERROR("No se pudo reparticionar la tabla: %s", table);
+}
+
+void HandleDefrag(Vector const* args)
+{
+    //           cmd args
+    //           0      1 (opcional)
+    // sintaxis: DEFRAG <table>
+
+    if (Vector_size(args) > 2)
+    {
+        LISSANDRA_LOG_ERROR("DEFRAG: Uso - DEFRAG [tabla]");
+        return;
+    }
+
+    char** const tokens = Vector_data(args);
+
+    char* table = NULL;
+    if (Vector_size(args) == 2)
+    {
+        table = tokens[1];
+        if (!ValidateTableName(table))
+            return;
+    }
+
+    defragmentar(table);
+}
+
+void HandleStats(Vector const* args)
+{
+    //           cmd args
+    //           0     1 (opcional)
+    // sintaxis: STATS <table>
+
+    if (Vector_size(args) > 2)
+    {
+        LISSANDRA_LOG_ERROR("STATS: Uso - STATS [tabla]");
+        return;
+    }
+
+    char** const tokens = Vector_data(args);
+
+    char* table = NULL;
+    if (Vector_size(args) == 2)
+    {
+        table = tokens[1];
+        if (!ValidateTableName(table))
+            return;
+    }
+
+    estadisticas_reporte(table);
+}
+
+static void _fijar(Vector const* args, char const* comando, bool fijar)
+{
+    //           cmd args
+    //           0         1
+    // sintaxis: PIN|UNPIN <table>
+
+    if (Vector_size(args) != 2)
+    {
+        LISSANDRA_LOG_ERROR("%s: Uso - %s <tabla>", comando, comando);
+        return;
+    }
+
+    char** const tokens = Vector_data(args);
+
+    char* const table = tokens[1];
+    if (!ValidateTableName(table))
+        return;
+
+    if (api_pin(table, fijar) != EXIT_SUCCESS)
+        LISSANDRA_LOG_ERROR("%s: no se pudo actualizar la tabla: %s", comando, table);
+}
+
+void HandlePin(Vector const* args)
+{
+    _fijar(args, "PIN", true);
+}
+
+void HandleUnpin(Vector const* args)
+{
+    _fijar(args, "UNPIN", false);
+}
@@ -9,5 +9,11 @@ CLICommandHandlerFn HandleInsert;
 CLICommandHandlerFn HandleCreate;
 CLICommandHandlerFn HandleDescribe;
 CLICommandHandlerFn HandleDrop;
+CLICommandHandlerFn HandleDelete;
+CLICommandHandlerFn HandleRepartition;
+CLICommandHandlerFn HandleDefrag;
+CLICommandHandlerFn HandleStats;
+CLICommandHandlerFn HandlePin;
+CLICommandHandlerFn HandleUnpin;
 
 #endif //LISSANDRA_CLIHANDLERS_H
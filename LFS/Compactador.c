@@ -1,30 +1,28 @@
 
 #include "Compactador.h"
 #include "Config.h"
+#include "Durabilidad.h"
+#include "Estadisticas.h"
+#include "KeyFilter.h"
 #include "LissandraLibrary.h"
-#include <ConsoleInput.h>
-#include <dirent.h>
+#include "Parser.h"
+#include "Snapshot.h"
+#include <inttypes.h>
 #include <libcommons/dictionary.h>
 #include <libcommons/hashmap.h>
-#include <libcommons/string.h>
 #include <Logger.h>
 #include <Malloc.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/file.h>
 #include <Timer.h>
 
-static void _escribirDiccionario(char const*, t_hashmap**, uint16_t);
-static void _convertirATmpc(char*);
+static void _escribirDiccionario(char const*, size_t, t_hashmap**, uint16_t);
+static void _leerArchivo(t_archivo const*, t_hashmap**, uint16_t);
 static void _guardarRegistroDiccionario(int, void*, void*);
-
-static bool _esTemporal(char const*, t_hashmap**, uint16_t);
-static bool _leerDatosTmpc(char const*, t_hashmap**, uint16_t);
-static bool _borrarTmpc(char const*, t_hashmap**, uint16_t);
-
-static bool _iterarDirectorioTabla(char*, bool(*)(char const*, t_hashmap**, uint16_t), t_hashmap**, uint16_t);
+static void _agregarClaveFiltro(int, void*, void*);
 
 static void* _hiloCompactador(void*);
 static void _terminarHilo(void*);
@@ -34,8 +32,30 @@ typedef struct
     pthread_t ThreadId;
     uint32_t TiempoCompactacion;
     char NombreTabla[NAME_MAX + 1];
+
+    // cantidad de particiones pedida por REPARTITION, 0 si no hay ninguna pendiente
+    atomic_uint ParticionesPendientes;
+
+    // registros vencidos (TTL) que ya no se reescribieron
+    _Atomic uint64_t Expirados;
 } HiloCompactador;
 
+typedef struct
+{
+    Vector* Contenido;
+
+    // los tombstones anteriores a este timestamp ya no se escriben
+    uint64_t LimiteTombstones;
+    size_t Purgados;
+
+    // con TTL, los registros anteriores a este timestamp estan vencidos. 0 si la tabla no tiene TTL
+    uint64_t LimiteTTL;
+    size_t Expirados;
+
+    // mayor timestamp de lo que se escribio
+    uint64_t TimestampMax;
+} ParticionCompactada;
+
 static t_dictionary* hilosCompactador = NULL;
 static pthread_mutex_t timersMutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -48,9 +68,18 @@ void agregarTablaCompactador(char const* nombreTabla, uint32_t tiempoCompactacio
 {
     pthread_mutex_lock(&timersMutex);
 
+    // el descubrimiento del arranque puede encontrar una tabla que ya agrego un CREATE
+    if (dictionary_has_key(hilosCompactador, nombreTabla))
+    {
+        pthread_mutex_unlock(&timersMutex);
+        return;
+    }
+
     HiloCompactador* new = Malloc(sizeof(HiloCompactador));
     new->TiempoCompactacion = tiempoCompactaciones;
     snprintf(new->NombreTabla, NAME_MAX + 1, "%s", nombreTabla);
+    atomic_init(&new->ParticionesPendientes, 0);
+    atomic_init(&new->Expirados, 0);
 
     pthread_create(&new->ThreadId, NULL, _hiloCompactador, new);
 
@@ -68,96 +97,123 @@ void quitarTablaCompactador(char const* nombreTabla)
     pthread_mutex_unlock(&timersMutex);
 }
 
-void compactar(char* nombreTabla)
+bool reparticionarTabla(char const* nombreTabla, uint16_t particiones)
 {
-    //los datos del struct en LissandraLibrary.h
-    t_describe infoTabla;
-    if (!get_table_metadata(nombreTabla, &infoTabla))
-        return;
+    pthread_mutex_lock(&timersMutex);
 
-    // no hay temporales? no compactamos nada!
-    if (!_iterarDirectorioTabla(nombreTabla, _esTemporal, NULL, 0))
-    {
-        LISSANDRA_LOG_TRACE("COMPACTADOR: Tabla '%s': no hay temporales. Nada para hacer.", nombreTabla);
-        return;
-    }
+    HiloCompactador* const hilo = dictionary_get(hilosCompactador, nombreTabla);
+    if (hilo)
+        atomic_store(&hilo->ParticionesPendientes, particiones);
 
-    char pathTabla[PATH_MAX];
-    generarPathTabla(nombreTabla, pathTabla);
+    pthread_mutex_unlock(&timersMutex);
+    return hilo != NULL;
+}
 
-    DIR* dir = opendir(pathTabla);
-    if (!dir)
+bool compactar(char* nombreTabla, uint16_t nuevasParticiones)
+{
+    uint64_t curTime = GetMSTime();
+    uint64_t const nsFlush = durabilidad_ns_hilo();
+    estadisticas_inicio();
+
+    // fijo la version a compactar, sus .tmp pasan a .tmpc. Los dumps que lleguen despues quedan afuera
+    // para reparticionar se compacta aunque no haya temporales
+    t_snapshot* base = snapshot_begin_compaction(nombreTabla, nuevasParticiones != 0);
+    if (!base)
     {
-        LISSANDRA_LOG_ERROR("COMPACTADOR: Directorio de tabla %s no encontrado... esto no deberia estar pasando!", nombreTabla);
-        return;
+        LISSANDRA_LOG_TRACE("COMPACTADOR: Tabla '%s': no hay temporales. Nada para hacer.", nombreTabla);
+        return true;
     }
 
-    uint64_t blockedTime = 0;
-    uint64_t curTime;
+    // los registros se redistribuyen segun la nueva cantidad, key % particiones
+    uint16_t const numParticiones = nuevasParticiones ? nuevasParticiones : base->NumParticiones;
+    t_hashmap* clavesCompactadas[numParticiones];
+    for (uint16_t i = 0; i < numParticiones; ++i)
+        clavesCompactadas[i] = hashmap_create();
 
-    // mini SC (renombre a .tmpc)
-    {
-        curTime = GetMSTime();
+    for (uint16_t i = 0; i < base->NumParticiones; ++i)
+        _leerArchivo(base->Particiones[i], clavesCompactadas, numParticiones);
 
-        flock(dirfd(dir), LOCK_EX);
-        _convertirATmpc(nombreTabla);
-        flock(dirfd(dir), LOCK_UN);
+    size_t const numTemporales = Vector_size(&base->Temporales);
+    t_archivo** const temporales = Vector_data(&base->Temporales);
+    for (size_t i = 0; i < numTemporales; ++i)
+        _leerArchivo(temporales[i], clavesCompactadas, numParticiones);
 
-        blockedTime += GetMSTimeDiff(curTime, GetMSTime());
-    }
+    // de cada key queda solo lo mas nuevo, lo que un DELETE tapaba ya se descarto al armar los diccionarios
+    // el tombstone se mantiene un tiempo de gracia, por si llega un INSERT atrasado de esa key
+    uint64_t const ahora = GetMSEpoch();
+    uint32_t const gracia = atomic_load(&confLFS.GRACIA_TOMBSTONE);
 
-    uint16_t const numParticiones = infoTabla.partitions;
-    t_hashmap* clavesCompactadas[numParticiones];
+    Vector particiones[numParticiones];
+    uint64_t timestampsMax[numParticiones];
+    size_t tombstonesPurgados = 0;
+    size_t expirados = 0;
     for (uint16_t i = 0; i < numParticiones; ++i)
     {
-        clavesCompactadas[i] = hashmap_create();
-
-        char pathParticion[PATH_MAX];
-        generarPathParticion(i, pathTabla, pathParticion);
-
-        char* contenido = leerArchivoLFS(pathParticion);
-        if (!contenido)
-            continue;
+        Vector_Construct(&particiones[i], sizeof(char), NULL, 0);
 
-        _escribirDiccionario(contenido, clavesCompactadas, numParticiones);
-        Free(contenido);
+        ParticionCompactada particion =
+        {
+            .Contenido = &particiones[i],
+            .LimiteTombstones = ahora > gracia ? ahora - gracia : 0,
+            .Purgados = 0,
+            .LimiteTTL = base->TTL && ahora > base->TTL ? ahora - base->TTL : 0,
+            .Expirados = 0,
+            .TimestampMax = 0
+        };
+        hashmap_iterate_with_data(clavesCompactadas[i], _guardarRegistroDiccionario, &particion);
+        timestampsMax[i] = particion.TimestampMax;
+        tombstonesPurgados += particion.Purgados;
+        expirados += particion.Expirados;
     }
 
-    _iterarDirectorioTabla(nombreTabla, _leerDatosTmpc, clavesCompactadas, numParticiones);
+    // publica la nueva version, los SELECT que tengan fijada la anterior siguen leyendo los bloques viejos
+    bool const ok = snapshot_commit_compaction(nombreTabla, base, particiones, timestampsMax, numParticiones);
 
-    // SC (bajada de nuevos .bin)
-    {
-        curTime = GetMSTime();
+    for (uint16_t i = 0; i < numParticiones; ++i)
+        Vector_Destruct(&particiones[i]);
 
-        flock(dirfd(dir), LOCK_EX);
+    // las claves compactadas siguen existiendo, el filtro tiene que reflejarlo aunque no se haya cargado aun
+    for (uint16_t i = 0; i < numParticiones; ++i)
+        hashmap_iterate_with_data(clavesCompactadas[i], _agregarClaveFiltro, nombreTabla);
 
-        _iterarDirectorioTabla(nombreTabla, _borrarTmpc, NULL, 0);
+    for (uint16_t i = 0; i < numParticiones; ++i)
+        hashmap_destroy_and_destroy_elements(clavesCompactadas[i], Free);
 
-        for (uint16_t i = 0; i < numParticiones; ++i)
-        {
-            Vector content;
-            Vector_Construct(&content, sizeof(char), NULL, 0);
+    if (!ok)
+    {
+        LISSANDRA_LOG_ERROR("COMPACTADOR: No se pudo publicar la compactación de '%s'. Se reintentara en la proxima.", nombreTabla);
+        return false;
+    }
 
-            hashmap_iterate_with_data(clavesCompactadas[i], _guardarRegistroDiccionario, &content);
+    if (expirados)
+    {
+        pthread_mutex_lock(&timersMutex);
 
-            char pathParticion[PATH_MAX];
-            generarPathParticion(i, pathTabla, pathParticion);
+        HiloCompactador* const hilo = dictionary_get(hilosCompactador, nombreTabla);
+        if (hilo)
+            atomic_fetch_add(&hilo->Expirados, expirados);
 
-            escribirArchivoLFS(pathParticion, Vector_data(&content), Vector_size(&content));
-            Vector_Destruct(&content);
-        }
+        pthread_mutex_unlock(&timersMutex);
+    }
 
-        flock(dirfd(dir), LOCK_UN);
+    estadisticas_fin(nombreTabla, OPERACION_COMPACTACION);
 
-        blockedTime += GetMSTimeDiff(curTime, GetMSTime());
-    }
+    LISSANDRA_LOG_DEBUG("COMPACTADOR: Compactación de '%s' terminada (%zu temporales, %hu particiones, %zu tombstones purgados, "
+                        "%zu registros expirados). Tiempo total: %" PRIu64 "ms (%" PRIu64 "us sincronizando a disco).",
+                        nombreTabla, numTemporales, numParticiones, tombstonesPurgados, expirados,
+                        GetMSTimeDiff(curTime, GetMSTime()), (durabilidad_ns_hilo() - nsFlush) / 1000);
+    return true;
+}
 
-    for (uint16_t i = 0; i < numParticiones; ++i)
-        hashmap_destroy_and_destroy_elements(clavesCompactadas[i], Free);
+uint64_t registrosExpiradosTabla(char const* nombreTabla)
+{
+    pthread_mutex_lock(&timersMutex);
 
-    closedir(dir);
+    HiloCompactador* const hilo = dictionary_get(hilosCompactador, nombreTabla);
+    uint64_t const expirados = hilo ? atomic_load(&hilo->Expirados) : 0;
 
-    LISSANDRA_LOG_DEBUG("COMPACTADOR: Compactación de '%s' terminada. Tiempo bloqueo: %" PRIu64 "ms.", nombreTabla, blockedTime);
+    pthread_mutex_unlock(&timersMutex);
+    return expirados;
 }
 
 void terminarCompactador(void)
@@ -168,10 +224,21 @@ void terminarCompactador(void)
 static void* _hiloCompactador(void* hiloCompactador)
 {
     HiloCompactador* const hilo = hiloCompactador;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
     while (true)
     {
+        // solo se puede cancelar durmiendo: cancelar a mitad de una compactacion dejaria locks tomados
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
         MSSleep(hilo->TiempoCompactacion);
-        compactar(hilo->NombreTabla);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+        uint16_t const particiones = atomic_exchange(&hilo->ParticionesPendientes, 0);
+        if (!compactar(hilo->NombreTabla, particiones) && particiones)
+        {
+            // reintento el reparticionado en el proximo ciclo, salvo que hayan pedido otro mientras tanto
+            unsigned ninguno = 0;
+            atomic_compare_exchange_strong(&hilo->ParticionesPendientes, &ninguno, particiones);
+        }
     }
 
     return NULL;
@@ -190,141 +257,89 @@ static void _terminarHilo(void* value)
     Free(hilo);
 }
 
-static void _escribirDiccionario(char const* contenido, t_hashmap** diccionarios, uint16_t numParticiones)
+static void _escribirDiccionario(char const* contenido, size_t len, t_hashmap** diccionarios, uint16_t numParticiones)
 {
-    Vector registros = string_split(contenido, "\n");
+    t_parser parser;
+    parser_init(&parser, contenido, len);
 
-    char** const tokens = Vector_data(&registros);
-    for (size_t i = 0; i < Vector_size(&registros); ++i)
+    t_vista_registro registro;
+    while (parser_next(&parser, &registro))
     {
-        char* const registro = tokens[i];
-
-        Vector campos = string_split(registro, ";");
-        // timestamp;key;value
-        char** const fields = Vector_data(&campos);
-        uint64_t const timestamp = strtoull(fields[0], NULL, 10);
-
-        uint16_t keyRegistro;
-        if (!ValidateKey(fields[1], &keyRegistro))
-        {
-            LISSANDRA_LOG_ERROR("Error! clave invalida %s en archivo!!", fields[1]);
-            Vector_Destruct(&campos);
-            continue;
-        }
-
-        uint16_t const particion = get_particion(numParticiones, keyRegistro);
+        uint16_t const particion = get_particion(numParticiones, registro.Key);
         t_hashmap* const diccionario = diccionarios[particion];
 
-        char* const value = fields[2];
-        t_registro* entradaDiccionario = hashmap_get(diccionario, keyRegistro);
+        t_registro* entradaDiccionario = hashmap_get(diccionario, registro.Key);
         if (!entradaDiccionario)
         {
             entradaDiccionario = Malloc(REGISTRO_SIZE);
 
-            entradaDiccionario->key = keyRegistro;
-            entradaDiccionario->timestamp = timestamp;
-            strncpy(entradaDiccionario->value, value, confLFS.TAMANIO_VALUE + 1);
+            entradaDiccionario->key = registro.Key;
+            entradaDiccionario->timestamp = registro.Timestamp;
+            entradaDiccionario->tombstone = registro.Tombstone;
+            parser_copiar_value(&registro, entradaDiccionario->value, confLFS.TAMANIO_VALUE);
 
-            hashmap_put(diccionario, keyRegistro, entradaDiccionario);
+            hashmap_put(diccionario, registro.Key, entradaDiccionario);
         }
-        else if (entradaDiccionario->timestamp < timestamp)
+        else if (entradaDiccionario->timestamp < registro.Timestamp)
         {
-            entradaDiccionario->timestamp = timestamp;
-            strncpy(entradaDiccionario->value, value, confLFS.TAMANIO_VALUE + 1);
+            entradaDiccionario->timestamp = registro.Timestamp;
+            entradaDiccionario->tombstone = registro.Tombstone;
+            parser_copiar_value(&registro, entradaDiccionario->value, confLFS.TAMANIO_VALUE);
         }
-
-        Vector_Destruct(&campos);
     }
 
-    Vector_Destruct(&registros);
+    estadisticas_parseados(len, parser.Lineas);
 }
 
-static bool _iterarDirectorioTabla(char* tabla, bool(*funcion)(char const*, t_hashmap**, uint16_t), t_hashmap** diccs, uint16_t numParticiones)
+static void _leerArchivo(t_archivo const* archivo, t_hashmap** diccionarios, uint16_t numParticiones)
 {
-    char pathTabla[PATH_MAX];
-    generarPathTabla(tabla, pathTabla);
-
-    bool result = false;
-    struct dirent* entry;
-
-    DIR* dir = opendir(pathTabla);
-    if (!dir)
-        return false;
-
-    while ((entry = readdir(dir)))
-    {
-        char pathCompleto[PATH_MAX];
-        snprintf(pathCompleto, PATH_MAX, "%s/%s", pathTabla, entry->d_name);
-
-        result = funcion(pathCompleto, diccs, numParticiones) || result;
-    }
-    closedir(dir);
+    char* contenido = snapshot_leer_archivo(archivo);
+    if (!contenido)
+        return;
 
-    return result;
+    _escribirDiccionario(contenido, archivo->Size, diccionarios, numParticiones);
+    Free(contenido);
 }
 
-static bool _renombrarArchivoATmpc(char const* path, t_hashmap** _, uint16_t __)
+static void _guardarRegistroDiccionario(int key, void* value, void* particionCompactada)
 {
-    (void) _;
-    (void) __;
+    t_registro* const registro = value;
+    ParticionCompactada* const particion = particionCompactada;
 
-    if (string_ends_with(path, ".tmp"))
+    // ya no hay nada mas viejo que tapar
+    if (registro->tombstone && registro->timestamp < particion->LimiteTombstones)
     {
-        char pathNuevoTemp[PATH_MAX];
-        snprintf(pathNuevoTemp, PATH_MAX, "%sc", path);
-
-        rename(path, pathNuevoTemp);
+        ++particion->Purgados;
+        return;
     }
 
-    return true;
-}
-
-static void _convertirATmpc(char* tabla)
-{
-    _iterarDirectorioTabla(tabla, _renombrarArchivoATmpc, NULL, 0);
-}
-
-static bool _esTemporal(char const* path, t_hashmap** _, uint16_t __)
-{
-    (void) _;
-    (void) __;
-
-    return string_ends_with(path, ".tmp");
-}
-
-static bool _leerDatosTmpc(char const* path, t_hashmap** diccionarios, uint16_t numParticiones)
-{
-    if (!string_ends_with(path, ".tmpc"))
-        return false;
-
-    char* contenido = leerArchivoLFS(path);
-    if (!contenido)
-        return false;
-
-    _escribirDiccionario(contenido, diccionarios, numParticiones);
-    Free(contenido);
-
-    return true;
-}
-
-static bool _borrarTmpc(char const* path, t_hashmap** _, uint16_t __)
-{
-    (void) _;
-    (void) __;
+    // vencido: los SELECT ya no lo ven, y lo que tapaba es aun mas viejo
+    if (registro->timestamp < particion->LimiteTTL)
+    {
+        if (!registro->tombstone)
+            ++particion->Expirados;
+        return;
+    }
 
-    if (!string_ends_with(path, ".tmpc"))
-        return false;
+    if (registro->timestamp > particion->TimestampMax)
+        particion->TimestampMax = registro->timestamp;
 
-    borrarArchivoLFS(path);
-    return true;
+    size_t const len = registro->tombstone ?
+        (size_t) snprintf(NULL, 0, "%" PRIu64 ";%d\n", registro->timestamp, key) :
+        (size_t) snprintf(NULL, 0, "%" PRIu64 ";%d;%s\n", registro->timestamp, key, registro->value);
+    char field[len + 1];
+    if (registro->tombstone)
+        snprintf(field, len + 1, "%" PRIu64 ";%d\n", registro->timestamp, key);
+    else
+        snprintf(field, len + 1, "%" PRIu64 ";%d;%s\n", registro->timestamp, key, registro->value);
+    Vector_insert_range(particion->Contenido, Vector_size(particion->Contenido), field, field + len);
 }
 
-static void _guardarRegistroDiccionario(int key, void* value, void* content)
+static void _agregarClaveFiltro(int key, void* value, void* nombreTabla)
 {
     t_registro* const registro = value;
+    if (registro->tombstone)
+        return;
 
-    size_t len = snprintf(NULL, 0, "%llu;%d;%s\n", registro->timestamp, key, registro->value);
-    char field[len + 1];
-    snprintf(field, len + 1, "%llu;%d;%s\n", registro->timestamp, key, registro->value);
-    Vector_insert_range(content, Vector_size(content), field, field + len);
+    keyfilter_add(nombreTabla, (uint16_t) key);
 }
@@ -2,6 +2,7 @@
 #ifndef LISSANDRA_COMPACTADOR_H
 #define LISSANDRA_COMPACTADOR_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 //funciones para manejo Compactacion
@@ -11,7 +12,16 @@ void agregarTablaCompactador(char const* nombreTabla, uint32_t tiempoCompactacio
 
 void quitarTablaCompactador(char const* nombreTabla);
 
-void compactar(char* nombreTabla);
+// compacta los temporales de la tabla en sus particiones
+// si nuevasParticiones no es 0 reescribe la tabla con esa cantidad de particiones
+bool compactar(char* nombreTabla, uint16_t nuevasParticiones);
+
+// pide reescribir la tabla con otra cantidad de particiones en la proxima compactacion
+// false si la tabla no existe
+bool reparticionarTabla(char const* nombreTabla, uint16_t particiones);
+
+// registros descartados por TTL en las compactaciones de la tabla desde el arranque
+uint64_t registrosExpiradosTabla(char const* nombreTabla);
 
 void terminarCompactador(void);
 
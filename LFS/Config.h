@@ -15,9 +15,24 @@ typedef struct
     size_t TAMANIO_BLOQUES;
     size_t CANTIDAD_BLOQUES;
 
+    // WALMode, ver WAL.h
+    uint8_t MODO_WAL;
+    uint32_t VENTANA_WAL_US;
+
+    // DurabilidadMode, ver Durabilidad.h
+    uint8_t DURABILIDAD;
+
     // Campos recargables en runtime
     _Atomic uint32_t RETARDO;
     uint32_t TIEMPO_DUMP;
+    uint32_t TIEMPO_DEFRAG;
+
+    // milisegundos que un tombstone sobrevive a las compactaciones
+    _Atomic uint32_t GRACIA_TOMBSTONE;
+
+    // cada cuanto se guardan las estadisticas (0 no se guardan) y donde
+    uint32_t TIEMPO_ESTADISTICAS;
+    char ARCHIVO_ESTADISTICAS[PATH_MAX];
 } t_config_FS;
 
 extern t_config_FS confLFS;
@@ -0,0 +1,75 @@
+
+#include "Defragmentador.h"
+#include "Config.h"
+#include "LissandraLibrary.h"
+#include "Snapshot.h"
+#include <dirent.h>
+#include <Logger.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <Timer.h>
+
+// no tiene sentido correr dos pasadas a la vez (ej: la periodica y una pedida por consola)
+static atomic_flag enCurso = ATOMIC_FLAG_INIT;
+
+static void _logFragmentacion(char const* momento, t_fragmentacion const* f)
+{
+    double const extensionesPorArchivo = f->Archivos ? (double) f->Extensiones / f->Archivos : 0.0;
+    LISSANDRA_LOG_INFO("DEFRAG: %s: %zu archivos, %zu bloques, %zu extensiones (%.2f por archivo), %zu archivos fragmentados",
+                       momento, f->Archivos, f->Bloques, f->Extensiones, extensionesPorArchivo, f->Fragmentados);
+}
+
+void defragmentar(char const* nombreTabla)
+{
+    if (atomic_flag_test_and_set(&enCurso))
+    {
+        LISSANDRA_LOG_INFO("DEFRAG: ya hay una desfragmentacion en curso");
+        return;
+    }
+
+    uint64_t const inicio = GetMSTime();
+
+    t_fragmentacion antes = { 0 };
+    t_fragmentacion despues = { 0 };
+    if (nombreTabla)
+        snapshot_defragmentar(nombreTabla, true, &antes, &despues);
+    else
+    {
+        char pathTablas[PATH_MAX];
+        DIR* dir = NULL;
+        if (snprintf(pathTablas, PATH_MAX, "%sTables", confLFS.PUNTO_MONTAJE) >= PATH_MAX)
+            LISSANDRA_LOG_ERROR("DEFRAG: el punto de montaje %s es demasiado largo!", confLFS.PUNTO_MONTAJE);
+        else
+            dir = opendir(pathTablas);
+
+        if (dir)
+        {
+            struct dirent* entry;
+            while ((entry = readdir(dir)))
+            {
+                if (*entry->d_name == '.')
+                    continue;
+
+                // cargar cada tabla para desfragmentarla desharia la carga diferida del arranque
+                snapshot_defragmentar(entry->d_name, false, &antes, &despues);
+            }
+
+            closedir(dir);
+        }
+    }
+
+    _logFragmentacion("antes", &antes);
+    _logFragmentacion("despues", &despues);
+    LISSANDRA_LOG_INFO("DEFRAG: %zu archivos reubicados en %" PRIu64 "ms", antes.Fragmentados - despues.Fragmentados,
+                       GetMSTimeDiff(inicio, GetMSTime()));
+
+    atomic_flag_clear(&enCurso);
+}
+
+void* defragmentador_thread(void* pt)
+{
+    defragmentar(NULL);
+
+    PeriodicTimer_SetEnabled(pt, true);
+    return NULL;
+}
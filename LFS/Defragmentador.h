@@ -0,0 +1,19 @@
+
+#ifndef LISSANDRA_DEFRAGMENTADOR_H
+#define LISSANDRA_DEFRAGMENTADOR_H
+
+/*
+ * Desfragmentador de bloques.
+ * Con el tiempo los BLOCKS de cada archivo quedan dispersos por el bitmap y leer una particion implica abrir
+ * bloques salteados. El desfragmentador copia cada archivo fragmentado a un tramo de bloques consecutivos y
+ * publica una nueva version de la tabla (ver Snapshot.h), sin frenar a los SELECT.
+ * Se corre cada TIEMPO_DEFRAG ms (0 = deshabilitado) o a mano con el comando DEFRAG. La pasada periodica solo
+ * toma las tablas que ya se cargaron.
+ */
+
+// desfragmenta la tabla indicada, o todas si es NULL, y loguea la fragmentacion antes y despues
+void defragmentar(char const* nombreTabla);
+
+void* defragmentador_thread(void*);
+
+#endif //LISSANDRA_DEFRAGMENTADOR_H
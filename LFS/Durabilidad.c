@@ -0,0 +1,305 @@
+
+#include "Durabilidad.h"
+#include "Bitmap.h"
+#include "Config.h"
+#include "LissandraLibrary.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <Logger.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <Timer.h>
+#include <unistd.h>
+#include <vector.h>
+
+static char const* const NombresFlush[NUM_FLUSH] =
+{
+    "bloques",
+    "bitmap",
+    "metadata",
+    "directorios",
+    "lotes"
+};
+
+// lo escrito desde el ultimo flush, solo en BATCH. Los bloques por numero (su mapping y su fd ya no existen),
+// la metadata por un dup de su fd
+static Vector bloquesLote;
+static Vector metadataLote;
+static pthread_mutex_t listaMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// serializa los flush del lote: quien encuentra el lote vacio igual espera a que termine el flush que lo vacio
+static pthread_mutex_t loteMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static struct
+{
+    _Atomic uint64_t Cantidad;
+    _Atomic uint64_t TotalNs;
+    _Atomic uint64_t MaxNs;
+} latencias[NUM_FLUSH];
+
+static _Thread_local uint64_t nsHilo = 0;
+
+static void _registrar(TipoFlush tipo, uint64_t inicio)
+{
+    uint64_t const ns = GetNSTime() - inicio;
+    nsHilo += ns;
+
+    atomic_fetch_add_explicit(&latencias[tipo].Cantidad, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&latencias[tipo].TotalNs, ns, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&latencias[tipo].MaxNs, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&latencias[tipo].MaxNs, &max, ns,
+                                                              memory_order_relaxed, memory_order_relaxed));
+}
+
+static void _agregarAlLote(Vector* lote, void const* elem)
+{
+    pthread_mutex_lock(&listaMutex);
+    Vector_push_back(lote, elem);
+    pthread_mutex_unlock(&listaMutex);
+}
+
+static void _tomarLote(Vector* lote, Vector* destino)
+{
+    // destino vacio, se lleva lo acumulado
+    pthread_mutex_lock(&listaMutex);
+    Vector_swap(lote, destino);
+    pthread_mutex_unlock(&listaMutex);
+}
+
+static void _syncBloques(void)
+{
+    Vector bloques;
+    Vector_Construct(&bloques, sizeof(size_t), NULL, 0);
+
+    pthread_mutex_lock(&loteMutex);
+    _tomarLote(&bloquesLote, &bloques);
+    if (!Vector_empty(&bloques))
+    {
+        // las paginas que se escribieron por el mapping quedan sucias en el archivo despues del munmap
+        uint64_t const inicio = GetNSTime();
+        size_t const* const numeros = Vector_data(&bloques);
+        for (size_t i = 0; i < Vector_size(&bloques); ++i)
+        {
+            char pathBloque[PATH_MAX];
+            generarPathBloque(numeros[i], pathBloque);
+
+            int const fd = open(pathBloque, O_RDONLY);
+            if (fd < 0)
+            {
+                LISSANDRA_LOG_SYSERROR("open");
+                continue;
+            }
+
+            if (fdatasync(fd) < 0)
+                LISSANDRA_LOG_SYSERROR("fdatasync");
+            close(fd);
+        }
+        _registrar(FLUSH_LOTE, inicio);
+    }
+    pthread_mutex_unlock(&loteMutex);
+
+    Vector_Destruct(&bloques);
+}
+
+static void _syncMetadata(void)
+{
+    Vector fds;
+    Vector_Construct(&fds, sizeof(int), NULL, 0);
+
+    pthread_mutex_lock(&loteMutex);
+    _tomarLote(&metadataLote, &fds);
+    if (!Vector_empty(&fds))
+    {
+        uint64_t const inicio = GetNSTime();
+        int const* const archivos = Vector_data(&fds);
+        for (size_t i = 0; i < Vector_size(&fds); ++i)
+        {
+            if (fdatasync(archivos[i]) < 0)
+                LISSANDRA_LOG_SYSERROR("fdatasync");
+            close(archivos[i]);
+        }
+        _registrar(FLUSH_METADATA, inicio);
+    }
+    pthread_mutex_unlock(&loteMutex);
+
+    Vector_Destruct(&fds);
+}
+
+static void _syncDirectorio(char const* pathDir)
+{
+    int const fd = open(pathDir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        LISSANDRA_LOG_SYSERROR("open");
+        return;
+    }
+
+    uint64_t const inicio = GetNSTime();
+    if (fsync(fd) < 0)
+        LISSANDRA_LOG_SYSERROR("fsync");
+    _registrar(FLUSH_DIRECTORIO, inicio);
+
+    close(fd);
+}
+
+static void _syncBitmap(void)
+{
+    uint64_t const inicio = GetNSTime();
+    bitmap_flush();
+    _registrar(FLUSH_BITMAP, inicio);
+}
+
+bool durabilidad_modo_desde_string(char const* modo, uint8_t* resultado)
+{
+    static char const* const modos[] = { "NONE", "BATCH", "STRICT" };
+    for (uint8_t i = 0; i < sizeof modos / sizeof *modos; ++i)
+    {
+        if (!strcmp(modo, modos[i]))
+        {
+            *resultado = i;
+            return true;
+        }
+    }
+
+    LISSANDRA_LOG_ERROR("Modo de durabilidad invalido: %s (NONE, BATCH o STRICT)", modo);
+    return false;
+}
+
+void durabilidad_init(void)
+{
+    Vector_Construct(&bloquesLote, sizeof(size_t), NULL, 0);
+    Vector_Construct(&metadataLote, sizeof(int), NULL, 0);
+}
+
+void durabilidad_bloque_escrito(size_t bloque, void* mapping, size_t len)
+{
+    switch (confLFS.DURABILIDAD)
+    {
+        case DURABILIDAD_BATCH:
+            _agregarAlLote(&bloquesLote, &bloque);
+            break;
+        case DURABILIDAD_STRICT:
+        {
+            uint64_t const inicio = GetNSTime();
+            if (msync(mapping, len, MS_SYNC) < 0)
+                LISSANDRA_LOG_SYSERROR("msync");
+            _registrar(FLUSH_BLOQUE, inicio);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void durabilidad_metadata_escrita(int fd)
+{
+    switch (confLFS.DURABILIDAD)
+    {
+        case DURABILIDAD_BATCH:
+        {
+            // el archivo se cierra enseguida, el lote se queda con una copia del fd
+            int const copia = dup(fd);
+            if (copia < 0)
+                LISSANDRA_LOG_SYSERROR("dup");
+            else
+                _agregarAlLote(&metadataLote, &copia);
+            break;
+        }
+        case DURABILIDAD_STRICT:
+        {
+            uint64_t const inicio = GetNSTime();
+            if (fdatasync(fd) < 0)
+                LISSANDRA_LOG_SYSERROR("fdatasync");
+            _registrar(FLUSH_METADATA, inicio);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void durabilidad_barrera(void)
+{
+    switch (confLFS.DURABILIDAD)
+    {
+        case DURABILIDAD_BATCH:
+            // baja los bloques del lote, propios o de otra operacion en curso
+            _syncBloques();
+            _syncBitmap();
+            break;
+        case DURABILIDAD_STRICT:
+            // los bloques ya se sincronizaron al escribirlos
+            _syncBitmap();
+            break;
+        default:
+            break;
+    }
+}
+
+void durabilidad_confirmar(char const* pathDir)
+{
+    switch (confLFS.DURABILIDAD)
+    {
+        case DURABILIDAD_BATCH:
+            // la metadata del lote y despues las entradas creadas o renombradas en el directorio
+            _syncMetadata();
+            _syncDirectorio(pathDir);
+            break;
+        case DURABILIDAD_STRICT:
+            _syncDirectorio(pathDir);
+            break;
+        default:
+            break;
+    }
+}
+
+uint64_t durabilidad_ns_hilo(void)
+{
+    return nsHilo;
+}
+
+void durabilidad_stats(t_latencia_flush stats[NUM_FLUSH])
+{
+    for (uint8_t i = 0; i < NUM_FLUSH; ++i)
+    {
+        stats[i].Cantidad = atomic_load_explicit(&latencias[i].Cantidad, memory_order_relaxed);
+        stats[i].TotalNs = atomic_load_explicit(&latencias[i].TotalNs, memory_order_relaxed);
+        stats[i].MaxNs = atomic_load_explicit(&latencias[i].MaxNs, memory_order_relaxed);
+    }
+}
+
+void durabilidad_reporte(void)
+{
+    t_latencia_flush stats[NUM_FLUSH];
+    durabilidad_stats(stats);
+
+    for (uint8_t i = 0; i < NUM_FLUSH; ++i)
+    {
+        if (!stats[i].Cantidad)
+            continue;
+
+        LISSANDRA_LOG_INFO("DURABILIDAD: flush de %s: %llu, promedio %lluus, maximo %lluus", NombresFlush[i],
+                           (unsigned long long) stats[i].Cantidad,
+                           (unsigned long long) (stats[i].TotalNs / stats[i].Cantidad / 1000),
+                           (unsigned long long) (stats[i].MaxNs / 1000));
+    }
+}
+
+void durabilidad_destroy(void)
+{
+    // lo que haya quedado de un lote
+    if (confLFS.DURABILIDAD != DURABILIDAD_NONE)
+    {
+        durabilidad_barrera();
+        durabilidad_confirmar(confLFS.PUNTO_MONTAJE);
+    }
+
+    durabilidad_reporte();
+
+    Vector_Destruct(&bloquesLote);
+    Vector_Destruct(&metadataLote);
+}
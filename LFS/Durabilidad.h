@@ -0,0 +1,71 @@
+
+#ifndef LISSANDRA_DURABILIDAD_H
+#define LISSANDRA_DURABILIDAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Politica de durabilidad de las escrituras al FS (DURABILIDAD en la config).
+ *
+ * El orden que se respeta en todos los modos es bloques -> bitmap -> metadata: la metadata que apunta a
+ * unos bloques no llega a disco antes que su contenido ni antes de que el bitmap los marque como ocupados.
+ *
+ *  NONE:   no se sincroniza nada, el kernel escribe cuando quiere
+ *  BATCH:  los bloques y la metadata escritos se anotan y se sincronizan por lote: en la barrera de cada dump o
+ *          compactacion los bloques anotados y el bitmap, al confirmar la metadata anotada y el directorio
+ *  STRICT: msync de cada bloque al escribirlo, fdatasync de cada archivo de metadata y fsync del directorio
+ */
+
+typedef enum
+{
+    DURABILIDAD_NONE,
+    DURABILIDAD_BATCH,
+    DURABILIDAD_STRICT
+} DurabilidadMode;
+
+typedef enum
+{
+    FLUSH_BLOQUE,
+    FLUSH_BITMAP,
+    FLUSH_METADATA,
+    FLUSH_DIRECTORIO,
+    FLUSH_LOTE,
+
+    NUM_FLUSH
+} TipoFlush;
+
+typedef struct
+{
+    uint64_t Cantidad;
+    uint64_t TotalNs;
+    uint64_t MaxNs;
+} t_latencia_flush;
+
+bool durabilidad_modo_desde_string(char const* modo, uint8_t* resultado);
+
+void durabilidad_init(void);
+
+// llamar con el bloque todavia mapeado, antes del munmap
+void durabilidad_bloque_escrito(size_t bloque, void* mapping, size_t len);
+
+// llamar antes del fclose de un archivo de metadata
+void durabilidad_metadata_escrita(int fd);
+
+// llamar despues de escribir los bloques de una operacion y antes de escribir la metadata que los referencia
+void durabilidad_barrera(void);
+
+// llamar al terminar una operacion, despues de crear o renombrar su metadata dentro de pathDir
+void durabilidad_confirmar(char const* pathDir);
+
+// nanosegundos que el hilo actual lleva esperando flushes, para medir una operacion por diferencia
+uint64_t durabilidad_ns_hilo(void);
+
+void durabilidad_stats(t_latencia_flush stats[NUM_FLUSH]);
+
+void durabilidad_reporte(void);
+
+void durabilidad_destroy(void);
+
+#endif //LISSANDRA_DURABILIDAD_H
@@ -0,0 +1,355 @@
+
+#include "Estadisticas.h"
+#include "Bitmap.h"
+#include "Durabilidad.h"
+#include <inttypes.h>
+#include <libcommons/dictionary.h>
+#include <limits.h>
+#include <Logger.h>
+#include <Malloc.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <Timer.h>
+
+// bucket i: latencias en [2^i, 2^(i+1)) microsegundos, el 0 incluye las menores a 1us y el ultimo todo lo demas
+#define NUM_BUCKETS 32
+
+static char const* const NombresOperacion[NUM_OPERACIONES] =
+{
+    "SELECT",
+    "INSERT",
+    "DUMP",
+    "COMPACTACION"
+};
+
+typedef struct
+{
+    uint64_t ArchivosAbiertos;
+    uint64_t BloquesLeidos;
+    uint64_t BytesParseados;
+    uint64_t BytesEscritos;
+    uint64_t RegistrosExaminados;
+    uint64_t EsperaLockNs;
+} t_costo;
+
+typedef struct
+{
+    _Atomic uint64_t Cantidad;
+    _Atomic uint64_t ArchivosAbiertos;
+    _Atomic uint64_t BloquesLeidos;
+    _Atomic uint64_t BytesParseados;
+    _Atomic uint64_t BytesEscritos;
+    _Atomic uint64_t RegistrosExaminados;
+    _Atomic uint64_t EsperaLockNs;
+    _Atomic uint64_t LatenciaNs;
+    _Atomic uint64_t LatenciaMaxNs;
+    _Atomic uint64_t Histograma[NUM_BUCKETS];
+} t_contadores;
+
+typedef struct
+{
+    t_contadores Operaciones[NUM_OPERACIONES];
+} t_estadisticas_tabla;
+
+// copia de los contadores de una operacion, para reportar
+typedef struct
+{
+    uint64_t Cantidad;
+    t_costo Costo;
+    uint64_t LatenciaNs;
+    uint64_t LatenciaMaxNs;
+    uint64_t P50Us;
+    uint64_t P90Us;
+    uint64_t P99Us;
+} t_resumen;
+
+// mapa nombreTabla->t_estadisticas_tabla, las entradas no se liberan mientras se tenga el lock de lectura
+static t_dictionary* tablas = NULL;
+static pthread_rwlock_t tablasLock = PTHREAD_RWLOCK_INITIALIZER;
+
+static _Thread_local t_costo costoHilo;
+static _Thread_local uint64_t inicioHilo = 0;
+
+static inline void _sumar(_Atomic uint64_t* contador, uint64_t valor)
+{
+    if (valor)
+        atomic_fetch_add_explicit(contador, valor, memory_order_relaxed);
+}
+
+static inline uint64_t _leer(_Atomic uint64_t const* contador)
+{
+    return atomic_load_explicit(contador, memory_order_relaxed);
+}
+
+static inline size_t _bucket(uint64_t ns)
+{
+    uint64_t const us = ns / 1000;
+    if (!us)
+        return 0;
+
+    size_t const b = 63 - __builtin_clzll(us);
+    return b < NUM_BUCKETS ? b : NUM_BUCKETS - 1;
+}
+
+// cota superior del bucket donde cae el percentil pedido
+static uint64_t _percentil(uint64_t const histograma[NUM_BUCKETS], uint64_t cantidad, unsigned percentil)
+{
+    uint64_t const objetivo = (cantidad * percentil + 99) / 100;
+
+    uint64_t acumulado = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i)
+    {
+        acumulado += histograma[i];
+        if (acumulado >= objetivo)
+            return UINT64_C(1) << (i + 1);
+    }
+
+    return UINT64_C(1) << NUM_BUCKETS;
+}
+
+static void _resumir(t_contadores const* c, t_resumen* r)
+{
+    r->Cantidad = _leer(&c->Cantidad);
+    r->Costo.ArchivosAbiertos = _leer(&c->ArchivosAbiertos);
+    r->Costo.BloquesLeidos = _leer(&c->BloquesLeidos);
+    r->Costo.BytesParseados = _leer(&c->BytesParseados);
+    r->Costo.BytesEscritos = _leer(&c->BytesEscritos);
+    r->Costo.RegistrosExaminados = _leer(&c->RegistrosExaminados);
+    r->Costo.EsperaLockNs = _leer(&c->EsperaLockNs);
+    r->LatenciaNs = _leer(&c->LatenciaNs);
+    r->LatenciaMaxNs = _leer(&c->LatenciaMaxNs);
+
+    uint64_t histograma[NUM_BUCKETS];
+    uint64_t total = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i)
+    {
+        histograma[i] = _leer(&c->Histograma[i]);
+        total += histograma[i];
+    }
+
+    // el histograma se lee sin frenar a nadie, puede no coincidir justo con Cantidad
+    r->P50Us = total ? _percentil(histograma, total, 50) : 0;
+    r->P90Us = total ? _percentil(histograma, total, 90) : 0;
+    r->P99Us = total ? _percentil(histograma, total, 99) : 0;
+}
+
+void estadisticas_init(void)
+{
+    tablas = dictionary_create();
+}
+
+void estadisticas_inicio(void)
+{
+    memset(&costoHilo, 0, sizeof costoHilo);
+    inicioHilo = GetNSTime();
+}
+
+void estadisticas_fin(char const* nombreTabla, OperacionLFS operacion)
+{
+    uint64_t const latencia = GetNSTime() - inicioHilo;
+
+    pthread_rwlock_rdlock(&tablasLock);
+
+    // solo tablas agregadas: una operacion que termina despues del DROP no la vuelve a crear
+    t_estadisticas_tabla* const tabla = dictionary_get(tablas, nombreTabla);
+    if (tabla)
+    {
+        t_contadores* const c = &tabla->Operaciones[operacion];
+        _sumar(&c->Cantidad, 1);
+        _sumar(&c->ArchivosAbiertos, costoHilo.ArchivosAbiertos);
+        _sumar(&c->BloquesLeidos, costoHilo.BloquesLeidos);
+        _sumar(&c->BytesParseados, costoHilo.BytesParseados);
+        _sumar(&c->BytesEscritos, costoHilo.BytesEscritos);
+        _sumar(&c->RegistrosExaminados, costoHilo.RegistrosExaminados);
+        _sumar(&c->EsperaLockNs, costoHilo.EsperaLockNs);
+        _sumar(&c->LatenciaNs, latencia);
+        _sumar(&c->Histograma[_bucket(latencia)], 1);
+
+        uint64_t max = _leer(&c->LatenciaMaxNs);
+        while (latencia > max && !atomic_compare_exchange_weak_explicit(&c->LatenciaMaxNs, &max, latencia,
+                                                                        memory_order_relaxed, memory_order_relaxed));
+    }
+
+    pthread_rwlock_unlock(&tablasLock);
+}
+
+void estadisticas_archivo_leido(size_t bloques)
+{
+    ++costoHilo.ArchivosAbiertos;
+    costoHilo.BloquesLeidos += bloques;
+}
+
+void estadisticas_bytes_escritos(size_t bytes)
+{
+    costoHilo.BytesEscritos += bytes;
+}
+
+void estadisticas_parseados(size_t bytes, size_t registros)
+{
+    costoHilo.BytesParseados += bytes;
+    costoHilo.RegistrosExaminados += registros;
+}
+
+void estadisticas_examinados(size_t registros)
+{
+    costoHilo.RegistrosExaminados += registros;
+}
+
+// sin contencion el lock se toma sin leer el reloj
+void estadisticas_mutex_lock(pthread_mutex_t* mutex)
+{
+    if (!pthread_mutex_trylock(mutex))
+        return;
+
+    uint64_t const inicio = GetNSTime();
+    pthread_mutex_lock(mutex);
+    costoHilo.EsperaLockNs += GetNSTime() - inicio;
+}
+
+void estadisticas_rdlock(pthread_rwlock_t* lock)
+{
+    if (!pthread_rwlock_tryrdlock(lock))
+        return;
+
+    uint64_t const inicio = GetNSTime();
+    pthread_rwlock_rdlock(lock);
+    costoHilo.EsperaLockNs += GetNSTime() - inicio;
+}
+
+void estadisticas_wrlock(pthread_rwlock_t* lock)
+{
+    if (!pthread_rwlock_trywrlock(lock))
+        return;
+
+    uint64_t const inicio = GetNSTime();
+    pthread_rwlock_wrlock(lock);
+    costoHilo.EsperaLockNs += GetNSTime() - inicio;
+}
+
+void estadisticas_agregar_tabla(char const* nombreTabla)
+{
+    pthread_rwlock_wrlock(&tablasLock);
+    if (!dictionary_has_key(tablas, nombreTabla))
+        dictionary_put(tablas, nombreTabla, Calloc(1, sizeof(t_estadisticas_tabla)));
+    pthread_rwlock_unlock(&tablasLock);
+}
+
+void estadisticas_quitar_tabla(char const* nombreTabla)
+{
+    pthread_rwlock_wrlock(&tablasLock);
+    dictionary_remove_and_destroy(tablas, nombreTabla, Free);
+    pthread_rwlock_unlock(&tablasLock);
+}
+
+static void _reportarTabla(char const* nombreTabla, void* estadisticas)
+{
+    t_estadisticas_tabla* const tabla = estadisticas;
+    for (uint8_t i = 0; i < NUM_OPERACIONES; ++i)
+    {
+        t_resumen r;
+        _resumir(&tabla->Operaciones[i], &r);
+        if (!r.Cantidad)
+            continue;
+
+        double const n = (double) r.Cantidad;
+        LISSANDRA_LOG_INFO("STATS: %s %s: %" PRIu64 " operaciones, latencia promedio %" PRIu64 "us (p50 <%" PRIu64 "us, "
+                           "p90 <%" PRIu64 "us, p99 <%" PRIu64 "us, maximo %" PRIu64 "us)", nombreTabla, NombresOperacion[i],
+                           r.Cantidad, r.LatenciaNs / r.Cantidad / 1000, r.P50Us, r.P90Us, r.P99Us, r.LatenciaMaxNs / 1000);
+        LISSANDRA_LOG_INFO("STATS: %s %s: por operacion %.1f archivos, %.1f bloques, %.0f bytes parseados, %.0f bytes escritos, "
+                           "%.1f registros examinados, %.1fus esperando locks", nombreTabla, NombresOperacion[i],
+                           r.Costo.ArchivosAbiertos / n, r.Costo.BloquesLeidos / n, r.Costo.BytesParseados / n,
+                           r.Costo.BytesEscritos / n, r.Costo.RegistrosExaminados / n, r.Costo.EsperaLockNs / n / 1000);
+    }
+}
+
+void estadisticas_reporte(char const* nombreTabla)
+{
+    pthread_rwlock_rdlock(&tablasLock);
+
+    if (nombreTabla)
+    {
+        t_estadisticas_tabla* const tabla = dictionary_get(tablas, nombreTabla);
+        if (tabla)
+            _reportarTabla(nombreTabla, tabla);
+        else
+            LISSANDRA_LOG_INFO("STATS: sin operaciones registradas para la tabla %s", nombreTabla);
+    }
+    else
+        dictionary_iterator(tablas, _reportarTabla);
+
+    pthread_rwlock_unlock(&tablasLock);
+
+    LISSANDRA_LOG_INFO("STATS: %zu bloques libres", bitmap_libres());
+    durabilidad_reporte();
+}
+
+typedef struct
+{
+    FILE* Archivo;
+    bool Primera;
+} t_salida_json;
+
+static void _guardarTabla(char const* nombreTabla, void* estadisticas, void* salida)
+{
+    t_estadisticas_tabla* const tabla = estadisticas;
+    t_salida_json* const s = salida;
+
+    fprintf(s->Archivo, "%s\n    \"%s\": {", s->Primera ? "" : ",", nombreTabla);
+    s->Primera = false;
+
+    bool primeraOperacion = true;
+    for (uint8_t i = 0; i < NUM_OPERACIONES; ++i)
+    {
+        t_resumen r;
+        _resumir(&tabla->Operaciones[i], &r);
+        if (!r.Cantidad)
+            continue;
+
+        fprintf(s->Archivo, "%s\n      \"%s\": { \"cantidad\": %" PRIu64 ", \"archivos\": %" PRIu64 ", \"bloques\": %" PRIu64
+                ", \"bytes_parseados\": %" PRIu64 ", \"bytes_escritos\": %" PRIu64 ", \"registros_examinados\": %" PRIu64
+                ", \"espera_lock_us\": %" PRIu64 ", \"latencia_total_us\": %" PRIu64 ", \"latencia_max_us\": %" PRIu64
+                ", \"p50_us\": %" PRIu64 ", \"p90_us\": %" PRIu64 ", \"p99_us\": %" PRIu64 " }",
+                primeraOperacion ? "" : ",", NombresOperacion[i], r.Cantidad, r.Costo.ArchivosAbiertos,
+                r.Costo.BloquesLeidos, r.Costo.BytesParseados, r.Costo.BytesEscritos, r.Costo.RegistrosExaminados,
+                r.Costo.EsperaLockNs / 1000, r.LatenciaNs / 1000, r.LatenciaMaxNs / 1000, r.P50Us, r.P90Us, r.P99Us);
+        primeraOperacion = false;
+    }
+
+    fprintf(s->Archivo, "\n    }");
+}
+
+void estadisticas_guardar(char const* path)
+{
+    // escribo aparte y renombro, quien lo lea nunca ve un archivo a medias
+    char pathNuevo[PATH_MAX];
+    snprintf(pathNuevo, PATH_MAX, "%s.nuevo", path);
+
+    FILE* archivo = fopen(pathNuevo, "w");
+    if (!archivo)
+    {
+        LISSANDRA_LOG_SYSERROR("fopen");
+        return;
+    }
+
+    fprintf(archivo, "{\n  \"timestamp\": %" PRIu64 ",\n  \"bloques_libres\": %zu,\n  \"tablas\": {", GetMSEpoch(),
+            bitmap_libres());
+
+    t_salida_json salida = { .Archivo = archivo, .Primera = true };
+
+    pthread_rwlock_rdlock(&tablasLock);
+    dictionary_iterator_with_data(tablas, _guardarTabla, &salida);
+    pthread_rwlock_unlock(&tablasLock);
+
+    fprintf(archivo, "\n  }\n}\n");
+    fclose(archivo);
+
+    if (rename(pathNuevo, path) < 0)
+        LISSANDRA_LOG_SYSERROR("rename");
+}
+
+void estadisticas_destroy(void)
+{
+    dictionary_destroy_and_destroy_elements(tablas, Free);
+}
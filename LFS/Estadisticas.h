@@ -0,0 +1,61 @@
+
+#ifndef LISSANDRA_ESTADISTICAS_H
+#define LISSANDRA_ESTADISTICAS_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Costo de las operaciones del FS por tabla.
+ *
+ * Mientras corre una operacion (entre estadisticas_inicio y estadisticas_fin) cada hilo acumula en contadores
+ * propios, sin atomicos ni locks, lo que va leyendo: archivos y bloques leidos, bytes parseados, registros
+ * examinados y el tiempo esperando locks. Al terminar se suman una sola vez a los contadores de la tabla junto
+ * con la latencia total, que ademas va a un histograma por potencias de 2 de microsegundos.
+ *
+ * Se consultan con el comando STATS y se guardan en ARCHIVO_ESTADISTICAS (JSON) cada TIEMPO_ESTADISTICAS ms.
+ */
+
+typedef enum
+{
+    OPERACION_SELECT,
+    OPERACION_INSERT,
+    OPERACION_DUMP,
+    OPERACION_COMPACTACION,
+
+    NUM_OPERACIONES
+} OperacionLFS;
+
+void estadisticas_init(void);
+
+// empieza a medir una operacion en el hilo actual
+void estadisticas_inicio(void);
+
+// termina la operacion del hilo actual y la suma a la tabla, si sigue agregada
+void estadisticas_fin(char const* nombreTabla, OperacionLFS operacion);
+
+// contadores de la operacion en curso del hilo, fuera de una operacion no se registran en ningun lado
+void estadisticas_archivo_leido(size_t bloques);
+void estadisticas_bytes_escritos(size_t bytes);
+void estadisticas_parseados(size_t bytes, size_t registros);
+void estadisticas_examinados(size_t registros);
+
+// toman el lock sumando la espera (si la hubo) a la operacion en curso
+void estadisticas_mutex_lock(pthread_mutex_t* mutex);
+void estadisticas_rdlock(pthread_rwlock_t* lock);
+void estadisticas_wrlock(pthread_rwlock_t* lock);
+
+// las operaciones solo se suman a tablas agregadas (al crearlas o al descubrirlas en el arranque)
+void estadisticas_agregar_tabla(char const* nombreTabla);
+void estadisticas_quitar_tabla(char const* nombreTabla);
+
+// loguea los costos de la tabla, o de todas si es NULL
+void estadisticas_reporte(char const* nombreTabla);
+
+// escribe todas las estadisticas en formato JSON, reemplazando el archivo atomicamente
+void estadisticas_guardar(char const* path);
+
+void estadisticas_destroy(void);
+
+#endif //LISSANDRA_ESTADISTICAS_H
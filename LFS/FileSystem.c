@@ -1,25 +1,149 @@
 
 #include "FileSystem.h"
+#include "Bitmap.h"
 #include "Compactador.h"
 #include "Config.h"
+#include "Durabilidad.h"
+#include "Estadisticas.h"
 #include "LissandraLibrary.h"
+#include "Snapshot.h"
 #include <dirent.h>
 #include <fcntl.h>
 #include <libcommons/config.h>
+#include <libcommons/string.h>
 #include <Logger.h>
 #include <Malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <Timer.h>
 #include <unistd.h>
 
 char pathMetadataBitarray[PATH_MAX] = { 0 };
 
-t_bitarray* bitArray = NULL;
-
 static uint8_t* bitmap = NULL;
 static size_t sizeBitArray = 0;
+static size_t sizeMapping = 0;
+
+static pthread_t hiloDescubrimiento;
+
+// cada tabla se registra con el lock de lectura y un DROP se hace con el de escritura, asi el descubrimiento no
+// agrega el compactador ni las estadisticas de una tabla que se borro despues de leer el directorio
+static pthread_rwlock_t descubrimientoLock = PTHREAD_RWLOCK_INITIALIZER;
+
+// tablas por hilo de descubrimiento, por debajo de esto no vale la pena lanzar otro
+#define TABLAS_POR_HILO 64
+
+typedef struct
+{
+    Vector Nombres;
+    atomic_size_t Siguiente;
+} t_descubrimiento;
+
+static void* _descubrirParte(void* descubrimiento)
+{
+    t_descubrimiento* const d = descubrimiento;
+    size_t const total = Vector_size(&d->Nombres);
+
+    size_t i;
+    while ((i = atomic_fetch_add(&d->Siguiente, 1)) < total)
+    {
+        char const* const nombreTabla = *(char**) Vector_at(&d->Nombres, i);
+
+        pthread_rwlock_rdlock(&descubrimientoLock);
+
+        // puede no tener metadata si se cayo a mitad de un CREATE, o haberse borrado recien
+        t_describe tableMetadata;
+        bool const existe = get_table_metadata(nombreTabla, &tableMetadata);
+        if (existe)
+        {
+            estadisticas_agregar_tabla(nombreTabla);
+            agregarTablaCompactador(nombreTabla, tableMetadata.compaction_time);
+        }
+
+        pthread_rwlock_unlock(&descubrimientoLock);
+
+        if (!existe)
+        {
+            LISSANDRA_LOG_ERROR("No se pudo encontrar metadatos para la tabla %s! No se compactara", nombreTabla);
+            continue;
+        }
+
+        // las fijadas se decodifican ya, asi el primer SELECT no paga la carga
+        if (tableMetadata.pinned)
+        {
+            t_snapshot* const snapshot = snapshot_pin(nombreTabla);
+            if (snapshot)
+                snapshot_unpin(snapshot);
+        }
+    }
+
+    return NULL;
+}
+
+static void _liberarNombre(void* nombre)
+{
+    Free(*(char**) nombre);
+}
+
+static void* _descubrirTablas(void* arg)
+{
+    (void) arg;
+
+    uint64_t const inicio = GetMSTime();
+
+    t_descubrimiento d;
+    Vector_Construct(&d.Nombres, sizeof(char*), _liberarNombre, 0);
+    atomic_init(&d.Siguiente, 0);
+
+    char pathTablas[PATH_MAX];
+    DIR* dir = NULL;
+    if (snprintf(pathTablas, PATH_MAX, "%sTables", confLFS.PUNTO_MONTAJE) >= PATH_MAX)
+        LISSANDRA_LOG_ERROR("ARRANQUE: el punto de montaje %s es demasiado largo!", confLFS.PUNTO_MONTAJE);
+    else
+        dir = opendir(pathTablas);
+    if (dir)
+    {
+        struct dirent* entry;
+        while ((entry = readdir(dir)))
+        {
+            if (*entry->d_name == '.')
+                continue;
+
+            char* const nombre = string_duplicate(entry->d_name);
+            Vector_push_back(&d.Nombres, &nombre);
+        }
+
+        closedir(dir);
+    }
+
+    size_t const numTablas = Vector_size(&d.Nombres);
+
+    // leer cada Metadata es lo que tarda, lo reparto entre hilos
+    long numHilos = sysconf(_SC_NPROCESSORS_ONLN);
+    if (numHilos < 1)
+        numHilos = 1;
+    if ((size_t) numHilos > numTablas / TABLAS_POR_HILO + 1)
+        numHilos = numTablas / TABLAS_POR_HILO + 1;
+
+    pthread_t hilos[numHilos];
+    for (long i = 1; i < numHilos; ++i)
+        pthread_create(hilos + i, NULL, _descubrirParte, &d);
+
+    _descubrirParte(&d);
+
+    for (long i = 1; i < numHilos; ++i)
+        pthread_join(hilos[i], NULL);
+
+    Vector_Destruct(&d.Nombres);
+
+    LISSANDRA_LOG_INFO("ARRANQUE: %zu tablas descubiertas en %" PRIu64 "ms con %ld hilos", numTablas,
+                       GetMSTimeDiff(inicio, GetMSTime()), numHilos);
+    return NULL;
+}
 
 void iniciarFileSystem(void)
 {
@@ -98,7 +222,9 @@ void iniciarFileSystem(void)
         }
     }
 
-    bitmap = mmap(NULL, sizeBitArray, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // el asignador lee de a palabras de 8 bytes, la ultima puede pasarse del archivo pero no de la pagina
+    sizeMapping = (sizeBitArray + 7) / 8 * 8;
+    bitmap = mmap(NULL, sizeMapping, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
     if (bitmap == MAP_FAILED)
     {
         LISSANDRA_LOG_SYSERROR("mmap");
@@ -107,7 +233,9 @@ void iniciarFileSystem(void)
 
     close(fd);
 
-    bitArray = bitarray_create_with_mode(bitmap, sizeBitArray, LSB_FIRST);
+    bitmap_init(bitmap, confLFS.CANTIDAD_BLOQUES);
+    durabilidad_init();
+
     if (dirIsEmpty(pathBloques))
     {
         for (size_t j = 0; j < confLFS.CANTIDAD_BLOQUES; ++j)
@@ -125,7 +253,11 @@ void iniciarFileSystem(void)
         }
     }
 
-    // crear hilos para las tablas que existen
+    // versiones de las tablas, se cargan a demanda
+    snapshot_init();
+
+    // los hilos compactadores de las tablas que existen se crean en segundo plano
+    // mientras tanto se puede atender: las tablas se cargan a demanda en su primer acceso
     inicializarCompactador();
 
     DIR* dir = opendir(pathTablas);
@@ -134,31 +266,31 @@ void iniciarFileSystem(void)
         LISSANDRA_LOG_FATAL("No pude abrir el directorio de tablas!");
         exit(EXIT_FAILURE);
     }
+    closedir(dir);
 
-    struct dirent* entry;
-    while ((entry = readdir(dir)))
-    {
-        if (*entry->d_name == '.')
-            continue;
+    pthread_create(&hiloDescubrimiento, NULL, _descubrirTablas, NULL);
 
-        t_describe tableMetadata;
-        if (!get_table_metadata(entry->d_name, &tableMetadata))
-        {
-            LISSANDRA_LOG_FATAL("No se pudo encontrar metadatos para la tabla %s!", entry->d_name);
-            exit(EXIT_FAILURE);
-        }
-
-        agregarTablaCompactador(tableMetadata.table, tableMetadata.compaction_time);
-    }
+    LISSANDRA_LOG_TRACE("Se finalizo la creacion del File System");
+}
 
-    closedir(dir);
+void bloquearDescubrimiento(void)
+{
+    pthread_rwlock_wrlock(&descubrimientoLock);
+}
 
-    LISSANDRA_LOG_TRACE("Se finalizo la creacion del File System");
+void desbloquearDescubrimiento(void)
+{
+    pthread_rwlock_unlock(&descubrimientoLock);
 }
 
 void terminarFileSystem(void)
 {
+    // el descubrimiento termina solo, no puede quedar agregando hilos a un compactador destruido
+    pthread_join(hiloDescubrimiento, NULL);
+
     terminarCompactador();
-    bitarray_destroy(bitArray);
-    munmap(bitmap, sizeBitArray);
+    snapshot_destroy();
+    durabilidad_destroy();
+    bitmap_destroy();
+    munmap(bitmap, sizeMapping);
 }
@@ -2,16 +2,12 @@
 #ifndef LISSANDRA_FILESYSTEM_H
 #define LISSANDRA_FILESYSTEM_H
 
-#include <libcommons/bitarray.h>
-
 /**
  * Variables
  */
 
 extern char pathMetadataBitarray[];
 
-extern t_bitarray* bitArray;
-
 //typedef uint32_t t_num;
 
 //Semaforo
@@ -22,6 +18,10 @@ extern t_bitarray* bitArray;
 
 void iniciarFileSystem(void);
 
+// un DROP excluye al descubrimiento del arranque mientras quita la tabla
+void bloquearDescubrimiento(void);
+void desbloquearDescubrimiento(void);
+
 void terminarFileSystem(void);
 
 #endif //LISSANDRA_FILESYSTEM_H
@@ -4,11 +4,14 @@
 #include "Config.h"
 #include "LissandraLibrary.h"
 #include <Consistency.h>
+#include <Console.h>
+#include <EventDispatcher.h>
 #include <Logger.h>
 #include <Opcodes.h>
 #include <Packet.h>
 #include <Socket.h>
 #include <stdlib.h>
+#include <Threads.h>
 #include <Timer.h>
 
 OpcodeHandlerFnType* const OpcodeTable[NUM_HANDLED_OPCODES] =
@@ -22,11 +25,109 @@ OpcodeHandlerFnType* const OpcodeTable[NUM_HANDLED_OPCODES] =
     HandleCreateOpcode,     // LQL_CREATE
     HandleDescribeOpcode,   // LQL_DESCRIBE
     HandleDropOpcode,       // LQL_DROP
+    HandleDeleteOpcode,     // LQL_DELETE
+
+    // journal de memoria
+    HandleInsertBatchOpcode, // LQL_INSERT_BATCH
 
     // mensaje a memoria, ignoramos
     NULL                    // LQL_JOURNAL
 };
 
+//Variables
+//static hace que las variables no se puedan referenciar desde otro .c utilizando 'extern'
+//si lo desean cambiar, quitenlo
+static Socket* sock_LFS = NULL;
+
+void* atender_memoria(void* socketMemoria)
+{
+    while (ProcessRunning)
+    {
+        if (!Socket_HandlePacket(socketMemoria))
+        {
+            /// ya hace logs si hubo errores, cerrar conexión
+            Socket_Destroy(socketMemoria);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+void memoria_conectar(Socket* fs, Socket* memoriaNueva)
+{
+    (void) fs;
+
+    //Recibe el handshake
+    Packet* p = Socket_RecvPacket(memoriaNueva);
+    if (!p)
+    {
+        LISSANDRA_LOG_ERROR("Memoria se desconecto durante handshake!");
+        return;
+    }
+
+    if (Packet_GetOpcode(p) != MSG_HANDSHAKE)
+    {
+        LISSANDRA_LOG_ERROR("HANDSHAKE: recibido opcode no esperado %hu", Packet_GetOpcode(p));
+        Packet_Destroy(p);
+        return;
+    }
+
+    uint8_t id;
+    Packet_Read(p, &id);
+
+    //----Recibo un handshake del cliente para ver si es una memoria
+    if (id != MEMORIA)
+    {
+        LISSANDRA_LOG_ERROR("Se conecto un desconocido! (id %d)", id);
+        Packet_Destroy(p);
+        Socket_Destroy(memoriaNueva);
+        return;
+    }
+
+    LISSANDRA_LOG_INFO("Se conecto una memoria en el socket: %d\n", memoriaNueva->_impl.Handle);
+
+    Packet_Destroy(p);
+
+    //Le envia a la memoria el TAMANIO_VALUE y el punto de montaje
+    uint32_t const tamanioValue = confLFS.TAMANIO_VALUE;
+    char const* const puntoMontaje = confLFS.PUNTO_MONTAJE;
+
+    p = Packet_Create(MSG_HANDSHAKE_RESPUESTA, 50);
+    Packet_Append(p, tamanioValue);
+    Packet_Append(p, puntoMontaje);
+    Socket_SendPacket(memoriaNueva, p);
+    Packet_Destroy(p);
+
+    //----Creo un hilo para cada memoria que se me conecta
+    Threads_CreateDetached(atender_memoria, memoriaNueva);
+}
+
+void iniciar_servidor(void)
+{
+    //----Creo socket de LFS, hago el bind y comienzo a escuchar
+    SocketOpts opts =
+    {
+        .SocketMode = SOCKET_SERVER,
+        .ServiceOrPort = confLFS.PUERTO_ESCUCHA,
+        .HostName = NULL,
+
+        // cuando una memoria conecte, llamar a memoria_conectar
+        .SocketOnAcceptClient = memoria_conectar,
+    };
+    sock_LFS = Socket_Create(&opts);
+
+    if (!sock_LFS)
+    {
+        LISSANDRA_LOG_FATAL("No pudo iniciarse el socket de escucha!!");
+        exit(1);
+    }
+
+    LISSANDRA_LOG_TRACE("Servidor LFS iniciado");
+
+    EventDispatcher_AddFDI(sock_LFS);
+}
+
 void HandleSelectOpcode(Socket* s, Packet* p)
 {
     /* char*: nombre tabla
@@ -100,13 +201,15 @@ void HandleCreateOpcode(Socket* s, Packet* p)
     uint8_t tipoConsistencia;
     uint16_t numeroParticiones;
     uint32_t compactionTime;
+    uint32_t ttl;
 
     Packet_Read(p, &nombreTabla);
     Packet_Read(p, &tipoConsistencia);
     Packet_Read(p, &numeroParticiones);
     Packet_Read(p, &compactionTime);
+    Packet_Read(p, &ttl);
 
-    uint8_t resultadoCreate = api_create(nombreTabla, tipoConsistencia, numeroParticiones, compactionTime);
+    uint8_t resultadoCreate = api_create(nombreTabla, tipoConsistencia, numeroParticiones, compactionTime, ttl);
     if (resultadoCreate == EXIT_FAILURE)
         LISSANDRA_LOG_ERROR("No se pudo crear la tabla: %s", nombreTabla);
 
@@ -126,6 +229,8 @@ void _addToPacket(void* elem, void* packet)
     Packet_Append(packet, elemento->consistency);
     Packet_Append(packet, elemento->partitions);
     Packet_Append(packet, elemento->compaction_time);
+    Packet_Append(packet, elemento->ttl);
+    Packet_Append(packet, elemento->expirados);
 }
 
 void HandleDescribeOpcode(Socket* s, Packet* p)
@@ -188,3 +293,73 @@ void HandleDropOpcode(Socket* s, Packet* p)
 
     free(nombreTabla);
 }
+
+void HandleDeleteOpcode(Socket* s, Packet* p)
+{
+    char* nombreTabla;
+    uint16_t key;
+    uint64_t timestamp;
+    Packet_Read(p, &nombreTabla);
+    Packet_Read(p, &key);
+    Packet_Read(p, &timestamp);
+
+    uint8_t resultadoDelete = api_delete(nombreTabla, key, timestamp);
+    if (resultadoDelete == EXIT_FAILURE)
+        LISSANDRA_LOG_ERROR("No se pudo realizar el delete de: %s", nombreTabla);
+
+    Packet* respuesta = Packet_Create(MSG_DELETE_RESPUESTA, 1);
+    Packet_Append(respuesta, resultadoDelete);
+    Socket_SendPacket(s, respuesta);
+    Packet_Destroy(respuesta);
+
+    Free(nombreTabla);
+}
+
+void HandleInsertBatchOpcode(Socket* s, Packet* p)
+{
+    uint16_t cantidadTablas;
+    Packet_Read(p, &cantidadTablas);
+
+    Packet* respuesta = Packet_Create(MSG_INSERT_BATCH_RESPUESTA, 2 + cantidadTablas);
+    Packet_Append(respuesta, cantidadTablas);
+
+    Vector inserts;
+    Vector_Construct(&inserts, sizeof(t_insert), NULL, 0);
+    for (uint16_t t = 0; t < cantidadTablas; ++t)
+    {
+        char* nombreTabla;
+        uint32_t cantidad;
+        Packet_Read(p, &nombreTabla);
+        Packet_Read(p, &cantidad);
+
+        Vector_clear(&inserts);
+        Vector_reserve(&inserts, cantidad);
+        for (uint32_t i = 0; i < cantidad; ++i)
+        {
+            char* value;
+            t_insert insert;
+            Packet_Read(p, &insert.key);
+            Packet_Read(p, &value);
+            Packet_Read(p, &insert.timestamp);
+
+            insert.value = value;
+            Vector_push_back(&inserts, &insert);
+        }
+
+        uint8_t resultadoInsert = api_insert_batch(nombreTabla, Vector_data(&inserts), cantidad);
+        if (resultadoInsert == EXIT_FAILURE)
+            LISSANDRA_LOG_ERROR("No se pudo realizar el insert de %u registros en: %s", cantidad, nombreTabla);
+
+        Packet_Append(respuesta, resultadoInsert);
+
+        t_insert* const registros = Vector_data(&inserts);
+        for (uint32_t i = 0; i < cantidad; ++i)
+            Free((char*) registros[i].value);
+        Free(nombreTabla);
+    }
+
+    Vector_Destruct(&inserts);
+
+    Socket_SendPacket(s, respuesta);
+    Packet_Destroy(respuesta);
+}
@@ -9,5 +9,10 @@ OpcodeHandlerFnType HandleInsertOpcode;
 OpcodeHandlerFnType HandleCreateOpcode;
 OpcodeHandlerFnType HandleDescribeOpcode;
 OpcodeHandlerFnType HandleDropOpcode;
+OpcodeHandlerFnType HandleDeleteOpcode;
+OpcodeHandlerFnType HandleInsertBatchOpcode;
+
+// socket de escucha para las memorias, cada una se atiende en su hilo
+void iniciar_servidor(void);
 
 #endif //LFS_Handlers_h__
@@ -0,0 +1,189 @@
+
+#include "KeyFilter.h"
+#include "Config.h"
+#include "LissandraLibrary.h"
+#include "Memtable.h"
+#include "Parser.h"
+#include "Snapshot.h"
+#include <libcommons/dictionary.h>
+#include <Logger.h>
+#include <Malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define FILTRO_BITS (UINT16_MAX + 1)
+#define FILTRO_PALABRAS (FILTRO_BITS / 32)
+
+typedef struct
+{
+    // una del diccionario y una por cada hilo que lo esta usando, un DROP no lo libera mientras alguien lo lea
+    atomic_uint Refs;
+
+    // la carga desde disco se hace una unica vez, la primera vez que se consulta
+    pthread_mutex_t CargaMutex;
+    atomic_bool Cargado;
+
+    _Atomic uint32_t Bits[FILTRO_PALABRAS];
+} FiltroTabla;
+
+static t_dictionary* filtros = NULL;
+static pthread_rwlock_t filtrosLock = PTHREAD_RWLOCK_INITIALIZER;
+
+static FiltroTabla* _obtenerFiltro(char const* nombreTabla, bool cargado);
+static void _soltarFiltro(void* filtro);
+static void _cargarFiltro(char const* nombreTabla, FiltroTabla* filtro);
+
+static inline void _marcarClave(FiltroTabla* filtro, uint16_t key)
+{
+    atomic_fetch_or_explicit(&filtro->Bits[key / 32], 1U << (key % 32), memory_order_relaxed);
+}
+
+static inline bool _testClave(FiltroTabla* filtro, uint16_t key)
+{
+    return atomic_load_explicit(&filtro->Bits[key / 32], memory_order_relaxed) & (1U << (key % 32));
+}
+
+void keyfilter_init(void)
+{
+    filtros = dictionary_create();
+}
+
+void keyfilter_create_table(char const* nombreTabla)
+{
+    _soltarFiltro(_obtenerFiltro(nombreTabla, true));
+}
+
+void keyfilter_add(char const* nombreTabla, uint16_t key)
+{
+    // si el filtro todavia no se cargo lo creo igual: la carga solo agrega bits, nunca los quita
+    FiltroTabla* const filtro = _obtenerFiltro(nombreTabla, false);
+    _marcarClave(filtro, key);
+    _soltarFiltro(filtro);
+}
+
+bool keyfilter_may_contain(char const* nombreTabla, uint16_t key)
+{
+    FiltroTabla* const filtro = _obtenerFiltro(nombreTabla, false);
+    if (!atomic_load(&filtro->Cargado))
+    {
+        pthread_mutex_lock(&filtro->CargaMutex);
+        if (!atomic_load(&filtro->Cargado))
+        {
+            _cargarFiltro(nombreTabla, filtro);
+            atomic_store(&filtro->Cargado, true);
+        }
+        pthread_mutex_unlock(&filtro->CargaMutex);
+    }
+
+    bool const presente = _testClave(filtro, key);
+    _soltarFiltro(filtro);
+    return presente;
+}
+
+void keyfilter_delete_table(char const* nombreTabla)
+{
+    pthread_rwlock_wrlock(&filtrosLock);
+    FiltroTabla* const filtro = dictionary_remove(filtros, nombreTabla);
+    pthread_rwlock_unlock(&filtrosLock);
+
+    // lo libera el ultimo que lo estaba usando
+    if (filtro)
+        _soltarFiltro(filtro);
+}
+
+void keyfilter_destroy(void)
+{
+    dictionary_destroy_and_destroy_elements(filtros, _soltarFiltro);
+}
+
+/* PRIVATE */
+static FiltroTabla* _obtenerFiltro(char const* nombreTabla, bool cargado)
+{
+    pthread_rwlock_rdlock(&filtrosLock);
+    FiltroTabla* filtro = dictionary_get(filtros, nombreTabla);
+    if (filtro)
+        atomic_fetch_add(&filtro->Refs, 1);
+    pthread_rwlock_unlock(&filtrosLock);
+
+    if (filtro)
+        return filtro;
+
+    pthread_rwlock_wrlock(&filtrosLock);
+
+    // otro hilo pudo haberlo creado mientras no tenia el lock
+    filtro = dictionary_get(filtros, nombreTabla);
+    if (!filtro)
+    {
+        filtro = Malloc(sizeof(FiltroTabla));
+        atomic_init(&filtro->Refs, 1);
+        pthread_mutex_init(&filtro->CargaMutex, NULL);
+        atomic_init(&filtro->Cargado, cargado);
+        for (size_t i = 0; i < FILTRO_PALABRAS; ++i)
+            atomic_init(&filtro->Bits[i], 0);
+
+        dictionary_put(filtros, nombreTabla, filtro);
+    }
+
+    atomic_fetch_add(&filtro->Refs, 1);
+    pthread_rwlock_unlock(&filtrosLock);
+    return filtro;
+}
+
+static void _cargarContenido(char const* contenido, size_t len, FiltroTabla* filtro)
+{
+    t_parser parser;
+    parser_init(&parser, contenido, len);
+
+    t_vista_registro registro;
+    while (parser_next(&parser, &registro))
+        if (!registro.Tombstone)
+            _marcarClave(filtro, registro.Key);
+}
+
+static void _marcarClaveMemtable(uint16_t key, void* filtro)
+{
+    _marcarClave(filtro, key);
+}
+
+static void _cargarArchivo(t_archivo const* archivo, FiltroTabla* filtro)
+{
+    char* contenido = snapshot_leer_archivo(archivo);
+    if (!contenido)
+        return;
+
+    _cargarContenido(contenido, archivo->Size, filtro);
+    Free(contenido);
+}
+
+static void _cargarFiltro(char const* nombreTabla, FiltroTabla* filtro)
+{
+    // primero la memtable: lo que se este bajando en un dump sigue ahi hasta que su temporal este publicado
+    memtable_iterate_keys(nombreTabla, _marcarClaveMemtable, filtro);
+
+    t_snapshot* snapshot = snapshot_pin(nombreTabla);
+    if (!snapshot)
+        return;
+
+    for (uint16_t i = 0; i < snapshot->NumParticiones; ++i)
+        _cargarArchivo(snapshot->Particiones[i], filtro);
+
+    size_t const numTemporales = Vector_size(&snapshot->Temporales);
+    t_archivo** const temporales = Vector_data(&snapshot->Temporales);
+    for (size_t i = 0; i < numTemporales; ++i)
+        _cargarArchivo(temporales[i], filtro);
+
+    LISSANDRA_LOG_TRACE("FILTRO: cargado filtro de claves de la tabla %s (version %llu, %u archivos)", nombreTabla,
+                        (unsigned long long) snapshot->Version, snapshot->NumParticiones + (unsigned) numTemporales);
+
+    snapshot_unpin(snapshot);
+}
+
+static void _soltarFiltro(void* filtro)
+{
+    FiltroTabla* const f = filtro;
+    if (atomic_fetch_sub(&f->Refs, 1) != 1)
+        return;
+
+    pthread_mutex_destroy(&f->CargaMutex);
+    Free(f);
+}
@@ -0,0 +1,32 @@
+
+#ifndef LISSANDRA_KEYFILTER_H
+#define LISSANDRA_KEYFILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Filtro de presencia de claves por tabla.
+ * Como las claves son uint16_t alcanza con un bitmap de 65536 bits (8KB) por tabla.
+ * Un bit apagado garantiza que la clave no existe en ninguna fuente (particiones, temporales, memtable)
+ * asi que un SELECT de una clave inexistente se resuelve sin leer ningun archivo.
+ * Un bit prendido no garantiza nada (puede haber falsos positivos, nunca falsos negativos)
+ */
+
+void keyfilter_init(void);
+
+// crea el filtro vacio para una tabla recien creada (no hay nada que cargar de disco)
+void keyfilter_create_table(char const* nombreTabla);
+
+// marca la clave como (posiblemente) presente. Llamar en cada insert
+void keyfilter_add(char const* nombreTabla, uint16_t key);
+
+// devuelve false si la clave seguro no existe en la tabla
+// la primera consulta carga el filtro desde disco
+bool keyfilter_may_contain(char const* nombreTabla, uint16_t key);
+
+void keyfilter_delete_table(char const* nombreTabla);
+
+void keyfilter_destroy(void);
+
+#endif //LISSANDRA_KEYFILTER_H
@@ -3,7 +3,13 @@
 #include "API.h"
 #include "CLIHandlers.h"
 #include "Config.h"
+#include "Defragmentador.h"
+#include "Durabilidad.h"
+#include "Estadisticas.h"
 #include "FileSystem.h"
+#include "Handlers.h"
+#include "KeyFilter.h"
+#include "WAL.h"
 #include <Appender.h>
 #include <AppenderConsole.h>
 #include <AppenderFile.h>
@@ -21,12 +27,18 @@
 
 CLICommand const CLICommands[] =
 {
-    { "SELECT",   HandleSelect   },
-    { "INSERT",   HandleInsert   },
-    { "CREATE",   HandleCreate   },
-    { "DESCRIBE", HandleDescribe },
-    { "DROP",     HandleDrop     },
-    { NULL,       NULL           }
+    { "SELECT",      HandleSelect      },
+    { "INSERT",      HandleInsert      },
+    { "CREATE",      HandleCreate      },
+    { "DESCRIBE",    HandleDescribe    },
+    { "DROP",        HandleDrop        },
+    { "DELETE",      HandleDelete      },
+    { "REPARTITION", HandleRepartition },
+    { "DEFRAG",      HandleDefrag      },
+    { "STATS",       HandleStats       },
+    { "PIN",         HandlePin         },
+    { "UNPIN",       HandleUnpin       },
+    { NULL,          NULL              }
 };
 
 char CLIPrompt[] = "FS_LISSANDRA> ";
@@ -39,6 +51,12 @@ static Appender* fileLog;
 static PeriodicTimer* DumpTimer = NULL;
 static void _initDumpThread(PeriodicTimer* pt);
 
+static PeriodicTimer* DefragTimer = NULL;
+static void _initDefragThread(PeriodicTimer* pt);
+
+static PeriodicTimer* EstadisticasTimer = NULL;
+static void _guardarEstadisticas(PeriodicTimer* pt);
+
 t_config_FS confLFS = { 0 };
 
 static void IniciarLogger(void)
@@ -61,6 +79,27 @@ static void _loadReloadableFields(t_config const* config)
     // solo los campos recargables en tiempo ejecucion
     atomic_store(&confLFS.RETARDO, config_get_long_value(config, "RETARDO"));
     confLFS.TIEMPO_DUMP = config_get_long_value(config, "TIEMPO_DUMP");
+
+    // opcional, 0 deshabilita la desfragmentacion periodica
+    confLFS.TIEMPO_DEFRAG = 0;
+    if (config_has_property(config, "TIEMPO_DEFRAG"))
+        confLFS.TIEMPO_DEFRAG = config_get_long_value(config, "TIEMPO_DEFRAG");
+
+    // opcional, por defecto un minuto
+    uint32_t graciaTombstone = 60000;
+    if (config_has_property(config, "GRACIA_TOMBSTONE"))
+        graciaTombstone = config_get_long_value(config, "GRACIA_TOMBSTONE");
+    atomic_store(&confLFS.GRACIA_TOMBSTONE, graciaTombstone);
+
+    // opcionales, por defecto no se guardan estadisticas
+    confLFS.TIEMPO_ESTADISTICAS = 0;
+    if (config_has_property(config, "TIEMPO_ESTADISTICAS"))
+        confLFS.TIEMPO_ESTADISTICAS = config_get_long_value(config, "TIEMPO_ESTADISTICAS");
+
+    char const* archivoEstadisticas = "estadisticas.json";
+    if (config_has_property(config, "ARCHIVO_ESTADISTICAS"))
+        archivoEstadisticas = config_get_string_value(config, "ARCHIVO_ESTADISTICAS");
+    snprintf(confLFS.ARCHIVO_ESTADISTICAS, PATH_MAX, "%s", archivoEstadisticas);
 }
 
 static void _reLoadConfig(char const* fileName)
@@ -78,6 +117,8 @@ static void _reLoadConfig(char const* fileName)
 
     // recargo el intervalo de dumps
     PeriodicTimer_ReSetTimer(DumpTimer, confLFS.TIEMPO_DUMP);
+    PeriodicTimer_ReSetTimer(DefragTimer, confLFS.TIEMPO_DEFRAG);
+    PeriodicTimer_ReSetTimer(EstadisticasTimer, confLFS.TIEMPO_ESTADISTICAS);
 }
 
 static void LoadConfigInitial(char const* fileName)
@@ -107,6 +148,22 @@ static void LoadConfigInitial(char const* fileName)
     confLFS.TAMANIO_BLOQUES = config_get_long_value(config, "BLOCK_SIZE");
     confLFS.CANTIDAD_BLOQUES = config_get_long_value(config, "BLOCKS");
 
+    // opcionales, por defecto los INSERT comparten fdatasync sin ventana de espera
+    confLFS.MODO_WAL = WAL_GROUP;
+    if (config_has_property(config, "MODO_WAL") &&
+        !wal_modo_desde_string(config_get_string_value(config, "MODO_WAL"), &confLFS.MODO_WAL))
+        exit(EXIT_FAILURE);
+
+    confLFS.VENTANA_WAL_US = 0;
+    if (config_has_property(config, "VENTANA_WAL_US"))
+        confLFS.VENTANA_WAL_US = config_get_long_value(config, "VENTANA_WAL_US");
+
+    // por defecto una sincronizacion por dump o compactacion
+    confLFS.DURABILIDAD = DURABILIDAD_BATCH;
+    if (config_has_property(config, "DURABILIDAD") &&
+        !durabilidad_modo_desde_string(config_get_string_value(config, "DURABILIDAD"), &confLFS.DURABILIDAD))
+        exit(EXIT_FAILURE);
+
     _loadReloadableFields(config);
 
     config_destroy(config);
@@ -120,6 +177,12 @@ static void LoadConfigInitial(char const* fileName)
     DumpTimer = PeriodicTimer_Create(confLFS.TIEMPO_DUMP, _initDumpThread);
     EventDispatcher_AddFDI(DumpTimer);
 
+    DefragTimer = PeriodicTimer_Create(confLFS.TIEMPO_DEFRAG, _initDefragThread);
+    EventDispatcher_AddFDI(DefragTimer);
+
+    EstadisticasTimer = PeriodicTimer_Create(confLFS.TIEMPO_ESTADISTICAS, _guardarEstadisticas);
+    EventDispatcher_AddFDI(EstadisticasTimer);
+
     LISSANDRA_LOG_TRACE("Config LFS iniciado");
 }
 
@@ -137,7 +200,9 @@ static void MainLoop(void)
 static void Cleanup(void)
 {
     memtable_destroy();
+    keyfilter_destroy();
     terminarFileSystem();
+    estadisticas_destroy();
     EventDispatcher_Terminate();
     Logger_Terminate();
 }
@@ -146,15 +211,28 @@ int main(void)
 {
     static char const configFileName[] = "lissandra.conf";
 
+    uint64_t const inicio = GetMSTime();
+
     IniciarLogger();
     EventDispatcher_Init();
     SigintSetup();
+    estadisticas_init();
     LoadConfigInitial(configFileName);
 
+    // las tablas se descubren en segundo plano, no hace falta esperarlas para atender
     iniciarFileSystem();
+    uint64_t const finFS = GetMSTime();
+
+    // reaplicar el WAL si, los SELECT tienen que ver esos INSERT
     memtable_create();
+    uint64_t const finWAL = GetMSTime();
+
+    keyfilter_init();
 
     iniciar_servidor();
+    LISSANDRA_LOG_INFO("ARRANQUE: escuchando a los %" PRIu64 "ms (File System %" PRIu64 "ms, WAL %" PRIu64 "ms)",
+                       GetMSTimeDiff(inicio, GetMSTime()), GetMSTimeDiff(inicio, finFS), GetMSTimeDiff(finFS, finWAL));
+
     MainLoop();
 
     Cleanup();
@@ -166,3 +244,18 @@ static void _initDumpThread(PeriodicTimer* pt)
 
     Threads_CreateDetached(memtable_dump_thread, pt);
 }
+
+static void _initDefragThread(PeriodicTimer* pt)
+{
+    PeriodicTimer_SetEnabled(pt, false);
+
+    Threads_CreateDetached(defragmentador_thread, pt);
+}
+
+static void _guardarEstadisticas(PeriodicTimer* pt)
+{
+    (void) pt;
+
+    // corre en el mismo hilo que la recarga de config, el path no cambia mientras se escribe
+    estadisticas_guardar(confLFS.ARCHIVO_ESTADISTICAS);
+}
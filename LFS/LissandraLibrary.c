@@ -1,124 +1,27 @@
 
 #include "LissandraLibrary.h"
+#include "Bitmap.h"
 #include "Config.h"
+#include "Durabilidad.h"
+#include "Estadisticas.h"
 #include "FileSystem.h"
 #include "Memtable.h"
+#include "Parser.h"
 #include <Consistency.h>
-#include <Console.h>
 #include <ConsoleInput.h>
 #include <dirent.h>
-#include <EventDispatcher.h>
 #include <fcntl.h>
 #include <File.h>
 #include <libcommons/config.h>
 #include <libcommons/string.h>
-#include <Opcodes.h>
-#include <Packet.h>
-#include <Socket.h>
+#include <Malloc.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
-#include <Threads.h>
 #include <unistd.h>
 #include <Timer.h>
 
-//Variables
-//static hace que las variables no se puedan referenciar desde otro .c utilizando 'extern'
-//si lo desean cambiar, quitenlo
-static Socket* sock_LFS = NULL;
-
-static pthread_mutex_t bitarrayLock = PTHREAD_MUTEX_INITIALIZER;
-
-void* atender_memoria(void* socketMemoria)
-{
-    while (ProcessRunning)
-    {
-        if (!Socket_HandlePacket(socketMemoria))
-        {
-            /// ya hace logs si hubo errores, cerrar conexión
-            Socket_Destroy(socketMemoria);
-            break;
-        }
-    }
-
-    return NULL;
-}
-
-void memoria_conectar(Socket* fs, Socket* memoriaNueva)
-{
-    (void) fs;
-
-    //Recibe el handshake
-    Packet* p = Socket_RecvPacket(memoriaNueva);
-    if (!p)
-    {
-        LISSANDRA_LOG_ERROR("Memoria se desconecto durante handshake!");
-        return;
-    }
-
-    if (Packet_GetOpcode(p) != MSG_HANDSHAKE)
-    {
-        LISSANDRA_LOG_ERROR("HANDSHAKE: recibido opcode no esperado %hu", Packet_GetOpcode(p));
-        Packet_Destroy(p);
-        return;
-    }
-
-    uint8_t id;
-    Packet_Read(p, &id);
-
-    //----Recibo un handshake del cliente para ver si es una memoria
-    if (id != MEMORIA)
-    {
-        LISSANDRA_LOG_ERROR("Se conecto un desconocido! (id %d)", id);
-        Packet_Destroy(p);
-        Socket_Destroy(memoriaNueva);
-        return;
-    }
-
-    LISSANDRA_LOG_INFO("Se conecto una memoria en el socket: %d\n", memoriaNueva->_impl.Handle);
-
-    Packet_Destroy(p);
-
-    //Le envia a la memoria el TAMANIO_VALUE y el punto de montaje
-    uint32_t const tamanioValue = confLFS.TAMANIO_VALUE;
-    char const* const puntoMontaje = confLFS.PUNTO_MONTAJE;
-
-    p = Packet_Create(MSG_HANDSHAKE_RESPUESTA, 50);
-    Packet_Append(p, tamanioValue);
-    Packet_Append(p, puntoMontaje);
-    Socket_SendPacket(memoriaNueva, p);
-    Packet_Destroy(p);
-
-    //----Creo un hilo para cada memoria que se me conecta
-    Threads_CreateDetached(atender_memoria, memoriaNueva);
-}
-
-void iniciar_servidor(void)
-{
-    //----Creo socket de LFS, hago el bind y comienzo a escuchar
-    SocketOpts opts =
-    {
-        .SocketMode = SOCKET_SERVER,
-        .ServiceOrPort = confLFS.PUERTO_ESCUCHA,
-        .HostName = NULL,
-
-        // cuando una memoria conecte, llamar a memoria_conectar
-        .SocketOnAcceptClient = memoria_conectar,
-    };
-    sock_LFS = Socket_Create(&opts);
-
-    if (!sock_LFS)
-    {
-        LISSANDRA_LOG_FATAL("No pudo iniciarse el socket de escucha!!");
-        exit(1);
-    }
-
-    LISSANDRA_LOG_TRACE("Servidor LFS iniciado");
-
-    EventDispatcher_AddFDI(sock_LFS);
-}
-
 void mkdirRecursivo(char const* path)
 {
     char tmp[256];
@@ -168,21 +71,7 @@ void generarPathTabla(char* nombreTabla, char* buf)
 
 bool buscarBloqueLibre(size_t* bloqueLibre)
 {
-    pthread_mutex_lock(&bitarrayLock);
-
-    size_t i = 0;
-    for (; bitarray_test_bit(bitArray, i) && i < confLFS.CANTIDAD_BLOQUES; ++i);
-
-    if (i < confLFS.CANTIDAD_BLOQUES)
-    {
-        *bloqueLibre = i;
-
-        // marca el bloque como ocupado
-        bitarray_set_bit(bitArray, i);
-    }
-
-    pthread_mutex_unlock(&bitarrayLock);
-    return i < confLFS.CANTIDAD_BLOQUES;
+    return bitmap_reservar(bloqueLibre);
 }
 
 void generarPathBloque(size_t numBloque, char* buf)
@@ -192,14 +81,7 @@ void generarPathBloque(size_t numBloque, char* buf)
 
 void escribirValorBitarray(bool valor, size_t pos)
 {
-    pthread_mutex_lock(&bitarrayLock);
-
-    if (valor)
-        bitarray_set_bit(bitArray, pos);
-    else
-        bitarray_clean_bit(bitArray, pos);
-
-    pthread_mutex_unlock(&bitarrayLock);
+    bitmap_marcar(pos, valor);
 
     LISSANDRA_LOG_TRACE("FS: Marcado bloque %u como %s", pos, valor ? "ocupado" : "libre");
 }
@@ -220,12 +102,60 @@ bool get_table_metadata(char const* tabla, t_describe* res)
 
     uint16_t partitions = config_get_int_value(contenido, "PARTITIONS");
     uint32_t compaction_time = config_get_long_value(contenido, "COMPACTION_TIME");
+
+    uint32_t ttl = 0;
+    if (config_has_property(contenido, "TTL"))
+        ttl = config_get_long_value(contenido, "TTL");
+
+    bool pinned = false;
+    if (config_has_property(contenido, "PINNED"))
+        pinned = config_get_int_value(contenido, "PINNED") != 0;
     config_destroy(contenido);
 
     snprintf(res->table, NAME_MAX + 1, "%s", tabla);
     res->consistency = (uint8_t) ct;
     res->partitions = partitions;
     res->compaction_time = compaction_time;
+    res->ttl = ttl;
+    res->pinned = pinned;
+    res->expirados = 0;
+
+    return true;
+}
+
+bool set_table_metadata(t_describe const* metadata)
+{
+    char pathMetadata[PATH_MAX];
+    generarPathArchivo(metadata->table, "Metadata", pathMetadata);
+
+    // escribo aparte y renombro: quien lea la metadata ve la version vieja o la nueva, nunca una a medias
+    char pathNuevo[PATH_MAX];
+    generarPathArchivo(metadata->table, ".Metadata.nuevo", pathNuevo);
+
+    FILE* archivo = fopen(pathNuevo, "w");
+    if (!archivo)
+    {
+        LISSANDRA_LOG_SYSERROR("fopen");
+        return false;
+    }
+
+    fprintf(archivo, "CONSISTENCY=%s\n", CriteriaString[metadata->consistency].String);
+    fprintf(archivo, "PARTITIONS=%hu\n", metadata->partitions);
+    fprintf(archivo, "COMPACTION_TIME=%u\n", metadata->compaction_time);
+    if (metadata->ttl)
+        fprintf(archivo, "TTL=%u\n", metadata->ttl);
+    if (metadata->pinned)
+        fprintf(archivo, "PINNED=1\n");
+    fflush(archivo);
+    durabilidad_metadata_escrita(fileno(archivo));
+    fclose(archivo);
+
+    if (rename(pathNuevo, pathMetadata) < 0)
+    {
+        LISSANDRA_LOG_SYSERROR("rename");
+        unlink(pathNuevo);
+        return false;
+    }
 
     return true;
 }
@@ -335,19 +265,31 @@ int traverse_to_drop(char const* pathTabla)
     struct dirent* entry;
     while ((entry = readdir(dir)))
     {
-        if (*entry->d_name != '.')
-        {
-            char pathArchivo[PATH_MAX];
-            snprintf(pathArchivo, PATH_MAX, "%s/%s", pathTabla, entry->d_name);
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+            continue;
 
-            if (isLFSFile(entry->d_name))
-            {
+        char pathArchivo[PATH_MAX];
+        snprintf(pathArchivo, PATH_MAX, "%s/%s", pathTabla, entry->d_name);
+
+        // restos de una compactacion o desfragmentacion que no termino (.N.bin.P.nuevo, .Metadata.nuevo, .N.bin.defrag)
+        if (*entry->d_name == '.')
+        {
+            uint16_t particion, particiones;
+            if (sscanf(entry->d_name, ".%hu.bin.%hu.nuevo", &particion, &particiones) == 2 ||
+                string_ends_with(entry->d_name, ".defrag"))
                 borrarArchivoLFS(pathArchivo);
-                continue;
-            }
+            else
+                unlink(pathArchivo);
+            continue;
+        }
 
-            unlink(pathArchivo);
+        if (isLFSFile(entry->d_name))
+        {
+            borrarArchivoLFS(pathArchivo);
+            continue;
         }
+
+        unlink(pathArchivo);
     }
 
     closedir(dir);
@@ -365,187 +307,86 @@ void generarPathParticion(uint16_t particion, char* pathTabla, char* pathPartici
     snprintf(pathParticion, PATH_MAX, "%s/%d.bin", pathTabla, particion);
 }
 
-bool get_biggest_timestamp(char const* contenido, uint16_t key, t_registro* resultado)
+bool get_biggest_timestamp(char const* contenido, size_t len, uint16_t key, t_registro* resultado)
 {
-    Vector registros = string_split(contenido, "\n");
+    t_parser parser;
+    parser_init(&parser, contenido, len);
 
+    // solo se decodifican timestamp y value de los registros con la key buscada
     bool found = false;
-    char** const tokens = Vector_data(&registros);
-    for (size_t i = 0; i < Vector_size(&registros); ++i)
+    t_vista_registro registro;
+    while (parser_next_key(&parser, key, &registro))
     {
-        char* const registro = tokens[i];
-
-        Vector campos = string_split(registro, ";");
-        // timestamp;key;value
-        char** const fields = Vector_data(&campos);
-        uint64_t const timestamp = strtoull(fields[0], NULL, 10);
-
-        uint16_t keyRegistro;
-        if (!ValidateKey(fields[1], &keyRegistro))
-        {
-            LISSANDRA_LOG_ERROR("Error! clave invalida %s en archivo!!", fields[1]);
-            Vector_Destruct(&campos);
-            continue;
-        }
-
-        if (key == keyRegistro)
+        if (!found || resultado->timestamp < registro.Timestamp)
         {
-            char* const value = fields[2];
-            if (!found)
-            {
-                found = true;
+            found = true;
 
-                resultado->key = keyRegistro;
-                resultado->timestamp = timestamp;
-                strncpy(resultado->value, value, confLFS.TAMANIO_VALUE + 1);
-            }
-            else if (resultado->timestamp < timestamp)
-            {
-                resultado->timestamp = timestamp;
-                strncpy(resultado->value, value, confLFS.TAMANIO_VALUE + 1);
-            }
+            resultado->key = key;
+            resultado->timestamp = registro.Timestamp;
+            resultado->tombstone = registro.Tombstone;
+            parser_copiar_value(&registro, resultado->value, confLFS.TAMANIO_VALUE);
         }
-
-        Vector_Destruct(&campos);
     }
 
-    Vector_Destruct(&registros);
+    estadisticas_parseados(len, parser.Lineas);
     return found;
 }
 
-bool scanParticion(char const* pathParticion, uint16_t key, t_registro* registro)
+bool scanArchivo(t_archivo const* archivo, uint16_t key, t_registro* registro)
 {
-    char* contenido = leerArchivoLFS(pathParticion);
-    if (!contenido)
-        return NULL;
-
-    bool resultado = get_biggest_timestamp(contenido, key, registro);
+    char* contenido = snapshot_leer_archivo(archivo);
+    bool resultado = get_biggest_timestamp(contenido, archivo->Size, key, registro);
     Free(contenido);
     return resultado;
 }
 
-bool temporales_get_biggest_timestamp(char const* pathTabla, uint16_t key, t_registro* registro)
+char* leerArchivoLFS(const char* path)
 {
-    DIR* dir;
-    if (!(dir = opendir(pathTabla)))
+    size_t longitudArchivo;
+    Vector bloques;
+    if (!leerMetadataArchivoLFS(path, &longitudArchivo, &bloques, NULL))
     {
-        LISSANDRA_LOG_FATAL("SELECT: No pude abrir directorio %s. No debería pasar!", pathTabla);
+        LISSANDRA_LOG_ERROR("No se encontro el archivo en el File System");
         return NULL;
     }
 
-    bool foundAny = false;
-    struct dirent* entry;
-    while ((entry = readdir(dir)))
-    {
-        char path[PATH_MAX];
-        if (*entry->d_name != '.')
-        {
-            struct stat info;
-            snprintf(path, PATH_MAX, "%s/%s", pathTabla, entry->d_name);
-
-            if (stat(path, &info) != 0)
-            {
-                LISSANDRA_LOG_SYSERROR("stat");
-                closedir(dir);
-                return NULL;
-            }
-
-            bool istmp = false;
-            {
-                Vector aux = string_split(path, ".");
-                if (!Vector_empty(&aux))
-                {
-                    char const** ext = Vector_back(&aux);
-                    if (0 == strcmp(*ext, "tmp") || 0 == strcmp(*ext, "tmpc"))
-                        istmp = true;
-                }
-                Vector_Destruct(&aux);
-            }
-
-            if (!istmp)
-                continue;
-
-            char* contenido = leerArchivoLFS(path);
-            if (!contenido)
-                continue;
-
-            t_registro* registroTemp = Malloc(REGISTRO_SIZE);
-            if (!get_biggest_timestamp(contenido, key, registroTemp))
-            {
-                Free(registroTemp);
-                Free(contenido);
-                continue;
-            }
-
-            if (!foundAny)
-            {
-                foundAny = true;
-
-                memcpy(registro, registroTemp, REGISTRO_SIZE);
-            }
-            else if (registro->timestamp < registroTemp->timestamp)
-            {
-                registro->timestamp = registroTemp->timestamp;
-                strncpy(registro->value, registroTemp->value, confLFS.TAMANIO_VALUE + 1);
-            }
-
-            Free(registroTemp);
-            Free(contenido);
-        }
-    }
-
-    closedir(dir);
-    return foundAny;
+    char* const contenido = leerBloquesLFS(longitudArchivo, Vector_data(&bloques), Vector_size(&bloques));
+    Vector_Destruct(&bloques);
+    return contenido;
 }
 
-t_registro const* get_newest(t_registro const* particion, t_registro const* temporales, t_registro const* memtable)
+bool leerMetadataArchivoLFS(char const* path, size_t* size, Vector* bloques, uint64_t* timestampMax)
 {
-    size_t num = 0;
-    t_registro const* registros[3];
-
-    if (particion)
-        registros[num++] = particion;
-
-    if (temporales)
-        registros[num++] = temporales;
-
-    if (memtable)
-        registros[num++] = memtable;
+    t_config* file = config_create(path);
+    if (!file)
+        return false;
 
-    t_registro const* mayor = NULL;
-    uint64_t timestampMayor = 0;
-    for (size_t i = 0; i < num; ++i)
+    Vector arrayBloques = config_get_array_value(file, "BLOCKS");
+    *size = config_get_long_value(file, "SIZE");
+    if (timestampMax)
     {
-        if (!mayor || registros[i]->timestamp > timestampMayor)
-        {
-            timestampMayor = registros[i]->timestamp;
-            mayor = registros[i];
-        }
+        *timestampMax = TIMESTAMP_DESCONOCIDO;
+        if (config_has_property(file, "TIMESTAMP_MAX"))
+            *timestampMax = strtoull(config_get_string_value(file, "TIMESTAMP_MAX"), NULL, 10);
     }
+    config_destroy(file);
 
-    return mayor;
-}
+    Vector_Construct(bloques, sizeof(size_t), NULL, Vector_size(&arrayBloques));
 
-char* leerArchivoLFS(const char* path)
-{
-    Vector bloques;
-    size_t bytesLeft;
+    char** const numeros = Vector_data(&arrayBloques);
+    for (size_t i = 0; i < Vector_size(&arrayBloques); ++i)
     {
-        t_config* file = config_create(path);
-        if (!file)
-        {
-            LISSANDRA_LOG_ERROR("No se encontro el archivo en el File System");
-            return NULL;
-        }
-
-        bloques = config_get_array_value(file, "BLOCKS");
-        bytesLeft = config_get_long_value(file, "SIZE");
-        config_destroy(file);
+        size_t const numBloque = strtoul(numeros[i], NULL, 10);
+        Vector_push_back(bloques, &numBloque);
     }
 
-    size_t const longitudArchivo = bytesLeft;
+    Vector_Destruct(&arrayBloques);
+    return true;
+}
 
-    size_t const bloquesTotales = Vector_size(&bloques);
+char* leerBloquesLFS(size_t longitudArchivo, size_t const* bloques, size_t bloquesTotales)
+{
+    size_t bytesLeft = longitudArchivo;
 
     // cuanto leer
     size_t readLen = confLFS.TAMANIO_BLOQUES;
@@ -555,13 +396,12 @@ char* leerArchivoLFS(const char* path)
     char* const contenido = Malloc(longitudArchivo + 1);
     size_t offset = 0;
 
-    char** const arrayBloques = Vector_data(&bloques);
-    for (size_t i = 0; i < bloquesTotales; ++i)
-    {
-        size_t const numBloque = strtoul(arrayBloques[i], NULL, 10);
+    estadisticas_archivo_leido(bloquesTotales);
 
+    for (size_t i = 0; i < bloquesTotales && bytesLeft; ++i)
+    {
         char pathBloque[PATH_MAX];
-        generarPathBloque(numBloque, pathBloque);
+        generarPathBloque(bloques[i], pathBloque);
 
         int fd = open(pathBloque, O_RDONLY);
         if (fd == -1)
@@ -594,49 +434,42 @@ char* leerArchivoLFS(const char* path)
             readLen = bytesLeft;
     }
 
-    Vector_Destruct(&bloques);
-
     contenido[longitudArchivo] = '\0';
     return contenido;
 }
 
-static bool _pedirBloquesNuevos(char const* path, Vector* bloques, size_t n)
+bool pedirBloquesContiguosLFS(size_t n, size_t* bloques)
+{
+    return bitmap_reservar_contiguos(n, bloques);
+}
+
+bool pedirBloquesLFS(size_t n, size_t* bloques)
 {
-    Vector nuevos;
-    Vector_Construct(&nuevos, sizeof(size_t), NULL, n);
+    // primero intento que el archivo quede contiguo, si no hay un tramo libre tan largo uso los que haya
+    if (pedirBloquesContiguosLFS(n, bloques))
+        return true;
+
     for (size_t i = 0; i < n; ++i)
     {
-        size_t bloque;
-        if (!buscarBloqueLibre(&bloque))
+        if (!buscarBloqueLibre(bloques + i))
         {
-            LISSANDRA_LOG_ERROR("No hay más bloques disponibles para guardar el archivo %s! Se perderán datos", path);
-
             // liberar los que pude pedir hasta ahora
-            for (size_t j = 0; j < Vector_size(&nuevos); ++j)
-            {
-                size_t* const b = Vector_at(&nuevos, j);
-                escribirValorBitarray(false, *b);
-            }
+            for (size_t j = 0; j < i; ++j)
+                escribirValorBitarray(false, bloques[j]);
 
-            Vector_Destruct(&nuevos);
             return false;
         }
-
-        Vector_push_back(&nuevos, &bloque);
-    }
-
-    for (size_t i = 0; i < Vector_size(&nuevos); ++i)
-    {
-        size_t* const bloque = Vector_at(&nuevos, i);
-
-        char* blockNum = string_from_format("%u", *bloque);
-        Vector_push_back(bloques, &blockNum);
     }
 
-    Vector_Destruct(&nuevos);
     return true;
 }
 
+void liberarBloquesLFS(size_t const* bloques, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        escribirValorBitarray(false, bloques[i]);
+}
+
 static inline void _escribirBloque(size_t block, char const* buf, size_t len)
 {
     char pathBloque[PATH_MAX];
@@ -657,65 +490,49 @@ static inline void _escribirBloque(size_t block, char const* buf, size_t len)
     }
 
     memcpy(mapping, buf, len);
+    durabilidad_bloque_escrito(block, mapping, len);
 
     munmap(mapping, confLFS.TAMANIO_BLOQUES);
     close(fd);
 }
 
-void escribirArchivoLFS(char const* path, char const* buf, size_t len)
+void escribirBloquesLFS(size_t const* bloques, char const* buf, size_t len)
 {
-    t_config* file = config_create(path);
-    if (!file)
-        return;
-
-    size_t bloquesTotales = len / confLFS.TAMANIO_BLOQUES;
-    if (len % confLFS.TAMANIO_BLOQUES)
-        ++bloquesTotales;
-
-    Vector blocks = config_get_array_value(file, "BLOCKS");
-
-    size_t const bloquesActuales = Vector_size(&blocks);
-    if (bloquesActuales < bloquesTotales)
-    {
-        // calcular cuantos bloques nuevos se requieren
-        size_t const bloquesNecesarios = bloquesTotales - bloquesActuales;
-
-        // pedir bloques nuevos
-        if (!_pedirBloquesNuevos(path, &blocks, bloquesNecesarios))
-        {
-            Vector_Destruct(&blocks);
-            config_destroy(file);
-            return;
-        }
-    }
-
-    char* newSize = string_from_format("%u", len);
+    estadisticas_bytes_escritos(len);
 
-    // listo, ya el archivo tiene los bloques suficientes, escribamos bloque a bloque
-    char** const blockArray = Vector_data(&blocks);
     size_t i = 0;
-    while (i < len / confLFS.TAMANIO_BLOQUES)
+    for (; i < len / confLFS.TAMANIO_BLOQUES; ++i)
     {
-        size_t const blockNum = strtoul(blockArray[i++], NULL, 10);
-
-        _escribirBloque(blockNum, buf, confLFS.TAMANIO_BLOQUES);
+        _escribirBloque(bloques[i], buf, confLFS.TAMANIO_BLOQUES);
         buf += confLFS.TAMANIO_BLOQUES;
     }
 
     // ultimo bloque
     if (len % confLFS.TAMANIO_BLOQUES)
-        _escribirBloque(strtoul(blockArray[i], NULL, 10), buf, len % confLFS.TAMANIO_BLOQUES);
-
-    config_set_value(file, "SIZE", newSize);
-    Free(newSize);
-
-    config_set_array_value(file, "BLOCKS", &blocks);
-    Vector_Destruct(&blocks);
+        _escribirBloque(bloques[i], buf, len % confLFS.TAMANIO_BLOQUES);
+}
 
-    config_save(file);
-    config_destroy(file);
+void guardarArchivoLFS(char const* path, size_t size, size_t const* bloques, size_t numBloques, uint64_t timestampMax)
+{
+    FILE* archivo = fopen(path, "w");
+    if (!archivo)
+    {
+        LISSANDRA_LOG_SYSERROR("fopen");
+        return;
+    }
 
-    LISSANDRA_LOG_TRACE("FS: Escribo %u bytes en archivo %s!", len, path);
+    fprintf(archivo, "SIZE=%zu\n", size);
+    fprintf(archivo, "BLOCKS=[");
+    for (size_t i = 0; i < numBloques; ++i)
+        fprintf(archivo, i ? ",%zu" : "%zu", bloques[i]);
+    fprintf(archivo, "]\n");
+    if (timestampMax != TIMESTAMP_DESCONOCIDO)
+        fprintf(archivo, "TIMESTAMP_MAX=%" PRIu64 "\n", timestampMax);
+    fflush(archivo);
+    durabilidad_metadata_escrita(fileno(archivo));
+    fclose(archivo);
+
+    LISSANDRA_LOG_TRACE("FS: Guardado archivo %s (%zu bytes, %zu bloques)", path, size, numBloques);
 }
 
 void crearArchivoLFS(char const* path, size_t block)
@@ -723,6 +540,8 @@ void crearArchivoLFS(char const* path, size_t block)
     FILE* temporal = fopen(path, "w");
     fprintf(temporal, "SIZE=0\n");
     fprintf(temporal, "BLOCKS=[%u]\n", block);
+    fflush(temporal);
+    durabilidad_metadata_escrita(fileno(temporal));
     fclose(temporal);
 
     LISSANDRA_LOG_TRACE("FS: Creado archivo %s!", path);
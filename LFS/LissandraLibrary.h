@@ -3,6 +3,7 @@
 #define LISSANDRA_LISSANDRALIBRARY_H
 
 #include "Memtable.h"
+#include "Snapshot.h"
 #include <libcommons/list.h>
 #include <limits.h>
 #include <stdbool.h>
@@ -15,9 +16,16 @@ typedef struct
     uint8_t consistency;
     uint16_t partitions;
     uint32_t compaction_time;
-} t_describe;
 
-void iniciar_servidor(void);
+    // milisegundos de vida de los registros, 0 si no expiran (TTL en la metadata, opcional)
+    uint32_t ttl;
+
+    // particiones decodificadas en memoria (PINNED=1 en la metadata, opcional)
+    bool pinned;
+
+    // registros expirados que descarto el compactador desde el arranque, no se guarda en la metadata
+    uint64_t expirados;
+} t_describe;
 
 void mkdirRecursivo(char const* path);
 
@@ -35,6 +43,9 @@ void escribirValorBitarray(bool valor, size_t pos);
 
 bool get_table_metadata(char const* tabla, t_describe* res);
 
+// reemplaza atomicamente la metadata de la tabla
+bool set_table_metadata(t_describe const* metadata);
+
 int traverse(char const* fn, t_list* lista, char const* tabla);
 
 bool dirIsEmpty(char const* path);
@@ -49,18 +60,32 @@ uint16_t get_particion(uint16_t particiones, uint16_t key);
 
 void generarPathParticion(uint16_t particion, char* pathTabla, char* pathParticion);
 
-bool get_biggest_timestamp(char const* contenido, uint16_t key, t_registro* resultado);
-
-bool scanParticion(char const* pathParticion, uint16_t key, t_registro* registro);
-
-bool temporales_get_biggest_timestamp(char const* pathTabla, uint16_t key, t_registro* registro);
+bool get_biggest_timestamp(char const* contenido, size_t len, uint16_t key, t_registro* resultado);
 
-t_registro const* get_newest(t_registro const* particion, t_registro const* temporales, t_registro const* memtable);
+bool scanArchivo(t_archivo const* archivo, uint16_t key, t_registro* registro);
 
 // primitivas FS
 char* leerArchivoLFS(char const* path);
 
-void escribirArchivoLFS(char const* path, char const* buf, size_t len);
+// timestampMax (opcional) queda en TIMESTAMP_DESCONOCIDO si la metadata no lo tiene
+bool leerMetadataArchivoLFS(char const* path, size_t* size, Vector* bloques, uint64_t* timestampMax);
+
+char* leerBloquesLFS(size_t size, size_t const* bloques, size_t numBloques);
+
+// reserva n bloques libres, o ninguno si no alcanzan
+// si hay un tramo libre de n bloques seguidos los toma de ahi
+bool pedirBloquesLFS(size_t n, size_t* bloques);
+
+// reserva n bloques consecutivos, o ninguno si no hay un tramo libre tan largo
+bool pedirBloquesContiguosLFS(size_t n, size_t* bloques);
+
+void liberarBloquesLFS(size_t const* bloques, size_t n);
+
+// escribe len bytes en los bloques dados, que deben alcanzar para contenerlos
+void escribirBloquesLFS(size_t const* bloques, char const* buf, size_t len);
+
+// escribe el archivo de metadata (SIZE, BLOCKS y TIMESTAMP_MAX si se conoce) de un archivo LFS
+void guardarArchivoLFS(char const* path, size_t size, size_t const* bloques, size_t numBloques, uint64_t timestampMax);
 
 void crearArchivoLFS(char const* path, size_t block);
 
@@ -1,8 +1,12 @@
 
 #include "Memtable.h"
 #include "Config.h"
+#include "Durabilidad.h"
+#include "Estadisticas.h"
 #include "LissandraLibrary.h"
-#include <fcntl.h>
+#include "Snapshot.h"
+#include "WAL.h"
+#include <inttypes.h>
 #include <libcommons/config.h>
 #include <libcommons/dictionary.h>
 #include <libcommons/string.h>
@@ -11,10 +15,14 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/file.h>
-#include <unistd.h>
 
 static t_dictionary* memtable = NULL;
+
+// memtable que se esta bajando a disco. Sigue visible para los SELECT hasta que cada tabla publique su temporal
+static t_dictionary* memtableDump = NULL;
+
+// tablas borradas durante el dump: sus registros en memtableDump ya no se muestran ni se reintentan
+static t_dictionary* descartadasDump = NULL;
 static pthread_rwlock_t memtableMutex = PTHREAD_RWLOCK_INITIALIZER;
 
 void _dump(void);
@@ -25,20 +33,14 @@ static void _delete_memtable_table(void* registros)
     Free(registros);
 }
 
-void memtable_create(void)
-{
-    memtable = dictionary_create();
-    LISSANDRA_LOG_TRACE("Memtable creada");
-}
-
-void memtable_new_elem(char const* nombreTabla, uint16_t key, char const* value, uint64_t timestamp)
+static void _insertar(char const* nombreTabla, uint16_t key, char const* value, uint64_t timestamp)
 {
+    // llamar con memtableMutex tomado para escritura
     t_registro* new = Malloc(REGISTRO_SIZE);
     new->key = key;
     new->timestamp = timestamp;
-    strncpy(new->value, value, confLFS.TAMANIO_VALUE + 1);
-
-    pthread_rwlock_wrlock(&memtableMutex);
+    new->tombstone = !value;
+    strncpy(new->value, value ? value : "", confLFS.TAMANIO_VALUE + 1);
 
     Vector* registros = dictionary_get(memtable, nombreTabla);
     if (!registros)
@@ -51,103 +53,184 @@ void memtable_new_elem(char const* nombreTabla, uint16_t key, char const* value,
 
     Vector_push_back(registros, new);
     Free(new);
+}
+
+static void _descartar(char const* nombreTabla)
+{
+    dictionary_remove_and_destroy(memtable, nombreTabla, _delete_memtable_table);
+}
+
+void memtable_create(void)
+{
+    memtable = dictionary_create();
+    descartadasDump = dictionary_create();
+
+    // lo que quedo en el WAL sin bajar a un temporal vuelve a la memtable
+    wal_init(_insertar, _descartar);
+    LISSANDRA_LOG_TRACE("Memtable creada");
+}
+
+void memtable_new_elem(char const* nombreTabla, uint16_t key, char const* value, uint64_t timestamp)
+{
+    estadisticas_wrlock(&memtableMutex);
+
+    _insertar(nombreTabla, key, value, timestamp);
+
+    // bajo el mismo lock: el registro queda en el segmento del WAL que corresponde a esta memtable
+    uint64_t const lsn = wal_append(nombreTabla, key, value, timestamp);
 
     pthread_rwlock_unlock(&memtableMutex);
+
+    // el INSERT se confirma recien cuando el registro esta en disco. No se espera con el lock tomado,
+    // asi otros INSERT pueden sumarse al mismo fdatasync
+    wal_sync(lsn);
 }
 
-bool memtable_get_biggest_timestamp(char const* nombreTabla, uint16_t key, t_registro* resultado)
+void memtable_new_elems(char const* nombreTabla, t_insert const* inserts, size_t cantidad)
 {
-    pthread_rwlock_rdlock(&memtableMutex);
+    if (!cantidad)
+        return;
 
-    Vector* const registros = dictionary_get(memtable, nombreTabla);
-    if (!registros)
+    estadisticas_wrlock(&memtableMutex);
+
+    uint64_t lsn = 0;
+    for (size_t i = 0; i < cantidad; ++i)
     {
-        pthread_rwlock_unlock(&memtableMutex);
-        return NULL;
+        _insertar(nombreTabla, inserts[i].key, inserts[i].value, inserts[i].timestamp);
+        lsn = wal_append(nombreTabla, inserts[i].key, inserts[i].value, inserts[i].timestamp);
     }
 
+    pthread_rwlock_unlock(&memtableMutex);
+
+    // el ultimo LSN cubre a todos los anteriores
+    wal_sync(lsn);
+}
+
+static bool _get_biggest_timestamp(t_dictionary* dict, char const* nombreTabla, uint16_t key, t_registro* resultado)
+{
+    Vector* const registros = dictionary_get(dict, nombreTabla);
+    if (!registros)
+        return false;
+
     size_t const cantElementos = Vector_size(registros);
+    estadisticas_examinados(cantElementos);
 
     t_registro* registroMayor = NULL;
-    uint64_t timestampMayor = 0;
-
     for (size_t i = 0; i < cantElementos; ++i)
     {
         t_registro* const registro = Vector_at(registros, i);
         if (registro->key == key)
         {
-            if (!registroMayor || registro->timestamp > timestampMayor)
-            {
-                timestampMayor = registro->timestamp;
+            if (!registroMayor || registro->timestamp > registroMayor->timestamp)
                 registroMayor = registro;
-            }
         }
     }
 
     if (registroMayor)
         memcpy(resultado, registroMayor, REGISTRO_SIZE);
 
-    pthread_rwlock_unlock(&memtableMutex);
     return registroMayor != NULL;
 }
 
-void memtable_delete_table(char const* nombreTabla)
+bool memtable_get_biggest_timestamp(char const* nombreTabla, uint16_t key, t_registro* resultado)
 {
-    pthread_rwlock_wrlock(&memtableMutex);
+    estadisticas_rdlock(&memtableMutex);
 
-    dictionary_remove_and_destroy(memtable, nombreTabla, _delete_memtable_table);
+    bool found = _get_biggest_timestamp(memtable, nombreTabla, key, resultado);
+    if (memtableDump && !dictionary_has_key(descartadasDump, nombreTabla))
+    {
+        t_registro* registroDump = Malloc(REGISTRO_SIZE);
+        if (_get_biggest_timestamp(memtableDump, nombreTabla, key, registroDump) &&
+            (!found || registroDump->timestamp > resultado->timestamp))
+        {
+            found = true;
+            memcpy(resultado, registroDump, REGISTRO_SIZE);
+        }
+        Free(registroDump);
+    }
 
     pthread_rwlock_unlock(&memtableMutex);
+    return found;
 }
 
-static void _dump_table(char const* nombreTabla, void* registros)
+static void _iterate_keys(t_dictionary* dict, char const* nombreTabla, void(*fn)(uint16_t key, void* data), void* data)
 {
-    char pathTable[PATH_MAX];
-    snprintf(pathTable, PATH_MAX, "%sTables/%s", confLFS.PUNTO_MONTAJE, nombreTabla);
-    int fd = open(pathTable, O_RDONLY);
-    if (fd == -1)
-    {
-        LISSANDRA_LOG_ERROR("La tabla hallada en la memtable no se encuentra en el File System... Esto no deberia estar pasando");
+    Vector* const registros = dictionary_get(dict, nombreTabla);
+    if (!registros)
         return;
-    }
-
-    // bloqueo sugerido exclusivo (escritura, para no pisar el compactador o select)
-    // "un dump tiene que bloquear tanto los select como las compactaciones"
-    // Maximiliano Felice 15/07/2019 21:41
-    flock(fd, LOCK_EX);
 
-    size_t bloqueLibre;
-    if (!buscarBloqueLibre(&bloqueLibre))
+    for (size_t i = 0; i < Vector_size(registros); ++i)
     {
-        LISSANDRA_LOG_ERROR("No hay espacio en el File System. Se perderan datos...");
-        close(fd);
-        return;
+        t_registro* const registro = Vector_at(registros, i);
+        fn(registro->key, data);
     }
+}
+
+void memtable_iterate_keys(char const* nombreTabla, void(*fn)(uint16_t key, void* data), void* data)
+{
+    pthread_rwlock_rdlock(&memtableMutex);
+
+    _iterate_keys(memtable, nombreTabla, fn, data);
+    if (memtableDump && !dictionary_has_key(descartadasDump, nombreTabla))
+        _iterate_keys(memtableDump, nombreTabla, fn, data);
+
+    pthread_rwlock_unlock(&memtableMutex);
+}
+
+void memtable_delete_table(char const* nombreTabla)
+{
+    pthread_rwlock_wrlock(&memtableMutex);
+
+    _descartar(nombreTabla);
+    if (memtableDump)
+        dictionary_put(descartadasDump, nombreTabla, NULL);
+
+    // la marca queda despues de todos los registros de la tabla. Tiene que estar en disco antes de borrarla,
+    // si no una tabla nueva con el mismo nombre recibiria los registros viejos al reaplicar
+    uint64_t const lsn = wal_append_drop(nombreTabla);
+
+    pthread_rwlock_unlock(&memtableMutex);
+
+    wal_sync(lsn);
+}
+
+static void _dump_table(char const* nombreTabla, void* registros, void* fallidas)
+{
+    estadisticas_inicio();
+    estadisticas_examinados(Vector_size(registros));
 
     Vector content;
     Vector_Construct(&content, sizeof(char), NULL, 0);
 
+    uint64_t timestampMax = 0;
     for (size_t i = 0; i < Vector_size(registros); ++i)
     {
         t_registro* const registro = Vector_at(registros, i);
+        if (registro->timestamp > timestampMax)
+            timestampMax = registro->timestamp;
 
-        size_t len = snprintf(NULL, 0, "%llu;%d;%s\n", registro->timestamp, registro->key, registro->value);
+        // los tombstones van sin value
+        size_t const len = registro->tombstone ?
+            (size_t) snprintf(NULL, 0, "%" PRIu64 ";%d\n", registro->timestamp, registro->key) :
+            (size_t) snprintf(NULL, 0, "%" PRIu64 ";%d;%s\n", registro->timestamp, registro->key, registro->value);
         char field[len + 1];
-        snprintf(field, len + 1, "%llu;%d;%s\n", registro->timestamp, registro->key, registro->value);
+        if (registro->tombstone)
+            snprintf(field, len + 1, "%" PRIu64 ";%d\n", registro->timestamp, registro->key);
+        else
+            snprintf(field, len + 1, "%" PRIu64 ";%d;%s\n", registro->timestamp, registro->key, registro->value);
         Vector_insert_range(&content, Vector_size(&content), field, field + len);
     }
 
-    //Arma el path del archivo temporal. Si ese path ya existe, le busca nombre hasta encontrar uno libre
-    char pathTemporal[PATH_MAX];
-    for (size_t j = 0; snprintf(pathTemporal, PATH_MAX, "%sTables/%s/%d.tmp", confLFS.PUNTO_MONTAJE, nombreTabla, j), existeArchivo(pathTemporal); ++j);
-
-    crearArchivoLFS(pathTemporal, bloqueLibre);
-    escribirArchivoLFS(pathTemporal, Vector_data(&content), Vector_size(&content));
+    // baja el temporal y publica una nueva version de la tabla, los SELECT en curso siguen con la anterior
+    if (!snapshot_dump(nombreTabla, Vector_data(&content), Vector_size(&content), timestampMax))
+    {
+        LISSANDRA_LOG_ERROR("No se pudo bajar la memtable de la tabla %s. Se reintentara en el proximo dump", nombreTabla);
+        Vector_push_back(fallidas, &nombreTabla);
+    }
+    else
+        estadisticas_fin(nombreTabla, OPERACION_DUMP);
 
     Vector_Destruct(&content);
-
-    // fin bloqueo
-    close(fd);
 }
 
 void* memtable_dump_thread(void* pt)
@@ -158,25 +241,79 @@ void* memtable_dump_thread(void* pt)
     return NULL;
 }
 
+void memtable_dump(void)
+{
+    _dump();
+}
+
 void memtable_destroy(void)
 {
     dictionary_destroy_and_destroy_elements(memtable, _delete_memtable_table);
+    dictionary_destroy(descartadasDump);
+    wal_destroy();
 }
 
 /* PRIVATE */
 void _dump(void)
 {
-    t_dictionary* oldMemtable;
+    uint64_t const inicio = GetMSTime();
+    uint64_t const nsFlush = durabilidad_ns_hilo();
 
+    uint32_t segmento;
     {
         //intercambio punteros
-        pthread_rwlock_wrlock(&memtableMutex);
-        oldMemtable = memtable;
+        estadisticas_wrlock(&memtableMutex);
+        memtableDump = memtable;
         memtable = dictionary_create();
+
+        // los INSERT que siguen van a un segmento nuevo del WAL
+        segmento = wal_rotate();
         pthread_rwlock_unlock(&memtableMutex);
     }
 
     //Itera tantas veces como tablas contó que había en ese momento en la memtable
-    dictionary_iterator(oldMemtable, _dump_table);
+    Vector fallidas;
+    Vector_Construct(&fallidas, sizeof(char const*), NULL, 0);
+    dictionary_iterator_with_data(memtableDump, _dump_table, &fallidas);
+
+    t_dictionary* oldMemtable;
+    {
+        // ya todas las tablas publicaron su temporal, dejo de mostrar la memtable vieja
+        estadisticas_wrlock(&memtableMutex);
+
+        // las tablas que no se pudieron bajar vuelven a la memtable actual. Sus registros siguen en el WAL
+        // porque no lo trunco hasta un dump completo, que ya los va a incluir
+        for (size_t i = 0; i < Vector_size(&fallidas); ++i)
+        {
+            char const* const nombreTabla = *(char const**) Vector_at(&fallidas, i);
+
+            // borrada en el medio: el directorio puede ser ya el de otra tabla con el mismo nombre
+            if (dictionary_has_key(descartadasDump, nombreTabla))
+                continue;
+
+            Vector* const registros = dictionary_get(memtableDump, nombreTabla);
+            for (size_t j = 0; j < Vector_size(registros); ++j)
+            {
+                t_registro* const registro = Vector_at(registros, j);
+                _insertar(nombreTabla, registro->key, registro->tombstone ? NULL : registro->value, registro->timestamp);
+            }
+        }
+
+        oldMemtable = memtableDump;
+        memtableDump = NULL;
+        dictionary_clean(descartadasDump);
+        pthread_rwlock_unlock(&memtableMutex);
+    }
+
+    // todo lo del segmento cerrado ya esta en temporales
+    if (Vector_empty(&fallidas))
+        wal_truncate(segmento);
+
+    if (!dictionary_is_empty(oldMemtable))
+        LISSANDRA_LOG_DEBUG("DUMP: %zu tablas bajadas en %" PRIu64 "ms (%" PRIu64 "us sincronizando a disco)",
+                            (size_t) dictionary_size(oldMemtable) - Vector_size(&fallidas),
+                            GetMSTimeDiff(inicio, GetMSTime()), (durabilidad_ns_hilo() - nsFlush) / 1000);
+
+    Vector_Destruct(&fallidas);
     dictionary_destroy_and_destroy_elements(oldMemtable, _delete_memtable_table);
 }
@@ -2,6 +2,7 @@
 #ifndef LISSANDRA_MEMTABLE_H
 #define LISSANDRA_MEMTABLE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <vector.h>
 
@@ -11,24 +12,44 @@ typedef struct
 {
     uint64_t timestamp;
     uint16_t key;
+
+    // registro de un DELETE, value vacio
+    bool tombstone;
     char value[];
 } t_registro;
 
+// un INSERT de un lote
+typedef struct
+{
+    uint16_t key;
+    char const* value;
+    uint64_t timestamp;
+} t_insert;
+
 #define REGISTRO_SIZE sizeof(t_registro) + confLFS.TAMANIO_VALUE + 1
 
 void memtable_create(void);
 
-//Funcion para meterle nuevos elementos a la memtable
+//Funcion para meterle nuevos elementos a la memtable, value NULL es un tombstone
 void memtable_new_elem(char const* nombreTabla, uint16_t key, char const* value, uint64_t timestamp);
 
+//Igual que memtable_new_elem para varios registros de la misma tabla, esperando un solo fdatasync del WAL
+void memtable_new_elems(char const* nombreTabla, t_insert const* inserts, size_t cantidad);
+
 //Funcion para buscar segun una key dada el registro con mayor timestamp
 bool memtable_get_biggest_timestamp(char const* nombreTabla, uint16_t key, t_registro* resultado);
 
+//Funcion para recorrer las claves de una tabla presentes en la memtable
+void memtable_iterate_keys(char const* nombreTabla, void(*fn)(uint16_t key, void* data), void* data);
+
 //Funcion para eliminar un elemento de la memtable
 void memtable_delete_table(char const* nombreTabla);
 
 void* memtable_dump_thread(void*);
 
+//Baja la memtable a temporales en el hilo que llama, sin pasar por el timer
+void memtable_dump(void);
+
 void memtable_destroy(void);
 
 #endif //LISSANDRA_MEMTABLE_H
@@ -0,0 +1,161 @@
+
+#ifndef LISSANDRA_PARSER_H
+#define LISSANDRA_PARSER_H
+
+#include <Logger.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Parser de registros "timestamp;key;value\n" de una sola pasada y sin memoria dinamica.
+ * Una linea "timestamp;key\n", sin value, es un tombstone: la key se borro en ese timestamp.
+ * Los delimitadores se buscan con memchr (vectorizado en glibc) y el value se devuelve como una vista
+ * dentro del buffer leido, sin copiarlo ni terminarlo en '\0'.
+ */
+
+typedef struct
+{
+    uint64_t Timestamp;
+    uint16_t Key;
+
+    // apunta dentro del buffer, no esta terminado en '\0'
+    char const* Value;
+    size_t ValueLen;
+
+    // DELETE: sin value
+    bool Tombstone;
+} t_vista_registro;
+
+typedef struct
+{
+    char const* Pos;
+    char const* Fin;
+
+    // lineas recorridas hasta ahora, validas o no
+    size_t Lineas;
+} t_parser;
+
+static inline void parser_init(t_parser* parser, char const* buf, size_t len)
+{
+    parser->Pos = buf;
+    parser->Fin = buf + len;
+    parser->Lineas = 0;
+}
+
+// entero decimal sin signo en [ini, fin). false si esta vacio, tiene algo que no sea digito o supera max
+static inline bool _parser_uint(char const* ini, char const* fin, uint64_t max, uint64_t* resultado)
+{
+    if (ini == fin)
+        return false;
+
+    uint64_t n = 0;
+    for (; ini != fin; ++ini)
+    {
+        unsigned const digito = (unsigned) (*ini - '0');
+        if (digito > 9 || n > (max - digito) / 10)
+            return false;
+
+        n = n * 10 + digito;
+    }
+
+    *resultado = n;
+    return true;
+}
+
+// separa la siguiente linea en sus campos sin decodificar nada. false si no quedan lineas
+// en *campos deja los limites: [0] inicio timestamp, [1] inicio key, [2] fin key, [3] fin de linea
+// si [2] == [3] la linea es un tombstone, si no el value empieza en [2] + 1
+// las lineas vacias o sin ';' se saltean
+static inline bool _parser_linea(t_parser* parser, char const* campos[4])
+{
+    while (parser->Pos < parser->Fin)
+    {
+        char const* const linea = parser->Pos;
+
+        char const* fin = memchr(linea, '\n', parser->Fin - linea);
+        if (!fin)
+            fin = parser->Fin;
+
+        parser->Pos = fin + 1;
+        ++parser->Lineas;
+
+        char const* const sepKey = memchr(linea, ';', fin - linea);
+        if (!sepKey)
+            continue;
+
+        char const* const sepValue = memchr(sepKey + 1, ';', fin - (sepKey + 1));
+
+        campos[0] = linea;
+        campos[1] = sepKey + 1;
+        campos[2] = sepValue ? sepValue : fin;
+        campos[3] = fin;
+        return true;
+    }
+
+    return false;
+}
+
+static inline bool _parser_decodificar(char const* campos[4], uint64_t key, t_vista_registro* registro)
+{
+    if (!_parser_uint(campos[0], campos[1] - 1, UINT64_MAX, &registro->Timestamp))
+    {
+        LISSANDRA_LOG_ERROR("Error! timestamp invalido %.*s en archivo!!", (int) (campos[1] - 1 - campos[0]), campos[0]);
+        return false;
+    }
+
+    registro->Key = (uint16_t) key;
+    registro->Tombstone = campos[2] == campos[3];
+    registro->Value = registro->Tombstone ? campos[3] : campos[2] + 1;
+    registro->ValueLen = campos[3] - registro->Value;
+    return true;
+}
+
+// siguiente registro valido del buffer. false si no quedan
+static inline bool parser_next(t_parser* parser, t_vista_registro* registro)
+{
+    char const* campos[4];
+    while (_parser_linea(parser, campos))
+    {
+        uint64_t key;
+        if (!_parser_uint(campos[1], campos[2], UINT16_MAX, &key))
+        {
+            LISSANDRA_LOG_ERROR("Error! clave invalida %.*s en archivo!!", (int) (campos[2] - campos[1]), campos[1]);
+            continue;
+        }
+
+        if (_parser_decodificar(campos, key, registro))
+            return true;
+    }
+
+    return false;
+}
+
+// camino rapido del SELECT: compara la key antes de decodificar timestamp y value
+// avanza hasta el siguiente registro (o tombstone) con esa key. false si no hay mas
+static inline bool parser_next_key(t_parser* parser, uint16_t key, t_vista_registro* registro)
+{
+    char const* campos[4];
+    while (_parser_linea(parser, campos))
+    {
+        uint64_t keyRegistro;
+        if (!_parser_uint(campos[1], campos[2], UINT16_MAX, &keyRegistro) || keyRegistro != key)
+            continue;
+
+        if (_parser_decodificar(campos, keyRegistro, registro))
+            return true;
+    }
+
+    return false;
+}
+
+// copia el value a un buffer de max + 1 bytes, terminandolo en '\0'
+static inline void parser_copiar_value(t_vista_registro const* registro, char* destino, size_t max)
+{
+    size_t const len = registro->ValueLen < max ? registro->ValueLen : max;
+    memcpy(destino, registro->Value, len);
+    destino[len] = '\0';
+}
+
+#endif //LISSANDRA_PARSER_H
@@ -0,0 +1,1324 @@
+
+#include "Snapshot.h"
+#include "Config.h"
+#include "Durabilidad.h"
+#include "Estadisticas.h"
+#include "LissandraLibrary.h"
+#include "TablaFijada.h"
+#include <dirent.h>
+#include <inttypes.h>
+#include <libcommons/config.h>
+#include <libcommons/dictionary.h>
+#include <libcommons/string.h>
+#include <Logger.h>
+#include <Malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct
+{
+    // protege el puntero a la version actual, se toma solo para fijarla o reemplazarla
+    pthread_mutex_t Lock;
+
+    // serializa a quienes publican versiones nuevas (carga, dump, compactacion)
+    pthread_mutex_t Escritura;
+
+    // la tabla mantiene una referencia a su version actual
+    t_snapshot* Actual;
+
+    // la tabla se esta borrando o creando: nadie la carga hasta snapshot_desbloquear
+    // se modifica con tablasLock tomado para escritura
+    bool Bloqueada;
+} t_tabla;
+
+// mapa nombreTabla->t_tabla
+// una tabla no se quita mientras alguien tenga tomado el lock de lectura, asi evito que me la borren en la mano
+static t_dictionary* tablas = NULL;
+static pthread_rwlock_t tablasLock = PTHREAD_RWLOCK_INITIALIZER;
+
+// una entrada por archivo quitado de su tabla cuyos bloques todavia no se liberaron (ver _anotarObsoleto)
+// con lugar para agregarle /<numero de entrada> sin pasarse de PATH_MAX
+static char pathLiberar[PATH_MAX - 21];
+static atomic_uint_fast64_t ultimaEntrada = 0;
+
+static t_tabla* _buscarTabla(char const* nombreTabla);
+static t_tabla* _obtenerTabla(char const* nombreTabla);
+static t_tabla* _nuevaTabla(char const* nombreTabla);
+static bool _asegurarCargada(t_tabla* tabla, char const* nombreTabla);
+static void _recuperarCompactacion(char const* nombreTabla, DIR* dir, uint16_t numParticiones);
+static t_snapshot* _cargarSnapshot(char const* nombreTabla);
+static t_snapshot* _nuevoSnapshot(uint16_t numParticiones, uint32_t ttl);
+static t_tabla_fijada* _leerFijada(char const* nombreTabla, t_snapshot const* snapshot);
+static t_archivo* _nuevoArchivo(char const* nombre, size_t size, size_t const* bloques, size_t numBloques,
+                                uint64_t timestampMax);
+static t_archivo* _escribirBloquesNuevos(char const* nombre, char const* buf, size_t len, uint64_t timestampMax);
+static void _guardarArchivo(char const* path, t_archivo const* archivo);
+static void _publicar(t_tabla* tabla, t_snapshot* nuevo);
+static void _destruirTabla(void* tabla);
+static void _recuperarLiberados(void);
+static void _anotarObsoleto(char const* nombreTabla, t_archivo* archivo);
+static void _borrarEntrada(uint64_t entrada);
+
+static inline t_archivo* _archivoRef(t_archivo* archivo)
+{
+    atomic_fetch_add(&archivo->Refs, 1);
+    return archivo;
+}
+
+static inline void _archivoUnref(t_archivo* archivo)
+{
+    if (atomic_fetch_sub(&archivo->Refs, 1) != 1)
+        return;
+
+    if (atomic_load(&archivo->Obsoleto))
+    {
+        // primero la entrada: un bloque liberado (y quizas ya reasignado) no puede seguir anotado
+        if (archivo->Pendiente)
+            _borrarEntrada(archivo->Pendiente);
+
+        liberarBloquesLFS(archivo->Bloques, archivo->NumBloques);
+    }
+
+    Free(archivo->Bloques);
+    Free(archivo);
+}
+
+static inline bool _pathArchivo(char const* nombreTabla, char const* nombreArchivo, char* buf)
+{
+    if (snprintf(buf, PATH_MAX, "%sTables/%s/%s", confLFS.PUNTO_MONTAJE, nombreTabla, nombreArchivo) < PATH_MAX)
+        return true;
+
+    LISSANDRA_LOG_ERROR("SNAPSHOT: el path de %s en la tabla %s es demasiado largo!", nombreArchivo, nombreTabla);
+    return false;
+}
+
+static inline void _nombreParticionNueva(uint16_t particion, uint16_t numParticiones, char* buf)
+{
+    // oculto y con la cantidad de particiones para la que se escribio, ver _recuperarCompactacion
+    snprintf(buf, NAME_MAX + 1, ".%hu.bin.%hu.nuevo", particion, numParticiones);
+}
+
+void snapshot_init(void)
+{
+    tablas = dictionary_create();
+
+    int const len = snprintf(pathLiberar, sizeof pathLiberar, "%sMetadata/Liberar", confLFS.PUNTO_MONTAJE);
+    if (len >= (int) sizeof pathLiberar)
+    {
+        LISSANDRA_LOG_FATAL("El punto de montaje %s es demasiado largo!", confLFS.PUNTO_MONTAJE);
+        exit(EXIT_FAILURE);
+    }
+
+    mkdir(pathLiberar, 0700);
+    _recuperarLiberados();
+}
+
+t_snapshot* snapshot_pin(char const* nombreTabla)
+{
+    estadisticas_rdlock(&tablasLock);
+
+    t_tabla* const tabla = _obtenerTabla(nombreTabla);
+    if (!tabla)
+    {
+        pthread_rwlock_unlock(&tablasLock);
+        return NULL;
+    }
+
+    estadisticas_mutex_lock(&tabla->Lock);
+    t_snapshot* snapshot = tabla->Actual;
+    if (snapshot)
+        atomic_fetch_add(&snapshot->Refs, 1);
+    pthread_mutex_unlock(&tabla->Lock);
+
+    if (!snapshot)
+    {
+        // primera vez que se accede a la tabla, cargar del directorio
+        estadisticas_mutex_lock(&tabla->Escritura);
+        if (_asegurarCargada(tabla, nombreTabla))
+        {
+            pthread_mutex_lock(&tabla->Lock);
+            snapshot = tabla->Actual;
+            atomic_fetch_add(&snapshot->Refs, 1);
+            pthread_mutex_unlock(&tabla->Lock);
+        }
+        pthread_mutex_unlock(&tabla->Escritura);
+    }
+
+    pthread_rwlock_unlock(&tablasLock);
+    return snapshot;
+}
+
+void snapshot_unpin(t_snapshot* snapshot)
+{
+    if (atomic_fetch_sub(&snapshot->Refs, 1) != 1)
+        return;
+
+    // era la ultima referencia: suelto los archivos, los obsoletos liberan sus bloques
+    for (uint16_t i = 0; i < snapshot->NumParticiones; ++i)
+        _archivoUnref(snapshot->Particiones[i]);
+
+    t_archivo** const temporales = Vector_data(&snapshot->Temporales);
+    for (size_t i = 0; i < Vector_size(&snapshot->Temporales); ++i)
+        _archivoUnref(temporales[i]);
+
+    if (snapshot->Fijada)
+        fijada_unref(snapshot->Fijada);
+
+    Vector_Destruct(&snapshot->Temporales);
+    Free(snapshot->Particiones);
+    Free(snapshot);
+}
+
+char* snapshot_leer_archivo(t_archivo const* archivo)
+{
+    return leerBloquesLFS(archivo->Size, archivo->Bloques, archivo->NumBloques);
+}
+
+bool snapshot_dump(char const* nombreTabla, char const* buf, size_t len, uint64_t timestampMax)
+{
+    estadisticas_rdlock(&tablasLock);
+
+    t_tabla* const tabla = _obtenerTabla(nombreTabla);
+    if (!tabla)
+    {
+        pthread_rwlock_unlock(&tablasLock);
+        return false;
+    }
+
+    estadisticas_mutex_lock(&tabla->Escritura);
+    if (!_asegurarCargada(tabla, nombreTabla))
+    {
+        pthread_mutex_unlock(&tabla->Escritura);
+        pthread_rwlock_unlock(&tablasLock);
+        return false;
+    }
+
+    //Arma el path del archivo temporal. Si ese path (o el mismo en compactacion) ya existe, le busca nombre hasta encontrar uno libre
+    char nombreTemporal[NAME_MAX + 1];
+    char nombreCompactando[NAME_MAX + 1];
+    char pathTemporal[PATH_MAX];
+    char pathCompactando[PATH_MAX];
+    for (size_t j = 0; ; ++j)
+    {
+        snprintf(nombreTemporal, NAME_MAX + 1, "%zu.tmp", j);
+        snprintf(nombreCompactando, NAME_MAX + 1, "%zu.tmpc", j);
+        _pathArchivo(nombreTabla, nombreTemporal, pathTemporal);
+        _pathArchivo(nombreTabla, nombreCompactando, pathCompactando);
+
+        if (!existeArchivo(pathTemporal) && !existeArchivo(pathCompactando))
+            break;
+    }
+
+    t_archivo* const temporal = _escribirBloquesNuevos(nombreTemporal, buf, len, timestampMax);
+    if (!temporal)
+    {
+        pthread_mutex_unlock(&tabla->Escritura);
+        pthread_rwlock_unlock(&tablasLock);
+        return false;
+    }
+
+    // bloques y bitmap en disco antes que la metadata que los referencia
+    durabilidad_barrera();
+    _guardarArchivo(pathTemporal, temporal);
+
+    char pathTabla[PATH_MAX];
+    _pathArchivo(nombreTabla, "", pathTabla);
+    durabilidad_confirmar(pathTabla);
+
+    // nueva version: la actual + el temporal nuevo
+    t_snapshot const* const actual = tabla->Actual;
+    t_snapshot* const nuevo = _nuevoSnapshot(actual->NumParticiones, actual->TTL);
+    for (uint16_t i = 0; i < actual->NumParticiones; ++i)
+        nuevo->Particiones[i] = _archivoRef(actual->Particiones[i]);
+
+    t_archivo** const temporales = Vector_data(&actual->Temporales);
+    for (size_t i = 0; i < Vector_size(&actual->Temporales); ++i)
+    {
+        t_archivo* const t = _archivoRef(temporales[i]);
+        Vector_push_back(&nuevo->Temporales, &t);
+    }
+    Vector_push_back(&nuevo->Temporales, &temporal);
+
+    // las particiones no cambiaron, comparte las decodificadas
+    if (actual->Fijada)
+        nuevo->Fijada = fijada_ref(actual->Fijada);
+
+    _publicar(tabla, nuevo);
+
+    pthread_mutex_unlock(&tabla->Escritura);
+    pthread_rwlock_unlock(&tablasLock);
+    return true;
+}
+
+t_snapshot* snapshot_begin_compaction(char const* nombreTabla, bool forzar)
+{
+    estadisticas_rdlock(&tablasLock);
+
+    t_tabla* const tabla = _obtenerTabla(nombreTabla);
+    if (!tabla)
+    {
+        pthread_rwlock_unlock(&tablasLock);
+        return NULL;
+    }
+
+    t_snapshot* base = NULL;
+
+    estadisticas_mutex_lock(&tabla->Escritura);
+    if (_asegurarCargada(tabla, nombreTabla) && (forzar || !Vector_empty(&tabla->Actual->Temporales)))
+    {
+        base = tabla->Actual;
+
+        // renombro a .tmpc: si se cae el proceso a mitad de compactacion estos archivos se vuelven a compactar
+        t_archivo** const temporales = Vector_data(&base->Temporales);
+        for (size_t i = 0; i < Vector_size(&base->Temporales); ++i)
+        {
+            t_archivo* const temporal = temporales[i];
+            if (!string_ends_with(temporal->Nombre, ".tmp"))
+                continue;
+
+            char pathViejo[PATH_MAX];
+            _pathArchivo(nombreTabla, temporal->Nombre, pathViejo);
+
+            char pathNuevo[PATH_MAX];
+            if (snprintf(pathNuevo, PATH_MAX, "%sc", pathViejo) >= PATH_MAX)
+                LISSANDRA_LOG_ERROR("SNAPSHOT: el path de %sc es demasiado largo!", temporal->Nombre);
+            else if (rename(pathViejo, pathNuevo) < 0)
+                LISSANDRA_LOG_SYSERROR("rename");
+            else
+                strncat(temporal->Nombre, "c", NAME_MAX - strlen(temporal->Nombre));
+        }
+
+        atomic_fetch_add(&base->Refs, 1);
+    }
+    pthread_mutex_unlock(&tabla->Escritura);
+
+    pthread_rwlock_unlock(&tablasLock);
+    return base;
+}
+
+bool snapshot_commit_compaction(char const* nombreTabla, t_snapshot* base, Vector const* particiones,
+                                uint64_t const* timestampsMax, uint16_t numParticiones)
+{
+    // las particiones nuevas van a bloques nuevos: los lectores de versiones anteriores siguen leyendo los viejos
+    t_archivo* nuevas[numParticiones];
+    for (uint16_t i = 0; i < numParticiones; ++i)
+    {
+        char nombreParticion[NAME_MAX + 1];
+        snprintf(nombreParticion, NAME_MAX + 1, "%hu.bin", i);
+
+        nuevas[i] = _escribirBloquesNuevos(nombreParticion, Vector_data(particiones + i), Vector_size(particiones + i),
+                                           timestampsMax[i]);
+        if (!nuevas[i])
+        {
+            // no hay espacio, descarto lo hecho. Los temporales siguen en la version y se vuelven a compactar luego
+            for (uint16_t j = 0; j < i; ++j)
+            {
+                atomic_store(&nuevas[j]->Obsoleto, true);
+                _archivoUnref(nuevas[j]);
+            }
+
+            snapshot_unpin(base);
+            return false;
+        }
+    }
+
+    // una sola barrera para todas las particiones, despues su metadata
+    durabilidad_barrera();
+    for (uint16_t i = 0; i < numParticiones; ++i)
+    {
+        char nombreNuevo[NAME_MAX + 1];
+        _nombreParticionNueva(i, numParticiones, nombreNuevo);
+
+        char pathNuevo[PATH_MAX];
+        _pathArchivo(nombreTabla, nombreNuevo, pathNuevo);
+
+        _guardarArchivo(pathNuevo, nuevas[i]);
+    }
+
+    estadisticas_rdlock(&tablasLock);
+
+    bool res = false;
+    t_tabla* const tabla = _obtenerTabla(nombreTabla);
+    if (tabla)
+        estadisticas_mutex_lock(&tabla->Escritura);
+
+    t_snapshot const* const actual = tabla ? tabla->Actual : NULL;
+
+    // si cambia la cantidad de particiones el punto de no retorno es la nueva metadata
+    // si no se pudo escribir, la compactacion se descarta igual que si la tabla se hubiera borrado
+    bool puedoPublicar = actual != NULL;
+    if (puedoPublicar && numParticiones != actual->NumParticiones)
+    {
+        t_describe metadata;
+        puedoPublicar = get_table_metadata(nombreTabla, &metadata);
+        if (puedoPublicar)
+        {
+            metadata.partitions = numParticiones;
+            puedoPublicar = set_table_metadata(&metadata);
+        }
+
+        if (puedoPublicar)
+            LISSANDRA_LOG_INFO("SNAPSHOT: tabla %s reparticionada de %hu a %hu particiones", nombreTabla,
+                               actual->NumParticiones, numParticiones);
+    }
+
+    if (puedoPublicar)
+    {
+        t_snapshot* const nuevo = _nuevoSnapshot(numParticiones, actual->TTL);
+
+        // los temporales compactados se borran, los que se bajaron mientras compactaba quedan
+        t_archivo** const compactados = Vector_data(&base->Temporales);
+        size_t const numCompactados = Vector_size(&base->Temporales);
+
+        // lo que se quita del directorio queda anotado hasta que se liberen sus bloques
+        for (uint16_t i = 0; i < actual->NumParticiones; ++i)
+            _anotarObsoleto(nombreTabla, actual->Particiones[i]);
+        for (size_t i = 0; i < numCompactados; ++i)
+            _anotarObsoleto(nombreTabla, compactados[i]);
+        durabilidad_confirmar(pathLiberar);
+
+        // reemplazo las particiones. El rename es atomico, un lector del directorio ve el archivo viejo o el nuevo
+        for (uint16_t i = 0; i < numParticiones; ++i)
+        {
+            char nombreNuevo[NAME_MAX + 1];
+            _nombreParticionNueva(i, numParticiones, nombreNuevo);
+
+            char pathNuevo[PATH_MAX];
+            _pathArchivo(nombreTabla, nombreNuevo, pathNuevo);
+
+            char pathParticion[PATH_MAX];
+            _pathArchivo(nombreTabla, nuevas[i]->Nombre, pathParticion);
+
+            if (rename(pathNuevo, pathParticion) < 0)
+                LISSANDRA_LOG_SYSERROR("rename");
+
+            nuevo->Particiones[i] = _archivoRef(nuevas[i]);
+        }
+
+        // las particiones anteriores quedan obsoletas, las que sobran (si se achico la tabla) se borran
+        for (uint16_t i = 0; i < actual->NumParticiones; ++i)
+        {
+            if (i >= numParticiones)
+            {
+                char pathParticion[PATH_MAX];
+                _pathArchivo(nombreTabla, actual->Particiones[i]->Nombre, pathParticion);
+                unlink(pathParticion);
+            }
+
+            atomic_store(&actual->Particiones[i]->Obsoleto, true);
+        }
+
+        t_archivo** const temporales = Vector_data(&actual->Temporales);
+        for (size_t i = 0; i < Vector_size(&actual->Temporales); ++i)
+        {
+            t_archivo* const temporal = temporales[i];
+
+            bool compactado = false;
+            for (size_t j = 0; j < numCompactados && !compactado; ++j)
+                compactado = compactados[j] == temporal;
+
+            if (!compactado)
+            {
+                t_archivo* const t = _archivoRef(temporal);
+                Vector_push_back(&nuevo->Temporales, &t);
+                continue;
+            }
+
+            char pathTemporal[PATH_MAX];
+            _pathArchivo(nombreTabla, temporal->Nombre, pathTemporal);
+            unlink(pathTemporal);
+
+            atomic_store(&temporal->Obsoleto, true);
+        }
+
+        // tabla fijada: decodifico las particiones nuevas ya en memoria, se publican junto con ellas
+        if (actual->Fijada)
+        {
+            nuevo->Fijada = fijada_crear();
+            for (uint16_t i = 0; i < numParticiones; ++i)
+                fijada_agregar(nuevo->Fijada, Vector_data(particiones + i), Vector_size(particiones + i));
+        }
+
+        _publicar(tabla, nuevo);
+        res = true;
+    }
+    else
+    {
+        // la tabla se borro mientras compactaba (o no se pudo actualizar su metadata)
+        for (uint16_t i = 0; i < numParticiones; ++i)
+        {
+            char nombreNuevo[NAME_MAX + 1];
+            _nombreParticionNueva(i, numParticiones, nombreNuevo);
+
+            char pathNuevo[PATH_MAX];
+            _pathArchivo(nombreTabla, nombreNuevo, pathNuevo);
+            unlink(pathNuevo);
+
+            atomic_store(&nuevas[i]->Obsoleto, true);
+        }
+    }
+
+    if (tabla)
+        pthread_mutex_unlock(&tabla->Escritura);
+
+    pthread_rwlock_unlock(&tablasLock);
+
+    // renombres, metadata de la tabla y borrados a disco
+    if (res)
+    {
+        char pathTabla[PATH_MAX];
+        _pathArchivo(nombreTabla, "", pathTabla);
+        durabilidad_confirmar(pathTabla);
+    }
+
+    // la version publicada tiene su propia referencia
+    for (uint16_t i = 0; i < numParticiones; ++i)
+        _archivoUnref(nuevas[i]);
+
+    snapshot_unpin(base);
+    return res;
+}
+
+static size_t _extensiones(t_archivo const* archivo)
+{
+    size_t extensiones = 0;
+    for (size_t i = 0; i < archivo->NumBloques; ++i)
+        if (!i || archivo->Bloques[i] != archivo->Bloques[i - 1] + 1)
+            ++extensiones;
+
+    return extensiones;
+}
+
+static void _sumarFragmentacion(t_fragmentacion* fragmentacion, t_archivo const* archivo)
+{
+    size_t const extensiones = _extensiones(archivo);
+
+    ++fragmentacion->Archivos;
+    fragmentacion->Bloques += archivo->NumBloques;
+    fragmentacion->Extensiones += extensiones;
+    if (extensiones > 1)
+        ++fragmentacion->Fragmentados;
+}
+
+typedef struct
+{
+    // de la version fijada al empezar
+    t_archivo* Archivo;
+
+    // mismo contenido en bloques consecutivos, NULL si no hubo un tramo libre
+    t_archivo* Nuevo;
+
+    // Nuevo reemplazo a Archivo en la version publicada
+    bool Publicado;
+} t_reubicacion;
+
+static t_archivo** _buscarEnVersion(t_snapshot const* snapshot, t_archivo const* archivo)
+{
+    // llamar con tabla->Escritura tomado. NULL si el archivo ya no esta (compactado o tabla borrada)
+    if (!snapshot)
+        return NULL;
+
+    for (uint16_t i = 0; i < snapshot->NumParticiones; ++i)
+        if (snapshot->Particiones[i] == archivo)
+            return snapshot->Particiones + i;
+
+    t_archivo** const temporales = Vector_data(&snapshot->Temporales);
+    for (size_t i = 0; i < Vector_size(&snapshot->Temporales); ++i)
+        if (temporales[i] == archivo)
+            return temporales + i;
+
+    return NULL;
+}
+
+static bool _publicarReubicado(char const* nombreTabla, t_reubicacion* r, t_snapshot* nuevo)
+{
+    // llamar con tabla->Escritura tomado, despues de anotar el archivo viejo y confirmar pathLiberar
+    // la metadata nueva se escribe aparte y se renombra, el archivo apunta a los bloques viejos o a los nuevos
+    char path[PATH_MAX];
+    char nombreNuevo[NAME_MAX + 1];
+    char pathNuevo[PATH_MAX];
+    if (!_pathArchivo(nombreTabla, r->Archivo->Nombre, path))
+        return false;
+
+    if (snprintf(nombreNuevo, sizeof nombreNuevo, ".%s.defrag", r->Archivo->Nombre) >= (int) sizeof nombreNuevo)
+    {
+        LISSANDRA_LOG_ERROR("SNAPSHOT: el nombre .%s.defrag es demasiado largo!", r->Archivo->Nombre);
+        return false;
+    }
+
+    if (!_pathArchivo(nombreTabla, nombreNuevo, pathNuevo))
+        return false;
+
+    _guardarArchivo(pathNuevo, r->Nuevo);
+    if (rename(pathNuevo, path) < 0)
+    {
+        LISSANDRA_LOG_SYSERROR("rename");
+        unlink(pathNuevo);
+        return false;
+    }
+
+    // los bloques viejos se liberan cuando nadie tenga fijada una version que los use
+    atomic_store(&r->Archivo->Obsoleto, true);
+    *_buscarEnVersion(nuevo, r->Archivo) = _archivoRef(r->Nuevo);
+    r->Publicado = true;
+    return true;
+}
+
+void snapshot_defragmentar(char const* nombreTabla, bool cargar, t_fragmentacion* antes, t_fragmentacion* despues)
+{
+    // fijo la version actual y elijo que reubicar. La copia se hace sin locks, el lock de escritura se toma
+    // de nuevo solo para publicar, asi no frena a los dump ni a las compactaciones de la tabla
+    pthread_rwlock_rdlock(&tablasLock);
+
+    t_tabla* tabla = cargar ? _obtenerTabla(nombreTabla) : _buscarTabla(nombreTabla);
+    if (!tabla)
+    {
+        pthread_rwlock_unlock(&tablasLock);
+        return;
+    }
+
+    t_snapshot* base = NULL;
+
+    pthread_mutex_lock(&tabla->Escritura);
+    if (cargar ? _asegurarCargada(tabla, nombreTabla) : tabla->Actual != NULL)
+    {
+        base = tabla->Actual;
+        atomic_fetch_add(&base->Refs, 1);
+    }
+
+    if (!base)
+    {
+        // no se cargo desde que arranco, se desfragmenta cuando alguien la use
+        pthread_mutex_unlock(&tabla->Escritura);
+        pthread_rwlock_unlock(&tablasLock);
+        return;
+    }
+
+    size_t const numArchivos = base->NumParticiones + Vector_size(&base->Temporales);
+    t_reubicacion reubicaciones[numArchivos];
+    size_t numReubicaciones = 0;
+
+    t_archivo** const temporales = Vector_data(&base->Temporales);
+    for (size_t i = 0; i < numArchivos; ++i)
+    {
+        t_archivo* const archivo = i < base->NumParticiones ? base->Particiones[i] : temporales[i - base->NumParticiones];
+        _sumarFragmentacion(antes, archivo);
+
+        // los .tmpc se van a borrar al terminar la compactacion
+        if (_extensiones(archivo) > 1 && !string_ends_with(archivo->Nombre, ".tmpc"))
+            reubicaciones[numReubicaciones++] = (t_reubicacion) { archivo, NULL, false };
+    }
+
+    pthread_mutex_unlock(&tabla->Escritura);
+    pthread_rwlock_unlock(&tablasLock);
+
+    // la version fijada mantiene los bloques viejos, se pueden leer sin locks
+    bool copiado = false;
+    for (size_t i = 0; i < numReubicaciones; ++i)
+    {
+        t_archivo const* const archivo = reubicaciones[i].Archivo;
+
+        size_t bloques[archivo->NumBloques + 1];
+        if (!pedirBloquesContiguosLFS(archivo->NumBloques, bloques))
+            continue;
+
+        char* const contenido = snapshot_leer_archivo(archivo);
+        escribirBloquesLFS(bloques, contenido, archivo->Size);
+        Free(contenido);
+
+        reubicaciones[i].Nuevo = _archivoRef(_nuevoArchivo(archivo->Nombre, archivo->Size, bloques,
+                                                           archivo->NumBloques, archivo->TimestampMax));
+        copiado = true;
+    }
+
+    if (copiado)
+        durabilidad_barrera();
+
+    // mientras copiaba la tabla pudo cambiar: solo se reemplazan los archivos que siguen en la version actual
+    // comparo punteros, la version fijada no deja que se reusen
+    bool reubicado = false;
+    if (copiado)
+    {
+        pthread_rwlock_rdlock(&tablasLock);
+
+        tabla = _buscarTabla(nombreTabla);
+        if (tabla)
+            pthread_mutex_lock(&tabla->Escritura);
+
+        t_snapshot const* const actual = tabla ? tabla->Actual : NULL;
+
+        // nueva version: la actual con los archivos reubicados
+        t_snapshot* nuevo = NULL;
+        if (actual)
+        {
+            nuevo = _nuevoSnapshot(actual->NumParticiones, actual->TTL);
+            for (uint16_t i = 0; i < actual->NumParticiones; ++i)
+                nuevo->Particiones[i] = _archivoRef(actual->Particiones[i]);
+
+            t_archivo** const temporalesActuales = Vector_data(&actual->Temporales);
+            for (size_t i = 0; i < Vector_size(&actual->Temporales); ++i)
+            {
+                t_archivo* const t = _archivoRef(temporalesActuales[i]);
+                Vector_push_back(&nuevo->Temporales, &t);
+            }
+
+            // mismo contenido en otros bloques
+            if (actual->Fijada)
+                nuevo->Fijada = fijada_ref(actual->Fijada);
+        }
+
+        // un archivo que empezo a compactarse mientras copiaba tambien se descarta, la compactacion lo reemplaza
+        bool vigentes[numReubicaciones];
+        bool anotado = false;
+        for (size_t i = 0; i < numReubicaciones; ++i)
+        {
+            t_reubicacion const* const r = reubicaciones + i;
+            vigentes[i] = r->Nuevo && _buscarEnVersion(nuevo, r->Archivo) &&
+                          !string_ends_with(r->Archivo->Nombre, ".tmpc");
+
+            // el renombre quita los bloques viejos del directorio, quedan anotados hasta liberarse
+            if (vigentes[i])
+            {
+                _anotarObsoleto(nombreTabla, r->Archivo);
+                anotado = true;
+            }
+        }
+
+        if (anotado)
+            durabilidad_confirmar(pathLiberar);
+
+        for (size_t i = 0; i < numReubicaciones; ++i)
+        {
+            if (!vigentes[i])
+                continue;
+
+            t_reubicacion* const r = reubicaciones + i;
+            if (_publicarReubicado(nombreTabla, r, nuevo))
+            {
+                // la version nueva tenia una referencia al archivo viejo
+                _archivoUnref(r->Archivo);
+                reubicado = true;
+                continue;
+            }
+
+            // sigue en uso con sus bloques de siempre
+            _borrarEntrada(r->Archivo->Pendiente);
+            r->Archivo->Pendiente = 0;
+        }
+
+        if (reubicado)
+        {
+            char pathTabla[PATH_MAX];
+            _pathArchivo(nombreTabla, "", pathTabla);
+            durabilidad_confirmar(pathTabla);
+
+            _publicar(tabla, nuevo);
+        }
+        else if (nuevo)
+            snapshot_unpin(nuevo);
+
+        if (tabla)
+            pthread_mutex_unlock(&tabla->Escritura);
+
+        pthread_rwlock_unlock(&tablasLock);
+    }
+
+    for (size_t i = 0; i < numReubicaciones; ++i)
+    {
+        t_reubicacion const* const r = reubicaciones + i;
+        if (!r->Nuevo)
+            continue;
+
+        // si no se publico, sus bloques nuevos se liberan con la ultima referencia
+        if (!r->Publicado)
+            atomic_store(&r->Nuevo->Obsoleto, true);
+        _archivoUnref(r->Nuevo);
+    }
+
+    for (size_t i = 0; i < numArchivos; ++i)
+    {
+        t_archivo* const archivo = i < base->NumParticiones ? base->Particiones[i] : temporales[i - base->NumParticiones];
+
+        t_archivo const* reemplazo = archivo;
+        for (size_t j = 0; j < numReubicaciones; ++j)
+            if (reubicaciones[j].Archivo == archivo && reubicaciones[j].Publicado)
+                reemplazo = reubicaciones[j].Nuevo;
+
+        _sumarFragmentacion(despues, reemplazo);
+    }
+
+    snapshot_unpin(base);
+}
+
+bool snapshot_fijar(char const* nombreTabla, bool fijar)
+{
+    estadisticas_rdlock(&tablasLock);
+
+    t_tabla* const tabla = _obtenerTabla(nombreTabla);
+    if (!tabla)
+    {
+        pthread_rwlock_unlock(&tablasLock);
+        return false;
+    }
+
+    bool res = false;
+
+    estadisticas_mutex_lock(&tabla->Escritura);
+    t_describe metadata;
+    if (_asegurarCargada(tabla, nombreTabla) && get_table_metadata(nombreTabla, &metadata))
+    {
+        metadata.pinned = fijar;
+        res = set_table_metadata(&metadata);
+    }
+
+    // nueva version: los mismos archivos, con o sin las particiones decodificadas
+    t_snapshot const* const actual = res ? tabla->Actual : NULL;
+    if (actual && fijar != (actual->Fijada != NULL))
+    {
+        t_snapshot* const nuevo = _nuevoSnapshot(actual->NumParticiones, actual->TTL);
+        for (uint16_t i = 0; i < actual->NumParticiones; ++i)
+            nuevo->Particiones[i] = _archivoRef(actual->Particiones[i]);
+
+        t_archivo** const temporales = Vector_data(&actual->Temporales);
+        for (size_t i = 0; i < Vector_size(&actual->Temporales); ++i)
+        {
+            t_archivo* const t = _archivoRef(temporales[i]);
+            Vector_push_back(&nuevo->Temporales, &t);
+        }
+
+        if (fijar)
+            nuevo->Fijada = _leerFijada(nombreTabla, nuevo);
+
+        _publicar(tabla, nuevo);
+    }
+    pthread_mutex_unlock(&tabla->Escritura);
+
+    pthread_rwlock_unlock(&tablasLock);
+    return res;
+}
+
+void snapshot_create_table(char const* nombreTabla)
+{
+    // lo que haya quedado de una tabla anterior con el mismo nombre no sirve para la nueva
+    pthread_rwlock_wrlock(&tablasLock);
+    dictionary_remove_and_destroy(tablas, nombreTabla, _destruirTabla);
+    _nuevaTabla(nombreTabla)->Bloqueada = true;
+    pthread_rwlock_unlock(&tablasLock);
+}
+
+void snapshot_drop_table(char const* nombreTabla)
+{
+    pthread_rwlock_wrlock(&tablasLock);
+    t_tabla* tabla = dictionary_get(tablas, nombreTabla);
+    if (!tabla)
+        tabla = _nuevaTabla(nombreTabla);
+
+    // hasta que se borre el directorio nadie la puede volver a cargar (un dump recrearia sus archivos)
+    tabla->Bloqueada = true;
+
+    t_snapshot* const actual = tabla->Actual;
+    if (actual)
+    {
+        // el directorio se borra, los bloques que sigan fijados quedan anotados hasta liberarse
+        t_archivo** const temporales = Vector_data(&actual->Temporales);
+        for (uint16_t i = 0; i < actual->NumParticiones; ++i)
+            _anotarObsoleto(nombreTabla, actual->Particiones[i]);
+        for (size_t i = 0; i < Vector_size(&actual->Temporales); ++i)
+            _anotarObsoleto(nombreTabla, temporales[i]);
+        durabilidad_confirmar(pathLiberar);
+
+        for (uint16_t i = 0; i < actual->NumParticiones; ++i)
+        {
+            char path[PATH_MAX];
+            _pathArchivo(nombreTabla, actual->Particiones[i]->Nombre, path);
+            unlink(path);
+
+            atomic_store(&actual->Particiones[i]->Obsoleto, true);
+        }
+
+        for (size_t i = 0; i < Vector_size(&actual->Temporales); ++i)
+        {
+            char path[PATH_MAX];
+            _pathArchivo(nombreTabla, temporales[i]->Nombre, path);
+            unlink(path);
+
+            atomic_store(&temporales[i]->Obsoleto, true);
+        }
+
+        tabla->Actual = NULL;
+        snapshot_unpin(actual);
+    }
+
+    pthread_rwlock_unlock(&tablasLock);
+}
+
+void snapshot_desbloquear(char const* nombreTabla)
+{
+    pthread_rwlock_wrlock(&tablasLock);
+    t_tabla* const tabla = dictionary_get(tablas, nombreTabla);
+    if (tabla && tabla->Bloqueada)
+        dictionary_remove_and_destroy(tablas, nombreTabla, _destruirTabla);
+    pthread_rwlock_unlock(&tablasLock);
+}
+
+void snapshot_destroy(void)
+{
+    dictionary_destroy_and_destroy_elements(tablas, _destruirTabla);
+}
+
+/* PRIVATE */
+static t_tabla* _buscarTabla(char const* nombreTabla)
+{
+    // llamar con tablasLock tomado, una tabla bloqueada es como si no existiera
+    t_tabla* const tabla = dictionary_get(tablas, nombreTabla);
+    return tabla && !tabla->Bloqueada ? tabla : NULL;
+}
+
+static t_tabla* _obtenerTabla(char const* nombreTabla)
+{
+    // llamar con tablasLock tomado para lectura, lo devuelve tomado de la misma forma
+    t_tabla* tabla = dictionary_get(tablas, nombreTabla);
+    if (tabla)
+        return tabla->Bloqueada ? NULL : tabla;
+
+    char pathTabla[PATH_MAX];
+    if (!_pathArchivo(nombreTabla, "", pathTabla) || !existeDir(pathTabla))
+        return NULL;
+
+    pthread_rwlock_unlock(&tablasLock);
+    pthread_rwlock_wrlock(&tablasLock);
+
+    // otro hilo pudo haberla agregado mientras no tenia el lock
+    if (!dictionary_get(tablas, nombreTabla))
+        _nuevaTabla(nombreTabla);
+
+    pthread_rwlock_unlock(&tablasLock);
+    pthread_rwlock_rdlock(&tablasLock);
+
+    // pudo borrarse (o bloquearse) en el medio
+    return _buscarTabla(nombreTabla);
+}
+
+static t_tabla* _nuevaTabla(char const* nombreTabla)
+{
+    // llamar con tablasLock tomado para escritura
+    t_tabla* const tabla = Malloc(sizeof(t_tabla));
+    pthread_mutex_init(&tabla->Lock, NULL);
+    pthread_mutex_init(&tabla->Escritura, NULL);
+    tabla->Actual = NULL;
+    tabla->Bloqueada = false;
+
+    dictionary_put(tablas, nombreTabla, tabla);
+    return tabla;
+}
+
+static bool _asegurarCargada(t_tabla* tabla, char const* nombreTabla)
+{
+    // llamar con tabla->Escritura tomado
+    if (tabla->Actual)
+        return true;
+
+    t_snapshot* const snapshot = _cargarSnapshot(nombreTabla);
+    if (!snapshot)
+        return false;
+
+    _publicar(tabla, snapshot);
+    return true;
+}
+
+static int _compararTemporales(void const* a, void const* b)
+{
+    t_archivo const* const tA = *(t_archivo* const*) a;
+    t_archivo const* const tB = *(t_archivo* const*) b;
+
+    // los .tmpc son anteriores a cualquier .tmp, dentro de cada grupo ordeno por numero
+    bool const compactandoA = string_ends_with(tA->Nombre, ".tmpc");
+    bool const compactandoB = string_ends_with(tB->Nombre, ".tmpc");
+    if (compactandoA != compactandoB)
+        return compactandoA ? -1 : 1;
+
+    unsigned long const numA = strtoul(tA->Nombre, NULL, 10);
+    unsigned long const numB = strtoul(tB->Nombre, NULL, 10);
+    return (numA > numB) - (numA < numB);
+}
+
+static t_archivo* _cargarArchivo(char const* nombreTabla, char const* nombreArchivo)
+{
+    char path[PATH_MAX];
+    _pathArchivo(nombreTabla, nombreArchivo, path);
+
+    size_t size;
+    Vector bloques;
+    uint64_t timestampMax;
+    if (!leerMetadataArchivoLFS(path, &size, &bloques, &timestampMax))
+        return NULL;
+
+    // uno vacio no tiene nada que aportar, aunque no se haya guardado su timestamp (ej: particion recien creada)
+    if (!size)
+        timestampMax = 0;
+
+    t_archivo* const archivo = _nuevoArchivo(nombreArchivo, size, Vector_data(&bloques), Vector_size(&bloques),
+                                             timestampMax);
+    Vector_Destruct(&bloques);
+    return archivo;
+}
+
+static void _recuperarCompactacion(char const* nombreTabla, DIR* dir, uint16_t numParticiones)
+{
+    // una compactacion que no termino deja particiones .N.bin.P.nuevo, todas completas porque se escriben
+    // antes de publicar. Si P coincide con la metadata la compactacion llego al punto de no retorno (o no
+    // reparticionaba): termino de reemplazar. Si no coincide nunca se publico: se descartan
+    // los temporales compactados siguen en .tmpc asi que en ambos casos no se pierde nada
+    struct dirent* entry;
+    while ((entry = readdir(dir)))
+    {
+        if (*entry->d_name != '.')
+        {
+            // particiones que sobraron de una reparticion que achico la tabla
+            if (string_ends_with(entry->d_name, ".bin") && strtoul(entry->d_name, NULL, 10) >= numParticiones)
+            {
+                char path[PATH_MAX];
+                _pathArchivo(nombreTabla, entry->d_name, path);
+                borrarArchivoLFS(path);
+            }
+
+            continue;
+        }
+
+        char path[PATH_MAX];
+        _pathArchivo(nombreTabla, entry->d_name, path);
+
+        // desfragmentacion interrumpida antes de renombrar: el archivo original sigue apuntando a sus bloques
+        if (string_ends_with(entry->d_name, ".defrag"))
+        {
+            borrarArchivoLFS(path);
+            continue;
+        }
+
+        if (!string_ends_with(entry->d_name, ".nuevo"))
+            continue;
+
+        uint16_t particion, particiones;
+        if (sscanf(entry->d_name, ".%hu.bin.%hu.nuevo", &particion, &particiones) != 2)
+        {
+            // .Metadata.nuevo u otro resto sin bloques
+            unlink(path);
+            continue;
+        }
+
+        if (particiones != numParticiones)
+        {
+            borrarArchivoLFS(path);
+            continue;
+        }
+
+        char nombreParticion[NAME_MAX + 1];
+        snprintf(nombreParticion, NAME_MAX + 1, "%hu.bin", particion);
+
+        char pathParticion[PATH_MAX];
+        _pathArchivo(nombreTabla, nombreParticion, pathParticion);
+
+        // la particion vieja se reemplaza, sus bloques se liberan
+        borrarArchivoLFS(pathParticion);
+        if (rename(path, pathParticion) < 0)
+            LISSANDRA_LOG_SYSERROR("rename");
+
+        LISSANDRA_LOG_INFO("SNAPSHOT: tabla %s: recuperada particion %s de una compactacion interrumpida", nombreTabla,
+                           nombreParticion);
+    }
+}
+
+static t_snapshot* _cargarSnapshot(char const* nombreTabla)
+{
+    t_describe infoTabla;
+    if (!get_table_metadata(nombreTabla, &infoTabla))
+        return NULL;
+
+    char pathTabla[PATH_MAX];
+    _pathArchivo(nombreTabla, "", pathTabla);
+
+    DIR* dir = opendir(pathTabla);
+    if (!dir)
+        return NULL;
+
+    _recuperarCompactacion(nombreTabla, dir, infoTabla.partitions);
+    rewinddir(dir);
+
+    t_snapshot* const snapshot = _nuevoSnapshot(infoTabla.partitions, infoTabla.ttl);
+    for (uint16_t i = 0; i < infoTabla.partitions; ++i)
+    {
+        char nombreParticion[NAME_MAX + 1];
+        snprintf(nombreParticion, NAME_MAX + 1, "%hu.bin", i);
+
+        snapshot->Particiones[i] = _cargarArchivo(nombreTabla, nombreParticion);
+        if (!snapshot->Particiones[i])
+        {
+            LISSANDRA_LOG_ERROR("SNAPSHOT: falta la particion %s de la tabla %s!", nombreParticion, nombreTabla);
+            snapshot->Particiones[i] = _nuevoArchivo(nombreParticion, 0, NULL, 0, 0);
+        }
+
+        _archivoRef(snapshot->Particiones[i]);
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)))
+    {
+        if (*entry->d_name == '.')
+            continue;
+
+        if (!string_ends_with(entry->d_name, ".tmp") && !string_ends_with(entry->d_name, ".tmpc"))
+            continue;
+
+        t_archivo* const temporal = _cargarArchivo(nombreTabla, entry->d_name);
+        if (!temporal)
+            continue;
+
+        _archivoRef(temporal);
+        Vector_push_back(&snapshot->Temporales, &temporal);
+    }
+
+    closedir(dir);
+
+    qsort(Vector_data(&snapshot->Temporales), Vector_size(&snapshot->Temporales), sizeof(t_archivo*), _compararTemporales);
+
+    if (infoTabla.pinned)
+        snapshot->Fijada = _leerFijada(nombreTabla, snapshot);
+
+    LISSANDRA_LOG_TRACE("SNAPSHOT: cargada tabla %s (%hu particiones, %zu temporales)", nombreTabla,
+                        snapshot->NumParticiones, Vector_size(&snapshot->Temporales));
+    return snapshot;
+}
+
+static t_snapshot* _nuevoSnapshot(uint16_t numParticiones, uint32_t ttl)
+{
+    t_snapshot* const snapshot = Malloc(sizeof(t_snapshot));
+    atomic_init(&snapshot->Refs, 1);
+    snapshot->Version = 0;
+    snapshot->NumParticiones = numParticiones;
+    snapshot->TTL = ttl;
+    snapshot->Particiones = Calloc(numParticiones, sizeof(t_archivo*));
+    Vector_Construct(&snapshot->Temporales, sizeof(t_archivo*), NULL, 0);
+    snapshot->Fijada = NULL;
+    return snapshot;
+}
+
+static t_tabla_fijada* _leerFijada(char const* nombreTabla, t_snapshot const* snapshot)
+{
+    t_tabla_fijada* const fijada = fijada_crear();
+    for (uint16_t i = 0; i < snapshot->NumParticiones; ++i)
+    {
+        t_archivo const* const particion = snapshot->Particiones[i];
+        if (!particion->Size)
+            continue;
+
+        char* const contenido = snapshot_leer_archivo(particion);
+        fijada_agregar(fijada, contenido, particion->Size);
+        Free(contenido);
+    }
+
+    LISSANDRA_LOG_INFO("SNAPSHOT: tabla %s fijada en memoria: %zu claves (%zu KB)", nombreTabla, fijada_claves(fijada),
+                       fijada_memoria(fijada) / 1024);
+    return fijada;
+}
+
+static t_archivo* _nuevoArchivo(char const* nombre, size_t size, size_t const* bloques, size_t numBloques,
+                                uint64_t timestampMax)
+{
+    t_archivo* const archivo = Malloc(sizeof(t_archivo));
+    atomic_init(&archivo->Refs, 0);
+    atomic_init(&archivo->Obsoleto, false);
+    archivo->Pendiente = 0;
+    snprintf(archivo->Nombre, NAME_MAX + 1, "%s", nombre);
+    archivo->Size = size;
+    archivo->TimestampMax = timestampMax;
+    archivo->NumBloques = numBloques;
+    archivo->Bloques = NULL;
+    if (numBloques)
+    {
+        archivo->Bloques = Malloc(numBloques * sizeof(size_t));
+        memcpy(archivo->Bloques, bloques, numBloques * sizeof(size_t));
+    }
+
+    return archivo;
+}
+
+static t_archivo* _escribirBloquesNuevos(char const* nombre, char const* buf, size_t len, uint64_t timestampMax)
+{
+    // todo archivo tiene al menos un bloque asignado, aunque este vacio
+    size_t numBloques = len / confLFS.TAMANIO_BLOQUES;
+    if (len % confLFS.TAMANIO_BLOQUES || !numBloques)
+        ++numBloques;
+
+    size_t bloques[numBloques];
+    if (!pedirBloquesLFS(numBloques, bloques))
+    {
+        LISSANDRA_LOG_ERROR("No hay más bloques disponibles para guardar el archivo %s! Se perderán datos", nombre);
+        return NULL;
+    }
+
+    escribirBloquesLFS(bloques, buf, len);
+
+    // la metadata se guarda aparte, despues de la barrera de durabilidad
+    return _archivoRef(_nuevoArchivo(nombre, len, bloques, numBloques, timestampMax));
+}
+
+static void _guardarArchivo(char const* path, t_archivo const* archivo)
+{
+    guardarArchivoLFS(path, archivo->Size, archivo->Bloques, archivo->NumBloques, archivo->TimestampMax);
+}
+
+static void _publicar(t_tabla* tabla, t_snapshot* nuevo)
+{
+    pthread_mutex_lock(&tabla->Lock);
+
+    t_snapshot* const anterior = tabla->Actual;
+    nuevo->Version = anterior ? anterior->Version + 1 : 1;
+    tabla->Actual = nuevo;
+
+    pthread_mutex_unlock(&tabla->Lock);
+
+    // suelto la referencia de la tabla, si nadie la tiene fijada se libera ahora
+    if (anterior)
+        snapshot_unpin(anterior);
+}
+
+static void _destruirTabla(void* tabla)
+{
+    t_tabla* const t = tabla;
+    if (t->Actual)
+        snapshot_unpin(t->Actual);
+
+    pthread_mutex_destroy(&t->Escritura);
+    pthread_mutex_destroy(&t->Lock);
+    Free(t);
+}
+
+static inline void _pathEntrada(uint64_t entrada, char* buf)
+{
+    snprintf(buf, PATH_MAX, "%s/%" PRIu64, pathLiberar, entrada);
+}
+
+static bool _sigueEnTabla(char const* nombreTabla, char const* nombreArchivo, size_t bloque)
+{
+    // los bloques no se comparten entre archivos: si el archivo de la tabla tiene alguno es el mismo
+    char path[PATH_MAX];
+    _pathArchivo(nombreTabla, nombreArchivo, path);
+
+    size_t size;
+    Vector bloques;
+    if (!leerMetadataArchivoLFS(path, &size, &bloques, NULL))
+        return false;
+
+    bool sigue = false;
+    size_t const* const actuales = Vector_data(&bloques);
+    for (size_t i = 0; i < Vector_size(&bloques) && !sigue; ++i)
+        sigue = actuales[i] == bloque;
+
+    Vector_Destruct(&bloques);
+    return sigue;
+}
+
+static void _recuperarLiberados(void)
+{
+    // ninguna version esta fijada: lo anotado se libera, salvo que la caida haya sido antes de quitar el archivo
+    DIR* dir = opendir(pathLiberar);
+    if (!dir)
+    {
+        LISSANDRA_LOG_SYSERROR("opendir");
+        return;
+    }
+
+    Vector liberar;
+    Vector_Construct(&liberar, sizeof(size_t), NULL, 0);
+    size_t archivos = 0;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)))
+    {
+        if (*entry->d_name == '.')
+            continue;
+
+        char path[PATH_MAX];
+        _pathEntrada(strtoull(entry->d_name, NULL, 10), path);
+
+        t_config* const config = config_create(path);
+        if (config && config_has_property(config, "TABLA") && config_has_property(config, "ARCHIVO"))
+        {
+            Vector bloques = config_get_array_value(config, "BLOCKS");
+            char** const numeros = Vector_data(&bloques);
+            if (!Vector_empty(&bloques) &&
+                !_sigueEnTabla(config_get_string_value(config, "TABLA"), config_get_string_value(config, "ARCHIVO"),
+                               strtoul(numeros[0], NULL, 10)))
+            {
+                for (size_t i = 0; i < Vector_size(&bloques); ++i)
+                {
+                    size_t const numBloque = strtoul(numeros[i], NULL, 10);
+                    Vector_push_back(&liberar, &numBloque);
+                }
+
+                ++archivos;
+            }
+
+            Vector_Destruct(&bloques);
+        }
+
+        if (config)
+            config_destroy(config);
+        unlink(path);
+    }
+
+    closedir(dir);
+
+    // igual que al soltar un archivo, las entradas se borran antes de liberar los bloques
+    durabilidad_confirmar(pathLiberar);
+    liberarBloquesLFS(Vector_data(&liberar), Vector_size(&liberar));
+
+    if (archivos)
+        LISSANDRA_LOG_INFO("SNAPSHOT: liberados %zu bloques de %zu archivos quitados antes de una caida",
+                           Vector_size(&liberar), archivos);
+
+    Vector_Destruct(&liberar);
+}
+
+static void _anotarObsoleto(char const* nombreTabla, t_archivo* archivo)
+{
+    // llamar antes de quitar el archivo del directorio de la tabla, y despues durabilidad_confirmar(pathLiberar)
+    // si el proceso se cae mientras el archivo sigue fijado, sus bloques se liberan al arrancar
+    uint64_t const entrada = atomic_fetch_add(&ultimaEntrada, 1) + 1;
+
+    char path[PATH_MAX];
+    _pathEntrada(entrada, path);
+
+    FILE* archivoEntrada = fopen(path, "w");
+    if (!archivoEntrada)
+    {
+        LISSANDRA_LOG_SYSERROR("fopen");
+        return;
+    }
+
+    fprintf(archivoEntrada, "TABLA=%s\n", nombreTabla);
+    fprintf(archivoEntrada, "ARCHIVO=%s\n", archivo->Nombre);
+    fprintf(archivoEntrada, "BLOCKS=[");
+    for (size_t i = 0; i < archivo->NumBloques; ++i)
+        fprintf(archivoEntrada, i ? ",%zu" : "%zu", archivo->Bloques[i]);
+    fprintf(archivoEntrada, "]\n");
+    fflush(archivoEntrada);
+    durabilidad_metadata_escrita(fileno(archivoEntrada));
+    fclose(archivoEntrada);
+
+    // se publica junto con Obsoleto
+    archivo->Pendiente = entrada;
+}
+
+static void _borrarEntrada(uint64_t entrada)
+{
+    char path[PATH_MAX];
+    _pathEntrada(entrada, path);
+    unlink(path);
+
+    durabilidad_confirmar(pathLiberar);
+}
@@ -0,0 +1,127 @@
+
+#ifndef LISSANDRA_SNAPSHOT_H
+#define LISSANDRA_SNAPSHOT_H
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <vector.h>
+
+typedef struct t_tabla_fijada t_tabla_fijada;
+
+/*
+ * Versiones inmutables del conjunto de archivos de cada tabla.
+ *
+ * Cada dump y cada compactacion publican una version nueva de la tabla (particiones + temporales).
+ * Los lectores (SELECT) fijan la version actual con un contador de referencias y la sueltan al terminar,
+ * de esta forma nunca esperan a un dump ni a una compactacion y no hace falta el flock en el directorio.
+ * Un archivo que deja de pertenecer a la version actual se borra del directorio al publicar, pero sus bloques
+ * se liberan recien cuando ninguna version que lo contenga siga fijada. Mientras tanto quedan anotados en
+ * Metadata/Liberar, si el proceso se cae antes de liberarlos se liberan al arrancar.
+ */
+
+// archivos guardados antes de registrar su mayor timestamp, siempre hay que leerlos
+#define TIMESTAMP_DESCONOCIDO UINT64_MAX
+
+typedef struct
+{
+    atomic_uint Refs;
+
+    // si al soltar la ultima referencia hay que liberar los bloques
+    atomic_bool Obsoleto;
+
+    // entrada de Metadata/Liberar que anota sus bloques hasta liberarlos, 0 si no tiene
+    uint64_t Pendiente;
+
+    // nombre en el directorio de la tabla (ej: 0.bin, 3.tmp)
+    char Nombre[NAME_MAX + 1];
+
+    size_t Size;
+    size_t NumBloques;
+    size_t* Bloques;
+
+    // mayor timestamp entre sus registros (TIMESTAMP_MAX en la metadata), un SELECT que ya encontro algo
+    // mas nuevo no necesita leerlo
+    uint64_t TimestampMax;
+} t_archivo;
+
+typedef struct
+{
+    atomic_uint Refs;
+
+    // numero de secuencia, crece con cada publicacion
+    uint64_t Version;
+
+    uint16_t NumParticiones;
+    t_archivo** Particiones;
+
+    // TTL de la tabla en milisegundos, 0 si los registros no expiran
+    uint32_t TTL;
+
+    // t_archivo*, del mas viejo al mas nuevo
+    Vector Temporales;
+
+    // particiones decodificadas en memoria si la tabla esta fijada, NULL si no (ver TablaFijada.h)
+    t_tabla_fijada* Fijada;
+} t_snapshot;
+
+// libera los bloques que quedaron anotados en Metadata/Liberar de una caida, llamar antes de pedir bloques
+void snapshot_init(void);
+
+// fija la version actual de la tabla. NULL si la tabla no existe
+// la primera vez carga la version desde el directorio de la tabla
+t_snapshot* snapshot_pin(char const* nombreTabla);
+
+void snapshot_unpin(t_snapshot* snapshot);
+
+// lee el contenido completo de un archivo de una version fijada
+char* snapshot_leer_archivo(t_archivo const* archivo);
+
+// baja un nuevo temporal con el contenido dado y publica una version que lo incluye
+bool snapshot_dump(char const* nombreTabla, char const* buf, size_t len, uint64_t timestampMax);
+
+// fija la version a compactar y renombra sus temporales a .tmpc
+// NULL si la tabla no existe o si no tiene temporales y no se pide forzar (ej: para reparticionar)
+t_snapshot* snapshot_begin_compaction(char const* nombreTabla, bool forzar);
+
+// publica las nuevas particiones (un Vector de char por particion, con su mayor timestamp) reemplazando las de
+// base y sus temporales, los temporales bajados durante la compactacion se conservan. Suelta la referencia a base
+// si numParticiones difiere de la de base actualiza la metadata de la tabla
+bool snapshot_commit_compaction(char const* nombreTabla, t_snapshot* base, Vector const* particiones,
+                                uint64_t const* timestampsMax, uint16_t numParticiones);
+
+typedef struct
+{
+    size_t Archivos;
+    size_t Bloques;
+
+    // tramos de bloques consecutivos, un archivo contiguo tiene uno solo
+    size_t Extensiones;
+
+    // archivos con mas de una extension
+    size_t Fragmentados;
+} t_fragmentacion;
+
+// reubica cada archivo fragmentado de la version actual en bloques consecutivos y publica una version nueva
+// acumula en antes/despues la fragmentacion de la tabla. Los .tmpc (en compactacion) no se tocan
+// sin cargar, una tabla que todavia no se leyo desde el arranque se saltea
+void snapshot_defragmentar(char const* nombreTabla, bool cargar, t_fragmentacion* antes, t_fragmentacion* despues);
+
+// fija (o suelta) las particiones de la tabla en memoria, guardandolo en su metadata, y publica una version con ellas
+bool snapshot_fijar(char const* nombreTabla, bool fijar);
+
+// antes de crear el directorio: descarta lo que quede de una tabla anterior con el mismo nombre
+// y la bloquea hasta snapshot_desbloquear
+void snapshot_create_table(char const* nombreTabla);
+
+// quita la tabla: sus archivos se borran y sus bloques se liberan al soltarse la ultima version
+// queda bloqueada (nadie la vuelve a cargar) hasta snapshot_desbloquear, despues de borrar el directorio
+void snapshot_drop_table(char const* nombreTabla);
+
+// termina el CREATE o DROP, la tabla se vuelve a cargar desde su directorio en el proximo acceso
+void snapshot_desbloquear(char const* nombreTabla);
+
+void snapshot_destroy(void);
+
+#endif //LISSANDRA_SNAPSHOT_H
@@ -0,0 +1,114 @@
+
+#include "TablaFijada.h"
+#include "Config.h"
+#include "Parser.h"
+#include <Malloc.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <vector.h>
+
+typedef enum
+{
+    ENTRADA_VACIA,
+    ENTRADA_VALOR,
+    ENTRADA_TOMBSTONE
+} EstadoEntrada;
+
+typedef struct
+{
+    uint64_t Timestamp;
+
+    // value dentro de Valores
+    uint32_t Offset;
+    uint32_t Len;
+
+    uint8_t Estado;
+} t_entrada_fijada;
+
+struct t_tabla_fijada
+{
+    atomic_uint Refs;
+    size_t Claves;
+
+    // char, los values uno detras de otro sin '\0'
+    Vector Valores;
+
+    t_entrada_fijada Entradas[UINT16_MAX + 1];
+};
+
+t_tabla_fijada* fijada_crear(void)
+{
+    // Calloc: todas las entradas arrancan vacias
+    t_tabla_fijada* const fijada = Calloc(1, sizeof(t_tabla_fijada));
+    atomic_init(&fijada->Refs, 1);
+    Vector_Construct(&fijada->Valores, sizeof(char), NULL, 0);
+    return fijada;
+}
+
+void fijada_agregar(t_tabla_fijada* fijada, char const* buf, size_t len)
+{
+    t_parser parser;
+    parser_init(&parser, buf, len);
+
+    t_vista_registro registro;
+    while (parser_next(&parser, &registro))
+    {
+        t_entrada_fijada* const entrada = &fijada->Entradas[registro.Key];
+
+        // ante un empate queda el primero, igual que al escanear el archivo
+        if (entrada->Estado != ENTRADA_VACIA && entrada->Timestamp >= registro.Timestamp)
+            continue;
+
+        if (entrada->Estado == ENTRADA_VACIA)
+            ++fijada->Claves;
+
+        size_t const valueLen = registro.ValueLen < confLFS.TAMANIO_VALUE ? registro.ValueLen : confLFS.TAMANIO_VALUE;
+
+        entrada->Timestamp = registro.Timestamp;
+        entrada->Estado = registro.Tombstone ? ENTRADA_TOMBSTONE : ENTRADA_VALOR;
+        entrada->Offset = (uint32_t) Vector_size(&fijada->Valores);
+        entrada->Len = (uint32_t) valueLen;
+        Vector_insert_range(&fijada->Valores, Vector_size(&fijada->Valores), (void*) registro.Value, (void*) (registro.Value + valueLen));
+    }
+}
+
+t_tabla_fijada* fijada_ref(t_tabla_fijada* fijada)
+{
+    atomic_fetch_add(&fijada->Refs, 1);
+    return fijada;
+}
+
+void fijada_unref(t_tabla_fijada* fijada)
+{
+    if (atomic_fetch_sub(&fijada->Refs, 1) != 1)
+        return;
+
+    Vector_Destruct(&fijada->Valores);
+    Free(fijada);
+}
+
+bool fijada_buscar(t_tabla_fijada const* fijada, uint16_t key, t_registro* resultado)
+{
+    t_entrada_fijada const* const entrada = &fijada->Entradas[key];
+    if (entrada->Estado == ENTRADA_VACIA)
+        return false;
+
+    resultado->key = key;
+    resultado->timestamp = entrada->Timestamp;
+    resultado->tombstone = entrada->Estado == ENTRADA_TOMBSTONE;
+
+    char const* const valores = Vector_data(&fijada->Valores);
+    memcpy(resultado->value, valores + entrada->Offset, entrada->Len);
+    resultado->value[entrada->Len] = '\0';
+    return true;
+}
+
+size_t fijada_claves(t_tabla_fijada const* fijada)
+{
+    return fijada->Claves;
+}
+
+size_t fijada_memoria(t_tabla_fijada const* fijada)
+{
+    return sizeof(t_tabla_fijada) + Vector_capacity(&fijada->Valores);
+}
@@ -0,0 +1,36 @@
+
+#ifndef LISSANDRA_TABLAFIJADA_H
+#define LISSANDRA_TABLAFIJADA_H
+
+#include "Memtable.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Particiones de una tabla fijada (PIN, o PINNED=1 en su metadata) decodificadas en memoria.
+ *
+ * Como las claves son uint16_t se indexan directo en un arreglo de 65536 entradas (1.5MB por tabla, sin
+ * importar cuantos registros tenga) y los values van todos seguidos en un solo buffer. Es inmutable: cada
+ * compactacion arma una nueva y la publica con la version de la tabla, los SELECT en curso siguen con la suya.
+ */
+
+typedef struct t_tabla_fijada t_tabla_fijada;
+
+t_tabla_fijada* fijada_crear(void);
+
+// decodifica el contenido de una particion. Solo mientras se arma, antes de publicarla
+void fijada_agregar(t_tabla_fijada* fijada, char const* buf, size_t len);
+
+t_tabla_fijada* fijada_ref(t_tabla_fijada* fijada);
+void fijada_unref(t_tabla_fijada* fijada);
+
+// el registro mas nuevo de la key en las particiones (puede ser un tombstone). false si no esta
+bool fijada_buscar(t_tabla_fijada const* fijada, uint16_t key, t_registro* resultado);
+
+size_t fijada_claves(t_tabla_fijada const* fijada);
+
+// bytes ocupados, arreglo + values
+size_t fijada_memoria(t_tabla_fijada const* fijada);
+
+#endif //LISSANDRA_TABLAFIJADA_H
@@ -0,0 +1,372 @@
+
+#include "WAL.h"
+#include "Config.h"
+#include "Estadisticas.h"
+#include "LissandraLibrary.h"
+#include <ConsoleInput.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <libcommons/string.h>
+#include <Logger.h>
+#include <Malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static pthread_mutex_t walMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t walCond = PTHREAD_COND_INITIALIZER;
+
+static int walFd = -1;
+static uint32_t segmentoActual = 0;
+
+// numero de secuencia del ultimo registro escrito y del ultimo que se sabe en disco
+static uint64_t lsnEscrito = 0;
+static uint64_t lsnSincronizado = 0;
+
+// hay un hilo (lider) haciendo fdatasync fuera del lock, los demas esperan su resultado
+static bool sincronizando = false;
+
+// con lugar para agregarle /<nombre de segmento> sin pasarse de PATH_MAX
+static char pathWAL[PATH_MAX - NAME_MAX - 1];
+
+// tabla;DROP, no se confunde con un registro porque el timestamp es numerico
+static char const MarcaDrop[] = "DROP";
+
+static void _abrirSegmento(uint32_t segmento);
+static void _sincronizarDirectorio(void);
+static uint64_t _escribir(char const* linea, size_t len);
+static size_t _reaplicarSegmento(char const* path, WALReplayFn* fn, WALDropFn* drop);
+
+static inline void _pathSegmento(uint32_t segmento, char* buf)
+{
+    snprintf(buf, PATH_MAX, "%s/%u.log", pathWAL, segmento);
+}
+
+bool wal_modo_desde_string(char const* modo, uint8_t* resultado)
+{
+    static char const* const modos[] = { "NONE", "GROUP", "ALWAYS" };
+    for (uint8_t i = 0; i < sizeof modos / sizeof *modos; ++i)
+    {
+        if (!strcmp(modo, modos[i]))
+        {
+            *resultado = i;
+            return true;
+        }
+    }
+
+    LISSANDRA_LOG_ERROR("Modo de WAL invalido: %s (NONE, GROUP o ALWAYS)", modo);
+    return false;
+}
+
+static int _compararSegmentos(void const* a, void const* b)
+{
+    uint32_t const sA = *(uint32_t const*) a;
+    uint32_t const sB = *(uint32_t const*) b;
+    return (sA > sB) - (sA < sB);
+}
+
+void wal_init(WALReplayFn* fn, WALDropFn* drop)
+{
+    if (snprintf(pathWAL, sizeof pathWAL, "%sWAL", confLFS.PUNTO_MONTAJE) >= (int) sizeof pathWAL)
+    {
+        LISSANDRA_LOG_FATAL("El punto de montaje %s es demasiado largo!", confLFS.PUNTO_MONTAJE);
+        exit(EXIT_FAILURE);
+    }
+
+    mkdir(pathWAL, 0700);
+
+    DIR* dir = opendir(pathWAL);
+    if (!dir)
+    {
+        LISSANDRA_LOG_FATAL("No pude abrir el directorio del WAL %s!", pathWAL);
+        exit(EXIT_FAILURE);
+    }
+
+    Vector segmentos;
+    Vector_Construct(&segmentos, sizeof(uint32_t), NULL, 0);
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)))
+    {
+        if (*entry->d_name == '.' || !string_ends_with(entry->d_name, ".log"))
+            continue;
+
+        uint32_t const segmento = strtoul(entry->d_name, NULL, 10);
+        Vector_push_back(&segmentos, &segmento);
+    }
+    closedir(dir);
+
+    // del mas viejo al mas nuevo, si una key se inserto dos veces gana el timestamp mayor igual
+    qsort(Vector_data(&segmentos), Vector_size(&segmentos), sizeof(uint32_t), _compararSegmentos);
+
+    size_t registros = 0;
+    for (size_t i = 0; i < Vector_size(&segmentos); ++i)
+    {
+        uint32_t const segmento = *(uint32_t*) Vector_at(&segmentos, i);
+
+        char path[PATH_MAX];
+        _pathSegmento(segmento, path);
+        registros += _reaplicarSegmento(path, fn, drop);
+
+        // los segmentos recuperados se borran con el primer dump que termine bien
+        segmentoActual = segmento + 1;
+    }
+
+    if (!Vector_empty(&segmentos))
+        LISSANDRA_LOG_INFO("WAL: recuperados %zu registros de %zu segmentos", registros, Vector_size(&segmentos));
+
+    Vector_Destruct(&segmentos);
+
+    _abrirSegmento(segmentoActual);
+}
+
+uint64_t wal_append(char const* nombreTabla, uint16_t key, char const* value, uint64_t timestamp)
+{
+    // tabla;timestamp;key;value, un tombstone va sin value
+    char const* const formato = value ? "%s;%llu;%hu;%s\n" : "%s;%llu;%hu\n";
+    size_t const len = snprintf(NULL, 0, formato, nombreTabla, (unsigned long long) timestamp, key, value);
+    char linea[len + 1];
+    snprintf(linea, len + 1, formato, nombreTabla, (unsigned long long) timestamp, key, value);
+
+    return _escribir(linea, len);
+}
+
+uint64_t wal_append_drop(char const* nombreTabla)
+{
+    size_t const len = snprintf(NULL, 0, "%s;%s\n", nombreTabla, MarcaDrop);
+    char linea[len + 1];
+    snprintf(linea, len + 1, "%s;%s\n", nombreTabla, MarcaDrop);
+
+    return _escribir(linea, len);
+}
+
+void wal_sync(uint64_t lsn)
+{
+    switch (confLFS.MODO_WAL)
+    {
+        case WAL_NONE:
+            return;
+        case WAL_ALWAYS:
+            pthread_mutex_lock(&walMutex);
+            if (lsnSincronizado < lsn)
+            {
+                if (fdatasync(walFd) < 0)
+                    LISSANDRA_LOG_SYSERROR("fdatasync");
+                lsnSincronizado = lsnEscrito;
+            }
+            pthread_mutex_unlock(&walMutex);
+            return;
+        default:
+            break;
+    }
+
+    pthread_mutex_lock(&walMutex);
+    while (lsnSincronizado < lsn)
+    {
+        if (sincronizando)
+        {
+            // ya hay un lider, su fdatasync (o el siguiente) me cubre
+            pthread_cond_wait(&walCond, &walMutex);
+            continue;
+        }
+
+        sincronizando = true;
+
+        // espero a que se sumen otros INSERT para que compartan el fdatasync
+        if (confLFS.VENTANA_WAL_US)
+        {
+            pthread_mutex_unlock(&walMutex);
+            usleep(confLFS.VENTANA_WAL_US);
+            pthread_mutex_lock(&walMutex);
+        }
+
+        uint64_t const objetivo = lsnEscrito;
+        int const fd = walFd;
+        pthread_mutex_unlock(&walMutex);
+
+        if (fdatasync(fd) < 0)
+            LISSANDRA_LOG_SYSERROR("fdatasync");
+
+        pthread_mutex_lock(&walMutex);
+        if (objetivo > lsnSincronizado)
+            lsnSincronizado = objetivo;
+
+        sincronizando = false;
+        pthread_cond_broadcast(&walCond);
+    }
+    pthread_mutex_unlock(&walMutex);
+}
+
+uint32_t wal_rotate(void)
+{
+    pthread_mutex_lock(&walMutex);
+
+    // el lider usa el fd sin el lock, no lo puedo cerrar hasta que termine
+    while (sincronizando)
+        pthread_cond_wait(&walCond, &walMutex);
+
+    // quienes esperan registros de este segmento no van a ser cubiertos por un fdatasync del siguiente
+    if (confLFS.MODO_WAL != WAL_NONE && lsnSincronizado < lsnEscrito)
+    {
+        if (fdatasync(walFd) < 0)
+            LISSANDRA_LOG_SYSERROR("fdatasync");
+    }
+
+    lsnSincronizado = lsnEscrito;
+    pthread_cond_broadcast(&walCond);
+
+    uint32_t const cerrado = segmentoActual;
+    close(walFd);
+    _abrirSegmento(++segmentoActual);
+
+    pthread_mutex_unlock(&walMutex);
+    return cerrado;
+}
+
+void wal_truncate(uint32_t segmento)
+{
+    DIR* dir = opendir(pathWAL);
+    if (!dir)
+        return;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)))
+    {
+        if (*entry->d_name == '.' || !string_ends_with(entry->d_name, ".log"))
+            continue;
+
+        if (strtoul(entry->d_name, NULL, 10) > segmento)
+            continue;
+
+        char path[PATH_MAX];
+        snprintf(path, PATH_MAX, "%s/%s", pathWAL, entry->d_name);
+        unlink(path);
+    }
+
+    closedir(dir);
+
+    LISSANDRA_LOG_TRACE("WAL: borrados segmentos hasta %u", segmento);
+}
+
+void wal_destroy(void)
+{
+    pthread_mutex_lock(&walMutex);
+    while (sincronizando)
+        pthread_cond_wait(&walCond, &walMutex);
+
+    if (fdatasync(walFd) < 0)
+        LISSANDRA_LOG_SYSERROR("fdatasync");
+
+    close(walFd);
+    walFd = -1;
+    pthread_mutex_unlock(&walMutex);
+}
+
+/* PRIVATE */
+static uint64_t _escribir(char const* linea, size_t len)
+{
+    estadisticas_mutex_lock(&walMutex);
+
+    // O_APPEND y una sola escritura: a lo sumo queda una linea cortada al final, que se ignora al reaplicar
+    if (write(walFd, linea, len) != (ssize_t) len)
+        LISSANDRA_LOG_SYSERROR("write");
+
+    uint64_t const lsn = ++lsnEscrito;
+
+    pthread_mutex_unlock(&walMutex);
+    return lsn;
+}
+
+static void _abrirSegmento(uint32_t segmento)
+{
+    char path[PATH_MAX];
+    _pathSegmento(segmento, path);
+
+    walFd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (walFd < 0)
+    {
+        LISSANDRA_LOG_SYSERROR("open");
+        exit(EXIT_FAILURE);
+    }
+
+    // la entrada del directorio tambien tiene que estar en disco, si no el segmento puede desaparecer
+    if (confLFS.MODO_WAL != WAL_NONE)
+        _sincronizarDirectorio();
+}
+
+static void _sincronizarDirectorio(void)
+{
+    int fd = open(pathWAL, O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        LISSANDRA_LOG_SYSERROR("open");
+        return;
+    }
+
+    if (fsync(fd) < 0)
+        LISSANDRA_LOG_SYSERROR("fsync");
+
+    close(fd);
+}
+
+static size_t _reaplicarSegmento(char const* path, WALReplayFn* fn, WALDropFn* drop)
+{
+    FILE* segmento = fopen(path, "r");
+    if (!segmento)
+    {
+        LISSANDRA_LOG_SYSERROR("fopen");
+        return 0;
+    }
+
+    size_t registros = 0;
+    char* linea = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&linea, &cap, segmento)) > 0)
+    {
+        // linea cortada por una caida a mitad de escritura: nunca se confirmo
+        if (linea[len - 1] != '\n')
+            break;
+        linea[len - 1] = '\0';
+
+        // tabla;timestamp;key;value, o tabla;timestamp;key si es un tombstone
+        char* campos[4];
+        campos[0] = linea;
+        size_t n = 1;
+        for (char* p = linea; n < 4 && (p = strchr(p, ';')); ++n)
+        {
+            *p++ = '\0';
+            campos[n] = p;
+        }
+
+        // lo anterior de la tabla es de antes del DROP, lo que siga es de una tabla nueva con el mismo nombre
+        if (n == 2 && !strcmp(campos[1], MarcaDrop))
+        {
+            drop(campos[0]);
+            continue;
+        }
+
+        uint16_t key;
+        if (n < 3 || !ValidateKey(campos[2], &key) || (n == 4 && strlen(campos[3]) > confLFS.TAMANIO_VALUE))
+        {
+            LISSANDRA_LOG_ERROR("WAL: registro invalido en %s, se ignora", path);
+            continue;
+        }
+
+        // la tabla pudo haberse borrado despues del INSERT
+        char pathTabla[PATH_MAX];
+        generarPathTabla(campos[0], pathTabla);
+        if (!existeDir(pathTabla))
+            continue;
+
+        fn(campos[0], key, n == 4 ? campos[3] : NULL, strtoull(campos[1], NULL, 10));
+        ++registros;
+    }
+
+    Free(linea);
+    fclose(segmento);
+    return registros;
+}
@@ -0,0 +1,62 @@
+
+#ifndef LISSANDRA_WAL_H
+#define LISSANDRA_WAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Log de escritura anticipada (WAL) de la memtable.
+ *
+ * Cada INSERT o DELETE se agrega al segmento actual (<montaje>WAL/N.log) antes de confirmarse, asi lo que todavia
+ * esta en memoria sobrevive a una caida. Al iniciar se reaplican todos los segmentos sobre la memtable.
+ * Un DROP deja una marca en el log: al reaplicar se descarta lo anterior de esa tabla, asi no pasa a otra que se
+ * cree con el mismo nombre.
+ * En cada dump se cierra el segmento actual y se abre uno nuevo; cuando el dump termina bien los segmentos
+ * viejos se borran.
+ *
+ * Modos (MODO_WAL):
+ *  NONE:   se escribe pero no se sincroniza, sobrevive a una caida del proceso pero no del sistema
+ *  GROUP:  INSERTs concurrentes comparten un mismo fdatasync. El primero espera VENTANA_WAL_US
+ *          microsegundos a que se sumen otros antes de sincronizar
+ *  ALWAYS: un fdatasync por cada escritura
+ */
+
+typedef enum
+{
+    WAL_NONE,
+    WAL_GROUP,
+    WAL_ALWAYS
+} WALMode;
+
+bool wal_modo_desde_string(char const* modo, uint8_t* resultado);
+
+// value NULL: el registro es un tombstone
+typedef void WALReplayFn(char const* nombreTabla, uint16_t key, char const* value, uint64_t timestamp);
+
+// descarta lo reaplicado hasta ahora de la tabla
+typedef void WALDropFn(char const* nombreTabla);
+
+// reaplica los segmentos existentes y abre uno nuevo
+void wal_init(WALReplayFn* fn, WALDropFn* drop);
+
+// agrega un registro al segmento actual (value NULL para un tombstone), devuelve su numero de secuencia
+// llamar bajo el mismo lock que inserta en la memtable, asi el registro queda en el segmento de su memtable
+uint64_t wal_append(char const* nombreTabla, uint16_t key, char const* value, uint64_t timestamp);
+
+// agrega la marca de DROP de la tabla, igual que wal_append
+uint64_t wal_append_drop(char const* nombreTabla);
+
+// bloquea hasta que el registro lsn (y todos los anteriores) esten en disco, segun el modo configurado
+void wal_sync(uint64_t lsn);
+
+// cierra el segmento actual (sincronizandolo) y abre uno nuevo. Devuelve el numero del segmento cerrado
+// llamar bajo el lock de la memtable al intercambiarla para el dump
+uint32_t wal_rotate(void);
+
+// borra los segmentos hasta el indicado inclusive, sus registros ya estan en temporales
+void wal_truncate(uint32_t segmento);
+
+void wal_destroy(void);
+
+#endif //LISSANDRA_WAL_H
@@ -1,9 +1,11 @@
 
 #include "API.h"
 #include "Config.h"
-#include "FileSystemSocket.h"
+#include "FileSystemPool.h"
 #include "Frame.h"
+#include "InFlight.h"
 #include "MainMemory.h"
+#include <inttypes.h>
 #include <Logger.h>
 #include <Opcodes.h>
 #include <Packet.h>
@@ -19,45 +21,80 @@ do { \
     Packet_Destroy(p); \
 } while(false)
 
-static void _ungratefulExit(void)
+static void Journal_Write(Vector* dirtyFrames);
+
+// todas las paginas estan modificadas: en lugar de un JOURNAL completo bajo un lote de las mas viejas
+static bool _writeBackOnFull(void)
 {
-    LISSANDRA_LOG_FATAL("Se desconectó el FileSystem!! Saliendo...");
-    exit(EXIT_FAILURE);
+    if (!ConfigMemoria.LOTE_WRITEBACK)
+        return false;
+
+    return Memory_WriteBack(ConfigMemoria.LOTE_WRITEBACK, Journal_Write) > 0;
 }
 
-SelectResult API_Select(char const* tableName, uint16_t key, char* value)
+bool API_SelectCached(char const* tableName, uint16_t key, char* value)
 {
-    uint32_t const maxValueLength = Memory_GetMaxValueLength();
-
     // delay artificial acceso a memoria (read latency)
     MSSleep(ConfigMemoria.RETARDO_MEM);
-    Frame* f = Memory_GetFrame(tableName, key);
-    if (f)
-    {
-        *value = '\0';
-        strncat(value, f->Value, maxValueLength);
+    return Memory_GetValue(Memory_FindTableId(tableName), key, value);
+}
+
+SelectResult API_Select(char const* tableName, uint16_t key, char* value)
+{
+    if (API_SelectCached(tableName, key, value))
         return Ok;
-    }
+
+    return API_SelectFromFS(tableName, key, value);
+}
+
+static SelectResult _selectFromFS(char const* tableName, uint16_t key, char* value);
+
+SelectResult API_SelectFromFS(char const* tableName, uint16_t key, char* value)
+{
+    // sin id no hay con que agrupar los pedidos: va directo al FS, que es el que confirma la tabla
+    uint32_t const tableId = Memory_FindTableId(tableName);
+    if (tableId == MEMORY_NO_TABLE)
+        return _selectFromFS(tableName, key, value);
+
+    // un solo pedido al FS (y un solo marco) por clave aunque fallen varios a la vez
+    SelectResult result;
+    InFlightMiss* miss = InFlight_Begin(tableId, key, &result, value);
+    if (!miss)
+        return result;
+
+    result = _selectFromFS(tableName, key, value);
+    InFlight_Complete(miss, result, value);
+    return result;
+}
+
+static SelectResult _selectFromFS(char const* tableName, uint16_t key, char* value)
+{
+    uint32_t const maxValueLength = Memory_GetMaxValueLength();
 
     // delay artificial acceso FS
     MSSleep(ConfigMemoria.RETARDO_FS);
 
+    // si un DELETE o DROP se cruza con el pedido, lo que devuelva el FS no se carga
+    uint64_t const epoch = Memory_GetEpoch();
+
     // si llegué aca es porque no encuentro el valor asi que voy a ir a buscarlo al FS
     Packet* p = Packet_Create(LQL_SELECT, 16 + 2); // adivinar tamaño
     Packet_Append(p, tableName);
     Packet_Append(p, key);
-    Socket_SendPacket(FileSystemSocket, p);
-    Packet_Destroy(p);
 
-    p = Socket_RecvPacket(FileSystemSocket);
+    Packet* request = p;
+    p = FileSystemPool_Request(request);
+    Packet_Destroy(request);
     if (!p)
-        _ungratefulExit();
+        return FileSystemUnavailable;
 
     switch (Packet_GetOpcode(p))
     {
         case MSG_SELECT:
             break;
         case MSG_ERR_KEY_NOT_FOUND:
+            // la tabla existe: con id, los proximos fallos sobre ella se agrupan
+            Memory_GetTableId(tableName);
             Packet_Destroy(p);
             return KeyNotFound;
         case MSG_ERR_TABLE_NOT_EXISTS:
@@ -78,7 +115,10 @@ SelectResult API_Select(char const* tableName, uint16_t key, char* value)
     Free(fs_value);
     Packet_Destroy(p);
 
-    if (!Memory_InsertNewValue(tableName, timestamp, key, value))
+    // el FS confirmo la tabla, si no tenia id recien ahora se le asigna
+    uint32_t const tableId = Memory_GetTableId(tableName);
+    if (!Memory_InsertNewValue(tableId, timestamp, key, value, epoch) &&
+        (!_writeBackOnFull() || !Memory_InsertNewValue(tableId, timestamp, key, value, epoch)))
         return MemoryFull;
 
     // delay artificial acceso a memoria (write latency)
@@ -86,7 +126,7 @@ SelectResult API_Select(char const* tableName, uint16_t key, char* value)
     return Ok;
 }
 
-InsertResult API_Insert(char const* tableName, uint16_t key, char const* value)
+InsertResult API_InsertCached(char const* tableName, uint16_t key, char const* value)
 {
     size_t const maxLen = Memory_GetMaxValueLength();
 
@@ -98,7 +138,7 @@ InsertResult API_Insert(char const* tableName, uint16_t key, char const* value)
     }
 
     LISSANDRA_LOG_DEBUG("INSERT %s %u %s", tableName, key, value);
-    if (!Memory_UpsertValue(tableName, key, value))
+    if (!Memory_UpsertValue(Memory_GetTableId(tableName), key, value))
         return InsertFull;
 
     // delay artificial acceso a memoria (write latency)
@@ -106,20 +146,29 @@ InsertResult API_Insert(char const* tableName, uint16_t key, char const* value)
     return InsertOk;
 }
 
-uint8_t API_Create(char const* tableName, CriteriaType consistency, uint16_t partitions, uint32_t compactionTime)
+InsertResult API_Insert(char const* tableName, uint16_t key, char const* value)
+{
+    InsertResult res = API_InsertCached(tableName, key, value);
+    if (res == InsertFull && _writeBackOnFull())
+        res = API_InsertCached(tableName, key, value);
+
+    return res;
+}
+
+uint8_t API_Create(char const* tableName, CriteriaType consistency, uint16_t partitions, uint32_t compactionTime, uint32_t ttl)
 {
-    Packet* p = Packet_Create(LQL_CREATE, 16 + 3 + 4 + 4); // adivinar tamaño
+    Packet* p = Packet_Create(LQL_CREATE, 16 + 3 + 4 + 4 + 4); // adivinar tamaño
     Packet_Append(p, tableName);
     Packet_Append(p, (uint8_t) consistency);
     Packet_Append(p, partitions);
     Packet_Append(p, compactionTime);
+    Packet_Append(p, ttl);
 
-    Socket_SendPacket(FileSystemSocket, p);
-    Packet_Destroy(p);
-
-    p = Socket_RecvPacket(FileSystemSocket);
+    Packet* request = p;
+    p = FileSystemPool_Request(request);
+    Packet_Destroy(request);
     if (!p)
-        _ungratefulExit();
+        return EXIT_FAILURE;
 
     if (Packet_GetOpcode(p) != MSG_CREATE_RESPUESTA)
     {
@@ -131,32 +180,34 @@ uint8_t API_Create(char const* tableName, CriteriaType consistency, uint16_t par
     Packet_Read(p, &createRes);
     Packet_Destroy(p);
 
+    if (createRes == EXIT_SUCCESS)
+        Memory_GetTableId(tableName);
+
     return createRes;
 }
 
-bool API_Describe(char const* tableName, Vector* results)
+DescribeResult API_Describe(char const* tableName, Vector* results)
 {
-    bool result = true;
+    DescribeResult result = DescribeOk;
     Packet* p = Packet_Create(LQL_DESCRIBE, 16);
     Packet_Append(p, (bool) tableName);
     if (tableName)
         Packet_Append(p, tableName);
 
-    Socket_SendPacket(FileSystemSocket, p);
-    Packet_Destroy(p);
-
-    uint32_t numTables;
-    p = Socket_RecvPacket(FileSystemSocket);
+    Packet* request = p;
+    p = FileSystemPool_Request(request);
+    Packet_Destroy(request);
     if (!p)
-        _ungratefulExit();
+        return DescribeUnavailable;
 
+    uint32_t numTables;
     switch (Packet_GetOpcode(p))
     {
         case MSG_ERR_TABLE_NOT_EXISTS:
             if (tableName)
                 LISSANDRA_LOG_ERROR("DESCRIBE: tabla %s no existe en FileSystem!", tableName);
             numTables = 0;
-            result = false;
+            result = DescribeNotFound;
             break;
         case MSG_DESCRIBE:
             numTables = 1;
@@ -166,7 +217,7 @@ bool API_Describe(char const* tableName, Vector* results)
             break;
         default:
             LOG_INVALID_OPCODE("DESCRIBE");
-            return true; /* si devuelvo false es que no encontre tabla */
+            return DescribeOk; /* DescribeNotFound es que no encontre tabla */
     }
 
     Vector_reserve(results, numTables);
@@ -177,6 +228,11 @@ bool API_Describe(char const* tableName, Vector* results)
         Packet_Read(p, &Metadata.ct);
         Packet_Read(p, &Metadata.parts);
         Packet_Read(p, &Metadata.compTime);
+        Packet_Read(p, &Metadata.ttl);
+        Packet_Read(p, &Metadata.expired);
+
+        // asi el primer pedido sobre la tabla ya tiene su id
+        Memory_GetTableId(Metadata.tableName);
 
         Vector_push_back(results, &Metadata);
     }
@@ -187,16 +243,20 @@ bool API_Describe(char const* tableName, Vector* results)
 
 uint8_t API_Drop(char const* tableName)
 {
-    Memory_EvictPages(tableName);
+    Memory_EvictPages(Memory_FindTableId(tableName));
 
     Packet* p = Packet_Create(LQL_DROP, 16);
     Packet_Append(p, tableName);
-    Socket_SendPacket(FileSystemSocket, p);
-    Packet_Destroy(p);
 
-    p = Socket_RecvPacket(FileSystemSocket);
+    Packet* request = p;
+    p = FileSystemPool_Request(request);
+    Packet_Destroy(request);
+
+    // un SELECT que se mando despues de desalojar pudo llegar al FS antes que el DROP y cargar la tabla de nuevo
+    // (y asignarle id si no tenia)
+    Memory_EvictPages(Memory_FindTableId(tableName));
     if (!p)
-        _ungratefulExit();
+        return EXIT_FAILURE;
 
     if (Packet_GetOpcode(p) != MSG_DROP_RESPUESTA)
     {
@@ -211,54 +271,216 @@ uint8_t API_Drop(char const* tableName)
     return dropRes;
 }
 
-static void Journal_Register(void* dirtyFrame)
+uint8_t API_Delete(char const* tableName, uint16_t key)
+{
+    // aunque este modificada, la pagina ya no vale: el tombstone del FS es mas nuevo
+    Memory_EvictPage(Memory_FindTableId(tableName), key);
+
+    // delay artificial acceso FS
+    MSSleep(ConfigMemoria.RETARDO_FS);
+
+    Packet* p = Packet_Create(LQL_DELETE, 16 + 2 + 8);
+    Packet_Append(p, tableName);
+    Packet_Append(p, key);
+    Packet_Append(p, GetMSEpoch());
+
+    Packet* request = p;
+    p = FileSystemPool_Request(request);
+    Packet_Destroy(request);
+
+    // un SELECT que se mando despues de desalojar pudo llegar al FS antes que el DELETE y cargar el valor viejo
+    // las modificadas son INSERT posteriores, se conservan
+    Memory_InvalidatePage(Memory_FindTableId(tableName), key);
+    if (!p)
+        return EXIT_FAILURE;
+
+    if (Packet_GetOpcode(p) != MSG_DELETE_RESPUESTA)
+    {
+        LOG_INVALID_OPCODE("DELETE");
+        return false;
+    }
+
+    uint8_t deleteRes;
+    Packet_Read(p, &deleteRes);
+    Packet_Destroy(p);
+
+    return deleteRes;
+}
+
+// paquete LQL_INSERT_BATCH enviado y todavia sin respuesta: paginas [Begin, End) del journal
+typedef struct
+{
+    size_t Begin;
+    size_t End;
+} JournalBatch;
+
+static int _compareTableId(void const* a, void const* b)
+{
+    DirtyFrame const* const dfA = a;
+    DirtyFrame const* const dfB = b;
+    return (dfA->TableId > dfB->TableId) - (dfA->TableId < dfB->TableId);
+}
+
+static inline bool _sameTable(DirtyFrame const* frames, size_t i, size_t begin)
+{
+    return i != begin && frames[i].TableId == frames[i - 1].TableId;
+}
+
+// envia las paginas a partir de begin agrupadas por tabla, tantas como entren en un paquete
+// devuelve donde termina el lote
+static size_t Journal_SendBatch(Socket* fs, DirtyFrame const* frames, size_t begin, size_t total)
 {
     uint32_t const maxValueLength = Memory_GetMaxValueLength();
 
-    DirtyFrame* const df = dirtyFrame;
+    // primero mido el lote: el paquete lleva la cantidad de tablas y de registros por tabla adelante
+    size_t end = begin;
+    size_t size = sizeof(uint16_t);
+    uint16_t numTables = 0;
+    for (; end < total; ++end)
+    {
+        bool const newTable = !_sameTable(frames, end, begin);
+        size_t recordSize = sizeof(uint16_t) + sizeof(uint32_t) + strnlen(frames[end].Frame->Value, maxValueLength) +
+                            sizeof(uint64_t);
+        if (newTable)
+            recordSize += sizeof(uint32_t) + strlen(Memory_GetTableName(frames[end].TableId)) + sizeof(uint32_t);
 
-    Packet* p = Packet_Create(LQL_INSERT, 50);
-    Packet_Append(p, df->TableName);
-    Packet_Append(p, df->Frame->Key);
+        if (end != begin && (size + recordSize >= SOCKET_MAX_PACKET_SIZE || (newTable && numTables == UINT16_MAX)))
+            break;
 
-    char value[maxValueLength + 1];
-    *value = '\0';
-    strncat(value, df->Frame->Value, maxValueLength);
-    Packet_Append(p, value);
+        size += recordSize;
+        numTables += newTable;
+    }
+
+    Packet* p = Packet_Create(LQL_INSERT_BATCH, size);
+    Packet_Append(p, numTables);
 
-    Packet_Append(p, df->Frame->Timestamp);
+    char value[maxValueLength + 1];
+    for (size_t i = begin; i < end;)
+    {
+        size_t groupEnd = i + 1;
+        while (groupEnd < end && _sameTable(frames, groupEnd, i))
+            ++groupEnd;
+
+        Packet_Append(p, Memory_GetTableName(frames[i].TableId));
+        Packet_Append(p, (uint32_t) (groupEnd - i));
+        for (; i < groupEnd; ++i)
+        {
+            Frame const* const f = frames[i].Frame;
+            *value = '\0';
+            strncat(value, f->Value, maxValueLength);
+
+            Packet_Append(p, f->Key);
+            Packet_Append(p, value);
+            Packet_Append(p, f->Timestamp);
+        }
+    }
 
-    Socket_SendPacket(FileSystemSocket, p);
+    Socket_SendPacket(fs, p);
     Packet_Destroy(p);
+    return end;
+}
 
-    p = Socket_RecvPacket(FileSystemSocket);
+// el FS responde los lotes en orden, con un resultado por tabla
+// devuelve false si se perdio la conexion, las paginas del lote quedan sin escribir
+static bool Journal_RecvBatch(Socket* fs, DirtyFrame* frames, JournalBatch const* batch)
+{
+    Packet* p = Socket_RecvPacket(fs);
     if (!p)
-        _ungratefulExit();
+        return false;
 
-    if (Packet_GetOpcode(p) != MSG_INSERT_RESPUESTA)
+    if (Packet_GetOpcode(p) != MSG_INSERT_BATCH_RESPUESTA)
     {
         LOG_INVALID_OPCODE("JOURNAL_INSERT");
-        return;
+        return true;
     }
 
-    // En el caso que al momento de realizar el Journaling una tabla no exista,
-    // deberá informar por archivo de log esta situación,
-    // pero el proceso deberá actualizar correctamente las tablas que sí existen.
-    uint8_t respuestaInsert;
-    Packet_Read(p, &respuestaInsert);
+    uint16_t numTables;
+    Packet_Read(p, &numTables);
 
-    if (respuestaInsert == EXIT_FAILURE)
-        LISSANDRA_LOG_WARN("JOURNAL: Intento de insertar key %u, valor '%s' en tabla %s no existente!", df->Frame->Key, value, df->TableName);
-    else
-        LISSANDRA_LOG_TRACE("JOURNAL: insertado key %u, valor '%s' en tabla %s", df->Frame->Key, value, df->TableName);
+    size_t i = batch->Begin;
+    for (uint16_t t = 0; t < numTables && i < batch->End; ++t)
+    {
+        uint8_t respuestaInsert;
+        Packet_Read(p, &respuestaInsert);
+
+        size_t const groupBegin = i;
+        do
+            frames[i].Result = respuestaInsert != EXIT_FAILURE ? WriteOk : WriteNoTable;
+        while (++i < batch->End && _sameTable(frames, i, groupBegin));
+
+        // En el caso que al momento de realizar el Journaling una tabla no exista,
+        // deberá informar por archivo de log esta situación,
+        // pero el proceso deberá actualizar correctamente las tablas que sí existen.
+        if (respuestaInsert == EXIT_FAILURE)
+            LISSANDRA_LOG_WARN("JOURNAL: Intento de insertar %zu keys en tabla %s no existente!", i - groupBegin,
+                               Memory_GetTableName(frames[groupBegin].TableId));
+        else
+            LISSANDRA_LOG_TRACE("JOURNAL: insertadas %zu keys en tabla %s", i - groupBegin,
+                                Memory_GetTableName(frames[groupBegin].TableId));
+    }
 
     Packet_Destroy(p);
+    return true;
 }
 
-void API_Journal(PeriodicTimer* pt)
+static void Journal_Write(Vector* dirtyFrames)
 {
-    (void) pt;
+    size_t const total = Vector_size(dirtyFrames);
+    DirtyFrame* const frames = Vector_data(dirtyFrames);
+    uint64_t const start = GetMSEpoch();
+
+    // juntas, cada tabla va una sola vez por paquete
+    qsort(frames, total, sizeof(DirtyFrame), _compareTableId);
+
+    // todo el journal va por una misma conexion, los lotes se responden en orden
+    Socket* fs = FileSystemPool_Acquire();
+    if (!fs)
+        return;
+
+    // sigo enviando lotes mientras el FS procesa los anteriores, hasta VENTANA_JOURNAL sin respuesta
+    size_t const window = ConfigMemoria.VENTANA_JOURNAL ? ConfigMemoria.VENTANA_JOURNAL : 1;
+    JournalBatch* const pending = Malloc(window * sizeof(JournalBatch));
+    size_t oldest = 0;
+    size_t numPending = 0;
+    size_t numBatches = 0;
 
+    size_t next = 0;
+    while (next < total || numPending)
+    {
+        if (next < total && numPending < window)
+        {
+            JournalBatch* const batch = pending + (oldest + numPending) % window;
+            batch->Begin = next;
+            batch->End = next = Journal_SendBatch(fs, frames, next, total);
+            ++numPending;
+            ++numBatches;
+            continue;
+        }
+
+        if (!Journal_RecvBatch(fs, frames, pending + oldest))
+        {
+            LISSANDRA_LOG_ERROR("JOURNAL: se desconectó el FileSystem!!");
+            break;
+        }
+
+        oldest = (oldest + 1) % window;
+        --numPending;
+    }
+
+    FileSystemPool_Release(fs, next < total || numPending);
+    Free(pending);
+
+    LISSANDRA_LOG_DEBUG("JOURNAL: %zu paginas enviadas en %zu paquetes (%" PRIu64 " ms)", total, numBatches,
+                        GetMSEpoch() - start);
+}
+
+void API_Journal(void)
+{
     LISSANDRA_LOG_DEBUG("JOURNAL");
-    Memory_DoJournal(Journal_Register);
+    Memory_DoJournal(Journal_Write);
+}
+
+void API_WriteBack(void)
+{
+    Memory_WriteBack(ConfigMemoria.LOTE_WRITEBACK, Journal_Write);
 }
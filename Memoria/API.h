@@ -9,14 +9,14 @@
 #include <stdint.h>
 #include <vector.h>
 
-typedef struct PeriodicTimer PeriodicTimer;
-
 typedef struct
 {
     char* tableName;
     uint8_t ct;
     uint16_t parts;
     uint32_t compTime;
+    uint32_t ttl;
+    uint64_t expired;
 } TableMD;
 
 static inline void FreeMD(void* md)
@@ -30,13 +30,18 @@ typedef enum
     Ok,
     KeyNotFound,
     TableNotFound,
-    MemoryFull
+    MemoryFull,
+    FileSystemUnavailable
 } SelectResult;
 
 // devuelve un código dependiendo del resultado
 // value debe apuntar a un espacio con (maxValueLength+1) bytes
 SelectResult API_Select(char const* tableName, uint16_t key, char* value);
 
+// las dos mitades de API_Select: solo memoria (true si acierta) y el pedido al FS despues de un fallo
+bool API_SelectCached(char const* tableName, uint16_t key, char* value);
+SelectResult API_SelectFromFS(char const* tableName, uint16_t key, char* value);
+
 typedef enum
 {
     InsertOk,
@@ -47,17 +52,35 @@ typedef enum
 // en memoria va sin timestamp el request, se calcula luego. ver #1355
 InsertResult API_Insert(char const* tableName, uint16_t key, char const* value);
 
-// devuelve EXIT_FAILURE si la tabla ya existe en el FS
-uint8_t API_Create(char const* tableName, CriteriaType ct, uint16_t partitions, uint32_t compactionTime);
+// sin bajar paginas al FS si la memoria esta llena (InsertFull)
+InsertResult API_InsertCached(char const* tableName, uint16_t key, char const* value);
+
+// devuelve EXIT_FAILURE si la tabla ya existe en el FS (o no se pudo comunicar con el FS)
+// ttl en milisegundos, 0 si los registros no expiran
+uint8_t API_Create(char const* tableName, CriteriaType ct, uint16_t partitions, uint32_t compactionTime, uint32_t ttl);
+
+typedef enum
+{
+    DescribeOk,
+    DescribeNotFound,
+    DescribeUnavailable
+} DescribeResult;
 
 // solicita al FS directamente
 // results se encuentra construido con sizeof(struct MD)
-// devuelve false si la tabla no existe en FS
-bool API_Describe(char const* tableName, Vector* results);
+// devuelve DescribeNotFound si la tabla no existe en FS
+DescribeResult API_Describe(char const* tableName, Vector* results);
 
-// devuelve EXIT_FAILURE si la tabla no existe en el FS
+// devuelve EXIT_FAILURE si la tabla no existe en el FS (o no se pudo comunicar con el FS)
 uint8_t API_Drop(char const* tableName);
 
-void API_Journal(PeriodicTimer* pt);
+// desaloja la pagina y envia el DELETE al FS con el timestamp actual
+// devuelve EXIT_FAILURE si la tabla no existe en el FS (o no se pudo comunicar con el FS)
+uint8_t API_Delete(char const* tableName, uint16_t key);
+
+void API_Journal(void);
+
+// baja al FS un lote (LOTE_WRITEBACK) de las paginas modificadas hace mas tiempo, sin limpiar la memoria
+void API_WriteBack(void);
 
 #endif //Memoria_API_h
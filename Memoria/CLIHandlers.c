@@ -1,10 +1,12 @@
 
 #include "CLIHandlers.h"
 #include "API.h"
+#include "InFlight.h"
 #include "MainMemory.h"
 #include <ConsoleInput.h>
 #include <Consistency.h>
 #include <stddef.h>
+#include <stdlib.h>
 
 void HandleSelect(Vector const* args)
 {
@@ -47,6 +49,9 @@ void HandleSelect(Vector const* args)
         case TableNotFound:
             LISSANDRA_LOG_ERROR("SELECT: tabla %s no existe!", table);
             break;
+        case FileSystemUnavailable:
+            LISSANDRA_LOG_ERROR("SELECT: FileSystem no disponible!");
+            break;
     }
 
     Free(value);
@@ -93,12 +98,12 @@ void HandleInsert(Vector const* args)
 void HandleCreate(Vector const* args)
 {
     //           cmd args
-    //           0      1       2          3            4
-    // sintaxis: CREATE <table> <criteria> <partitions> <compaction_time>
+    //           0      1       2          3            4                 5 (opcional)
+    // sintaxis: CREATE <table> <criteria> <partitions> <compaction_time> <ttl>
 
-    if (Vector_size(args) != 5)
+    if (Vector_size(args) != 5 && Vector_size(args) != 6)
     {
-        LISSANDRA_LOG_ERROR("CREATE: Uso - CREATE <tabla> <criterio> <particiones> <tiempo entre compactaciones>");
+        LISSANDRA_LOG_ERROR("CREATE: Uso - CREATE <tabla> <criterio> <particiones> <tiempo entre compactaciones> [TTL]");
         return;
     }
 
@@ -114,11 +119,12 @@ void HandleCreate(Vector const* args)
 
     uint16_t parts = strtoul(partitions, NULL, 10);
     uint32_t compactTime = strtoul(compaction_time, NULL, 10);
+    uint32_t ttl = Vector_size(args) == 6 ? strtoul(tokens[5], NULL, 10) : 0;
     CriteriaType ct;
     if (!CriteriaFromString(criteria, &ct))
         return;
 
-    API_Create(table, ct, parts, compactTime);
+    API_Create(table, ct, parts, compactTime, ttl);
 }
 
 static void DescribeTable(void* md)
@@ -129,6 +135,8 @@ static void DescribeTable(void* md)
     LISSANDRA_LOG_INFO("  Criterio: %s", CriteriaString[p->ct].String);
     LISSANDRA_LOG_INFO("  Particiones: %u", p->parts);
     LISSANDRA_LOG_INFO("  Tiempo entre Compactaciones: %u", p->compTime);
+    if (p->ttl)
+        LISSANDRA_LOG_INFO("  TTL: %u ms (%" PRIu64 " registros expirados)", p->ttl, p->expired);
 }
 
 void HandleDescribe(Vector const* args)
@@ -156,8 +164,18 @@ void HandleDescribe(Vector const* args)
     Vector v;
     Vector_Construct(&v, sizeof(TableMD), FreeMD, 0);
 
-    if (!API_Describe(table, &v) && table)
-        LISSANDRA_LOG_ERROR("DESCRIBE: tabla %s no encontrada!", table);
+    switch (API_Describe(table, &v))
+    {
+        case DescribeNotFound:
+            if (table)
+                LISSANDRA_LOG_ERROR("DESCRIBE: tabla %s no encontrada!", table);
+            break;
+        case DescribeUnavailable:
+            LISSANDRA_LOG_ERROR("DESCRIBE: FileSystem no disponible!");
+            break;
+        default:
+            break;
+    }
 
     Vector_iterate(&v, DescribeTable);
 
@@ -185,6 +203,34 @@ void HandleDrop(Vector const* args)
     API_Drop(table);
 }
 
+void HandleDelete(Vector const* args)
+{
+    //           cmd args
+    //           0      1       2
+    // sintaxis: DELETE <table> <key>
+
+    if (Vector_size(args) != 3)
+    {
+        LISSANDRA_LOG_ERROR("DELETE: Uso - DELETE <tabla> <key>");
+        return;
+    }
+
+    char** const tokens = Vector_data(args);
+
+    char* const table = tokens[1];
+    char* const key = tokens[2];
+
+    if (!ValidateTableName(table))
+        return;
+
+    uint16_t k;
+    if (!ValidateKey(key, &k))
+        return;
+
+    if (API_Delete(table, k) == EXIT_FAILURE)
+        LISSANDRA_LOG_ERROR("DELETE: la tabla %s no existe en el File System", table);
+}
+
 void HandleJournal(Vector const* args)
 {
     //           cmd args
@@ -197,5 +243,21 @@ void HandleJournal(Vector const* args)
         return;
     }
 
-    API_Journal(NULL);
+    API_Journal();
+}
+
+void HandleStats(Vector const* args)
+{
+    //           cmd args
+    //           0
+    // sintaxis: STATS
+
+    if (Vector_size(args) != 1)
+    {
+        LISSANDRA_LOG_ERROR("STATS: Uso - STATS");
+        return;
+    }
+
+    Memory_Report();
+    InFlight_Report();
 }
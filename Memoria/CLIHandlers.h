@@ -8,6 +8,8 @@ CLICommandHandlerFn HandleInsert;
 CLICommandHandlerFn HandleCreate;
 CLICommandHandlerFn HandleDescribe;
 CLICommandHandlerFn HandleDrop;
+CLICommandHandlerFn HandleDelete;
 CLICommandHandlerFn HandleJournal;
+CLICommandHandlerFn HandleStats;
 
 #endif //Memoria_CLIHandlers_h__
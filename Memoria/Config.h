@@ -8,6 +8,15 @@
 #include <stdint.h>
 #include <vector.h>
 
+typedef enum
+{
+    // el journal vacia la memoria
+    JOURNAL_VACIAR,
+
+    // el journal deja las paginas bajadas al FS como limpias, la cache sigue valida
+    JOURNAL_CONSERVAR
+} ModoJournal;
+
 typedef struct
 {
     char PUERTO[PORT_STRLEN];
@@ -18,11 +27,32 @@ typedef struct
     size_t TAM_MEM;
     uint32_t MEMORY_NUMBER;
 
+    // LRU, CLOCK, 2Q o ARC (opcional, LRU por defecto)
+    char ALGORITMO_REEMPLAZO[8];
+
+    // hilos que atienden pedidos solo con la memoria y los que esperan al FS (opcionales, 2 y 4 por defecto)
+    uint32_t HILOS_MEMORIA;
+    uint32_t HILOS_FS;
+
+    // conexiones abiertas con el FS, los pedidos al FS se superponen de a tantos (opcional, HILOS_FS por defecto)
+    uint32_t CONEXIONES_FS;
+
     // Campos recargables en runtime
     uint32_t RETARDO_MEM;
     uint32_t RETARDO_FS;
     uint32_t RETARDO_JOURNAL;
     uint32_t RETARDO_GOSSIPING;
+
+    // write-back de paginas modificadas (opcionales): cada cuanto en segundo plano (0 deshabilita) y cuantas por vez
+    // con la memoria llena tambien se baja un lote antes de pedir JOURNAL (LOTE_WRITEBACK 0 deshabilita)
+    uint32_t RETARDO_WRITEBACK;
+    uint32_t LOTE_WRITEBACK;
+
+    // VACIAR (por defecto) o CONSERVAR
+    ModoJournal MODO_JOURNAL;
+
+    // paquetes del journal enviados al FS sin esperar su respuesta (opcional, 8 por defecto)
+    uint32_t VENTANA_JOURNAL;
 } MemConfig;
 
 extern MemConfig ConfigMemoria;
@@ -0,0 +1,190 @@
+
+#include "FileSystemPool.h"
+#include "Config.h"
+#include "MainMemory.h"
+#include <Logger.h>
+#include <Malloc.h>
+#include <Opcodes.h>
+#include <Packet.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+// conexiones libres, las NumBroken de abajo de la pila son NULL: se cayeron y hay que reabrirlas
+static Socket** Idle = NULL;
+static size_t NumIdle = 0;
+static size_t NumBroken = 0;
+static size_t NumConnections = 0;
+
+static pthread_mutex_t PoolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PoolCond = PTHREAD_COND_INITIALIZER;
+
+static Socket* _connect(uint32_t* maxValueLength);
+static Socket* _acquire(bool* reused);
+static void _push(Socket* s);
+
+void FileSystemPool_Initialize(uint32_t* maxValueLength)
+{
+    NumConnections = ConfigMemoria.CONEXIONES_FS ? ConfigMemoria.CONEXIONES_FS : 1;
+    Idle = Malloc(NumConnections * sizeof(Socket*));
+
+    Socket* s = _connect(maxValueLength);
+    if (!s)
+    {
+        LISSANDRA_LOG_FATAL("No pude conectarme al FileSystem!!");
+        exit(1);
+    }
+
+    _push(s);
+
+    // si alguna de las demas no abre, se reintenta al usarla
+    for (size_t i = 1; i < NumConnections; ++i)
+    {
+        uint32_t fsMaxValueLength;
+        _push(_connect(&fsMaxValueLength));
+    }
+
+    LISSANDRA_LOG_TRACE("FS: %zu conexiones", NumConnections);
+}
+
+Packet* FileSystemPool_Request(Packet const* request)
+{
+    while (true)
+    {
+        bool reused;
+        Socket* s = _acquire(&reused);
+        if (!s)
+            return NULL;
+
+        Socket_SendPacket(s, request);
+        Packet* p = Socket_RecvPacket(s);
+        FileSystemPool_Release(s, !p);
+        if (p)
+            return p;
+
+        // cada intento descarta una conexion vieja, como mucho se prueban todas y una nueva
+        if (!reused)
+        {
+            LISSANDRA_LOG_ERROR("Se desconectó el FileSystem!!");
+            return NULL;
+        }
+
+        LISSANDRA_LOG_WARN("Se perdió una conexión con el FileSystem, reintentando...");
+    }
+}
+
+Socket* FileSystemPool_Acquire(void)
+{
+    bool reused;
+    return _acquire(&reused);
+}
+
+void FileSystemPool_Release(Socket* s, bool broken)
+{
+    if (broken)
+    {
+        Socket_Destroy(s);
+        s = NULL;
+    }
+
+    _push(s);
+}
+
+void FileSystemPool_Destroy(void)
+{
+    for (size_t i = 0; i < NumIdle; ++i)
+        if (Idle[i])
+            Socket_Destroy(Idle[i]);
+
+    Free(Idle);
+}
+
+/* PRIVATE */
+static Socket* _connect(uint32_t* maxValueLength)
+{
+    SocketOpts const so =
+    {
+        .HostName = ConfigMemoria.IP_FS,
+        .ServiceOrPort = ConfigMemoria.PUERTO_FS,
+        .SocketMode = SOCKET_CLIENT,
+        .SocketOnAcceptClient = NULL
+    };
+    Socket* s = Socket_Create(&so);
+    if (!s)
+        return NULL;
+
+    static uint8_t const id = MEMORIA;
+    Packet* p = Packet_Create(MSG_HANDSHAKE, 1);
+    Packet_Append(p, id);
+    Socket_SendPacket(s, p);
+    Packet_Destroy(p);
+
+    p = Socket_RecvPacket(s);
+    if (!p || Packet_GetOpcode(p) != MSG_HANDSHAKE_RESPUESTA)
+    {
+        LISSANDRA_LOG_ERROR("FileSystem envió respuesta inválida.");
+        if (p)
+            Packet_Destroy(p);
+        Socket_Destroy(s);
+        return NULL;
+    }
+
+    // el punto de montaje no lo usa la memoria
+    uint32_t fsMaxValueLength;
+    char* fsMountPoint;
+    Packet_Read(p, &fsMaxValueLength);
+    Packet_Read(p, &fsMountPoint);
+    Free(fsMountPoint);
+    Packet_Destroy(p);
+
+    // al reconectar los marcos ya tienen su tamaño
+    if (maxValueLength)
+        *maxValueLength = fsMaxValueLength;
+    else if (fsMaxValueLength != Memory_GetMaxValueLength())
+        LISSANDRA_LOG_WARN("El FileSystem ahora informa valores de %u caracteres (la memoria usa %u)",
+                           fsMaxValueLength, Memory_GetMaxValueLength());
+
+    return s;
+}
+
+static Socket* _acquire(bool* reused)
+{
+    pthread_mutex_lock(&PoolLock);
+    while (!NumIdle)
+        pthread_cond_wait(&PoolCond, &PoolLock);
+
+    Socket* s = Idle[--NumIdle];
+    if (NumIdle < NumBroken)
+        NumBroken = NumIdle;
+    pthread_mutex_unlock(&PoolLock);
+
+    *reused = s != NULL;
+    if (s)
+        return s;
+
+    s = _connect(NULL);
+    if (!s)
+    {
+        LISSANDRA_LOG_ERROR("FileSystem no disponible!");
+        _push(NULL);
+        return NULL;
+    }
+
+    LISSANDRA_LOG_INFO("Reconectado al FileSystem");
+    return s;
+}
+
+static void _push(Socket* s)
+{
+    pthread_mutex_lock(&PoolLock);
+    Idle[NumIdle] = s;
+    if (!s)
+    {
+        // las caidas van abajo, primero se usan las que siguen abiertas
+        Idle[NumIdle] = Idle[NumBroken];
+        Idle[NumBroken++] = NULL;
+    }
+
+    ++NumIdle;
+    pthread_cond_signal(&PoolCond);
+    pthread_mutex_unlock(&PoolLock);
+}
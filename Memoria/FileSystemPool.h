@@ -0,0 +1,33 @@
+
+#ifndef FileSystemPool_h__
+#define FileSystemPool_h__
+
+#include <Socket.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Conexiones con el FS. El FS atiende cada conexion en su propio hilo y en orden, asi que los pedidos de distintos
+ * hilos de la memoria solo se superponen si van por conexiones distintas: hay CONEXIONES_FS y cada pedido toma una
+ * libre hasta recibir su respuesta.
+ *
+ * Si el FS se desconecta la conexion se descarta y se vuelve a abrir (con su handshake) la proxima vez que se usa,
+ * en lugar de terminar la memoria.
+ */
+
+// abre las conexiones y devuelve el tamaño de value que informa el FS en el handshake. Sin FS al iniciar no hay memoria
+void FileSystemPool_Initialize(uint32_t* maxValueLength);
+
+// envia el pedido y espera la respuesta. Si falla una conexion abierta de antes (el FS se reinicio mientras
+// estaba libre) se reintenta por otra. Devuelve NULL si el FS no esta disponible
+Packet* FileSystemPool_Request(Packet const* request);
+
+// toma una conexion para varios pedidos seguidos (journal), NULL si el FS no esta disponible
+Socket* FileSystemPool_Acquire(void);
+
+// devuelve la conexion, si fallo se descarta y se reabre al volver a usarla
+void FileSystemPool_Release(Socket* s, bool broken);
+
+void FileSystemPool_Destroy(void);
+
+#endif //FileSystemPool_h__
@@ -1,9 +0,0 @@
-
-#ifndef FileSystemSocket_h__
-#define FileSystemSocket_h__
-
-#include <Socket.h>
-
-extern Socket* FileSystemSocket;
-
-#endif //FileSystemSocket_h__
@@ -2,6 +2,7 @@
 #ifndef Frame_h__
 #define Frame_h__
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <time.h>
 
@@ -15,10 +16,30 @@ typedef struct
 } Frame;
 #pragma pack(pop)
 
+typedef enum
+{
+    // sin respuesta del FS (se desconecto), sigue modificada
+    WritePending,
+
+    WriteOk,
+
+    // la tabla ya no existe en el FS
+    WriteNoTable
+} WriteResult;
+
+// copia de una pagina modificada, para bajarla al FS sin tener tomada la memoria
 typedef struct
 {
-    char const* TableName;
+    uint32_t TableId;
+
+    // copia propia del marco
     Frame const* Frame;
+
+    // version de la pagina al copiarla, si cambio hay una modificacion posterior (o es otra pagina)
+    uint64_t Version;
+
+    // lo completa quien la baja al FS
+    WriteResult Result;
 } DirtyFrame;
 
 #endif //Frame_h__
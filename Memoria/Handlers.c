@@ -20,11 +20,84 @@ OpcodeHandlerFnType* const OpcodeTable[NUM_HANDLED_OPCODES] =
     HandleCreateOpcode,     // LQL_CREATE
     HandleDescribeOpcode,   // LQL_DESCRIBE
     HandleDropOpcode,       // LQL_DROP
+    HandleDeleteOpcode,     // LQL_DELETE
+
+    // journal de memoria al FS, ignoramos
+    NULL,                   // LQL_INSERT_BATCH
 
     // el kernel envia este query
     HandleJournalOpcode     // LQL_JOURNAL
 };
 
+CachedHandlerFnType* const CachedOpcodeTable[NUM_HANDLED_OPCODES] =
+{
+    NULL,                   // MSG_HANDSHAKE
+
+    // aciertos e INSERT con lugar en memoria, el resto va al FS
+    HandleSelectCached,     // LQL_SELECT
+    HandleInsertCached,     // LQL_INSERT
+    NULL,                   // LQL_CREATE
+    NULL,                   // LQL_DESCRIBE
+    NULL,                   // LQL_DROP
+    NULL,                   // LQL_DELETE
+    NULL,                   // LQL_INSERT_BATCH
+    NULL                    // LQL_JOURNAL
+};
+
+static void _sendSelectResult(Socket* s, SelectResult result, char const* value)
+{
+    uint32_t maxValueLength = Memory_GetMaxValueLength();
+
+    Packet* resp;
+    switch (result)
+    {
+        case Ok:
+            resp = Packet_Create(MSG_SELECT, maxValueLength + 1);
+            Packet_Append(resp, value);
+            break;
+        case KeyNotFound:
+            resp = Packet_Create(MSG_ERR_KEY_NOT_FOUND, 0);
+            break;
+        case TableNotFound:
+            resp = Packet_Create(MSG_ERR_TABLE_NOT_EXISTS, 0);
+            break;
+        case MemoryFull:
+            resp = Packet_Create(MSG_ERR_MEM_FULL, maxValueLength + 1);
+            Packet_Append(resp, value);
+            break;
+        case FileSystemUnavailable:
+            resp = Packet_Create(MSG_ERR_FS_UNAVAILABLE, 0);
+            break;
+        default:
+            LISSANDRA_LOG_ERROR("API_Select retornó valor inválido!!");
+            return;
+    }
+
+    Socket_SendPacket(s, resp);
+    Packet_Destroy(resp);
+}
+
+static void _sendInsertResult(Socket* s, InsertResult result)
+{
+    Opcodes opcode;
+    switch (result)
+    {
+        case InsertOverflow:
+            opcode = MSG_ERR_VALUE_TOO_LONG;
+            break;
+        case InsertFull:
+            opcode = MSG_ERR_MEM_FULL;
+            break;
+        default:
+            opcode = MSG_INSERT_RESPUESTA;
+            break;
+    }
+
+    Packet* res = Packet_Create(opcode, 0);
+    Socket_SendPacket(s, res);
+    Packet_Destroy(res);
+}
+
 void HandleHandshakeOpcode(Socket* s, Packet* p)
 {
     uint8_t id;
@@ -91,7 +164,7 @@ void HandleHandshakeOpcode(Socket* s, Packet* p)
     Gossip_SendTable(s);
 }
 
-void HandleSelectOpcode(Socket* s, Packet* p)
+bool HandleSelectCached(Socket* s, Packet* p)
 {
     char* tableName;
     uint16_t key;
@@ -99,43 +172,56 @@ void HandleSelectOpcode(Socket* s, Packet* p)
     Packet_Read(p, &tableName);
     Packet_Read(p, &key);
 
-    uint32_t maxValueLength = Memory_GetMaxValueLength();
+    char* value = Malloc(Memory_GetMaxValueLength() + 1);
 
-    char* value = Malloc(maxValueLength + 1);
+    bool const hit = API_SelectCached(tableName, key, value);
+    if (hit)
+        _sendSelectResult(s, Ok, value);
 
-    Packet* resp;
-    switch (API_Select(tableName, key, value))
-    {
-        case Ok:
-            resp = Packet_Create(MSG_SELECT, maxValueLength + 1);
-            Packet_Append(resp, value);
-            break;
-        case KeyNotFound:
-            resp = Packet_Create(MSG_ERR_KEY_NOT_FOUND, 0);
-            break;
-        case TableNotFound:
-            resp = Packet_Create(MSG_ERR_TABLE_NOT_EXISTS, 0);
-            break;
-        case MemoryFull:
-            resp = Packet_Create(MSG_ERR_MEM_FULL, maxValueLength + 1);
-            Packet_Append(resp, value);
-            break;
-        default:
-            LISSANDRA_LOG_ERROR("API_Select retornó valor inválido!!");
-            return;
-    }
+    Free(value);
+    Free(tableName);
+    return hit;
+}
 
-    Socket_SendPacket(s, resp);
-    Packet_Destroy(resp);
+void HandleSelectOpcode(Socket* s, Packet* p)
+{
+    char* tableName;
+    uint16_t key;
+
+    Packet_Read(p, &tableName);
+    Packet_Read(p, &key);
+
+    char* value = Malloc(Memory_GetMaxValueLength() + 1);
+
+    // llega despues de fallar en memoria (HandleSelectCached)
+    _sendSelectResult(s, API_SelectFromFS(tableName, key, value), value);
 
     Free(value);
     Free(tableName);
 }
 
-void HandleInsertOpcode(Socket* s, Packet* p)
+bool HandleInsertCached(Socket* s, Packet* p)
 {
-    (void) s;
+    char* tableName;
+    uint16_t key;
+    char* value;
+
+    Packet_Read(p, &tableName);
+    Packet_Read(p, &key);
+    Packet_Read(p, &value);
+
+    // memoria llena: el write-back va al FS
+    InsertResult const result = API_InsertCached(tableName, key, value);
+    if (result != InsertFull)
+        _sendInsertResult(s, result);
+
+    Free(tableName);
+    Free(value);
+    return result != InsertFull;
+}
 
+void HandleInsertOpcode(Socket* s, Packet* p)
+{
     char* tableName;
     uint16_t key;
     char* value;
@@ -144,26 +230,12 @@ void HandleInsertOpcode(Socket* s, Packet* p)
     Packet_Read(p, &key);
     Packet_Read(p, &value);
 
-    Opcodes opcode;
-    switch (API_Insert(tableName, key, value))
-    {
-        case InsertOverflow:
-            opcode = MSG_ERR_VALUE_TOO_LONG;
-            break;
-        case InsertFull:
-            opcode = MSG_ERR_MEM_FULL;
-            break;
-        default:
-            opcode = MSG_INSERT_RESPUESTA;
-            break;
-    }
+    InsertResult const result = API_Insert(tableName, key, value);
 
     Free(tableName);
     Free(value);
 
-    Packet* res = Packet_Create(opcode, 0);
-    Socket_SendPacket(s, res);
-    Packet_Destroy(res);
+    _sendInsertResult(s, result);
 }
 
 void HandleCreateOpcode(Socket* s, Packet* p)
@@ -174,13 +246,15 @@ void HandleCreateOpcode(Socket* s, Packet* p)
     uint8_t ct;
     uint16_t parts;
     uint32_t compactionTime;
+    uint32_t ttl;
 
     Packet_Read(p, &tableName);
     Packet_Read(p, &ct);
     Packet_Read(p, &parts);
     Packet_Read(p, &compactionTime);
+    Packet_Read(p, &ttl);
 
-    uint8_t createResult = API_Create(tableName, (CriteriaType) ct, parts, compactionTime);
+    uint8_t createResult = API_Create(tableName, (CriteriaType) ct, parts, compactionTime, ttl);
     Free(tableName);
 
     Packet* res = Packet_Create(MSG_CREATE_RESPUESTA, 1);
@@ -196,6 +270,8 @@ static void AddToPacket(void* md, void* packet)
     Packet_Append(packet, p->ct);
     Packet_Append(packet, p->parts);
     Packet_Append(packet, p->compTime);
+    Packet_Append(packet, p->ttl);
+    Packet_Append(packet, p->expired);
 }
 
 void HandleDescribeOpcode(Socket* s, Packet* p)
@@ -210,12 +286,14 @@ void HandleDescribeOpcode(Socket* s, Packet* p)
     Vector v;
     Vector_Construct(&v, sizeof(TableMD), FreeMD, 0);
 
-    if (!API_Describe(tableName, &v))
+    DescribeResult const result = API_Describe(tableName, &v);
+    if (result != DescribeOk)
     {
         Free(tableName);
         Vector_Destruct(&v);
 
-        Packet* errPacket = Packet_Create(MSG_ERR_TABLE_NOT_EXISTS, 0);
+        Opcodes const opcode = result == DescribeNotFound ? MSG_ERR_TABLE_NOT_EXISTS : MSG_ERR_FS_UNAVAILABLE;
+        Packet* errPacket = Packet_Create(opcode, 0);
         Socket_SendPacket(s, errPacket);
         Packet_Destroy(errPacket);
         return;
@@ -254,10 +332,27 @@ void HandleDropOpcode(Socket* s, Packet* p)
     Packet_Destroy(res);
 }
 
+void HandleDeleteOpcode(Socket* s, Packet* p)
+{
+    char* tableName;
+    uint16_t key;
+
+    Packet_Read(p, &tableName);
+    Packet_Read(p, &key);
+
+    uint8_t deleteResult = API_Delete(tableName, key);
+    Free(tableName);
+
+    Packet* res = Packet_Create(MSG_DELETE_RESPUESTA, 1);
+    Packet_Append(res, deleteResult);
+    Socket_SendPacket(s, res);
+    Packet_Destroy(res);
+}
+
 void HandleJournalOpcode(Socket* s, Packet* p)
 {
     (void) s;
     (void) p;
 
-    API_Journal(NULL);
+    API_Journal();
 }
@@ -3,6 +3,14 @@
 #define Memoria_Handlers_h__
 
 #include <OpcodeHandler.h>
+#include <Opcodes.h>
+#include <stdbool.h>
+
+// intenta atender el pedido solo con la memoria, false si hay que ir al FS (no respondio nada)
+typedef bool CachedHandlerFnType(Socket* s, Packet* p);
+
+// los hilos de memoria usan esta tabla, los del FS OpcodeTable
+extern CachedHandlerFnType* const CachedOpcodeTable[NUM_HANDLED_OPCODES];
 
 OpcodeHandlerFnType HandleHandshakeOpcode;
 OpcodeHandlerFnType HandleSelectOpcode;
@@ -10,6 +18,10 @@ OpcodeHandlerFnType HandleInsertOpcode;
 OpcodeHandlerFnType HandleCreateOpcode;
 OpcodeHandlerFnType HandleDescribeOpcode;
 OpcodeHandlerFnType HandleDropOpcode;
+OpcodeHandlerFnType HandleDeleteOpcode;
 OpcodeHandlerFnType HandleJournalOpcode;
 
+CachedHandlerFnType HandleSelectCached;
+CachedHandlerFnType HandleInsertCached;
+
 #endif //Memoria_Handlers_h__
@@ -0,0 +1,144 @@
+
+#include "InFlight.h"
+#include "MainMemory.h"
+#include <inttypes.h>
+#include <Logger.h>
+#include <Malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+struct InFlightMiss
+{
+    uint32_t TableId;
+    uint16_t Key;
+
+    // el que va al FS tambien cuenta, el ultimo en irse libera la entrada
+    size_t Refs;
+    bool Done;
+
+    SelectResult Result;
+    char* Value;
+};
+
+// pocas entradas (como mucho una por hilo del FS), se recorren enteras
+static Vector Misses;
+static pthread_mutex_t InFlightLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t InFlightCond = PTHREAD_COND_INITIALIZER;
+
+static atomic_uint_fast64_t Coalesced = 0;
+static atomic_uint_fast64_t Reloaded = 0;
+
+static void _release(InFlightMiss* miss);
+
+void InFlight_Initialize(void)
+{
+    Vector_Construct(&Misses, sizeof(InFlightMiss*), NULL, 0);
+}
+
+InFlightMiss* InFlight_Begin(uint32_t tableId, uint16_t key, SelectResult* result, char* value)
+{
+    pthread_mutex_lock(&InFlightLock);
+
+    InFlightMiss* miss = NULL;
+    InFlightMiss** const misses = Vector_data(&Misses);
+    for (size_t i = 0; i < Vector_size(&Misses); ++i)
+    {
+        if (misses[i]->Key == key && misses[i]->TableId == tableId)
+        {
+            miss = misses[i];
+            break;
+        }
+    }
+
+    if (miss)
+    {
+        // ya hay alguien buscandola en el FS
+        ++miss->Refs;
+        while (!miss->Done)
+            pthread_cond_wait(&InFlightCond, &InFlightLock);
+
+        *result = miss->Result;
+        strcpy(value, miss->Value);
+        _release(miss);
+        pthread_mutex_unlock(&InFlightLock);
+
+        atomic_fetch_add_explicit(&Coalesced, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    // la cargo otro mientras este pedido esperaba un hilo del FS
+    if (Memory_PeekValue(tableId, key, value))
+    {
+        pthread_mutex_unlock(&InFlightLock);
+
+        *result = Ok;
+        atomic_fetch_add_explicit(&Reloaded, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    miss = Malloc(sizeof(InFlightMiss));
+    miss->TableId = tableId;
+    miss->Key = key;
+    miss->Refs = 1;
+    miss->Done = false;
+    miss->Value = NULL;
+    Vector_push_back(&Misses, &miss);
+
+    pthread_mutex_unlock(&InFlightLock);
+    return miss;
+}
+
+void InFlight_Complete(InFlightMiss* miss, SelectResult result, char const* value)
+{
+    uint32_t const maxValueLength = Memory_GetMaxValueLength();
+
+    pthread_mutex_lock(&InFlightLock);
+
+    // los pedidos nuevos ya no la esperan: la pagina esta en memoria (o el FS no la tiene)
+    InFlightMiss** const misses = Vector_data(&Misses);
+    for (size_t i = 0; i < Vector_size(&Misses); ++i)
+    {
+        if (misses[i] == miss)
+        {
+            Vector_erase(&Misses, i);
+            break;
+        }
+    }
+
+    miss->Result = result;
+    miss->Value = Malloc(maxValueLength + 1);
+    *miss->Value = '\0';
+    if (result == Ok || result == MemoryFull)
+        strncat(miss->Value, value, maxValueLength);
+
+    miss->Done = true;
+    pthread_cond_broadcast(&InFlightCond);
+
+    _release(miss);
+    pthread_mutex_unlock(&InFlightLock);
+}
+
+void InFlight_Report(void)
+{
+    LISSANDRA_LOG_INFO("FALLOS EN CURSO: %" PRIu64 " pedidos esperaron un SELECT al FS igual, %" PRIu64
+                       " encontraron la pagina ya cargada",
+                       (uint64_t) atomic_load_explicit(&Coalesced, memory_order_relaxed),
+                       (uint64_t) atomic_load_explicit(&Reloaded, memory_order_relaxed));
+}
+
+void InFlight_Destroy(void)
+{
+    // ya terminaron los hilos, no queda ninguna
+    Vector_Destruct(&Misses);
+}
+
+/* PRIVATE */
+static void _release(InFlightMiss* miss)
+{
+    if (--miss->Refs)
+        return;
+
+    Free(miss->Value);
+    Free(miss);
+}
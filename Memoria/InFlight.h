@@ -0,0 +1,31 @@
+
+#ifndef InFlight_h__
+#define InFlight_h__
+
+#include "API.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * SELECT al FS en curso. Cuando varios pedidos fallan en memoria sobre la misma clave solo el primero va al FS y
+ * carga la pagina, los demas esperan su resultado. Los que llegan despues de que termino (estaban en la cola de los
+ * hilos del FS) encuentran la pagina ya cargada.
+ */
+
+typedef struct InFlightMiss InFlightMiss;
+
+void InFlight_Initialize(void);
+
+// devuelve la entrada si el llamante tiene que ir al FS, y despues llamar a InFlight_Complete con el resultado
+// si no, NULL: el resultado (y el valor, con lugar para maxValueLength+1 bytes) ya esta en result y value
+InFlightMiss* InFlight_Begin(uint32_t tableId, uint16_t key, SelectResult* result, char* value);
+
+// publica el resultado del FS para los que esperan
+void InFlight_Complete(InFlightMiss* miss, SelectResult result, char const* value);
+
+// pedidos que se ahorraron ir al FS
+void InFlight_Report(void);
+
+void InFlight_Destroy(void);
+
+#endif //InFlight_h__
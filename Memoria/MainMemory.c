@@ -3,16 +3,27 @@
 #include "API.h"
 #include "Config.h"
 #include "PageTable.h"
+#include "Replacement.h"
 #include "SegmentTable.h"
+#include <assert.h>
 #include <libcommons/bitarray.h>
+#include <inttypes.h>
 #include <Logger.h>
 #include <Malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <Timer.h>
 
 // la memoria es un arreglo de marcos contiguos
 static Frame* Memory = NULL;
+
+// compartida: se leen y modifican paginas que ya estan, con el lock de su tabla de paginas
+// exclusiva: se asignan o liberan marcos y se crean o borran segmentos
+static pthread_rwlock_t MemoryLock = PTHREAD_RWLOCK_INITIALIZER;
 static uint32_t MaxValueLength = 0;
 static size_t FrameSize = 0;
 static size_t NumFrames = 0;
@@ -22,12 +33,22 @@ static uint8_t* FrameBitmap = NULL;
 static t_bitarray* FrameStatus = NULL;
 static bool Full = false; // valor cacheado para no tener que pasar por LRU de nuevo
 
+// pila de marcos libres, el bitmap queda para validar
+static size_t* FreeFrames = NULL;
+static size_t NumFreeFrames = 0;
+
+// se incrementa con la memoria exclusiva en cada DELETE o DROP
+static atomic_uint_fast64_t Epoch = 0;
+
 static void _cleanMemory(void);
-static PageTable* CreateNewPage(size_t frameNumber, char const* tableName, uint16_t key);
+static void _evictPage(uint32_t tableId, uint16_t key);
+static void _resetFreeFrames(void);
+static PageTable* CreateNewPage(size_t frameNumber, uint32_t tableId, uint16_t key);
 static void WriteFrame(size_t frameNumber, uint64_t timestamp, uint16_t key, char const* value);
-static bool GetFreeFrame(size_t* frame);
+static uint64_t _nextTimestamp(size_t frameNumber);
+static bool GetFreeFrame(uint32_t tableId, uint16_t key, size_t* frame);
 
-void Memory_Initialize(uint32_t maxValueLength, char const* mountPoint)
+void Memory_Initialize(uint32_t maxValueLength)
 {
     // malloc de n bytes contiguos
     size_t const allocSize = ConfigMemoria.TAM_MEM;
@@ -53,64 +74,185 @@ void Memory_Initialize(uint32_t maxValueLength, char const* mountPoint)
     FrameBitmap = Calloc(bitmapBytes, 1);
     FrameStatus = bitarray_create_with_mode(FrameBitmap, bitmapBytes, MSB_FIRST);
 
-    SegmentTable_Initialize(mountPoint);
+    FreeFrames = Malloc(NumFrames * sizeof(size_t));
+    _resetFreeFrames();
+
+    SegmentTable_Initialize();
+    Replacement_Initialize(ConfigMemoria.ALGORITMO_REEMPLAZO, NumFrames);
 
     char const* const frameString = NumFrames == 1 ? "marco" : "marcos";
     LISSANDRA_LOG_INFO("Memoria inicializada. Tamaño: %d bytes (%d %s). Tamaño de marco: %d", allocSize, NumFrames,
                        frameString, FrameSize);
 }
 
-bool Memory_InsertNewValue(char const* tableName, uint64_t timestamp, uint16_t key, char const* value)
+uint64_t Memory_GetEpoch(void)
+{
+    return atomic_load(&Epoch);
+}
+
+bool Memory_InsertNewValue(uint32_t tableId, uint64_t timestamp, uint16_t key, char const* value, uint64_t epoch)
 {
+    pthread_rwlock_wrlock(&MemoryLock);
+
+    // un DELETE o DROP se cruzo con el pedido al FS: el valor puede ser de antes, no lo cargo
+    if (atomic_load(&Epoch) != epoch)
+    {
+        pthread_rwlock_unlock(&MemoryLock);
+        return true;
+    }
+
+    // otro fallo (o un INSERT) ya la trajo mientras se consultaba al FS, la de memoria es igual o mas nueva
     size_t freeFrame;
-    if (!GetFreeFrame(&freeFrame))
-        return false;
+    PageTable* pt = SegmentTable_GetPageTable(tableId);
+    bool const present = pt && PageTable_GetFrameNumber(pt, key, &freeFrame);
 
-    CreateNewPage(freeFrame, tableName, key);
-    WriteFrame(freeFrame, timestamp, key, value);
-    return true;
+    bool const inserted = present || GetFreeFrame(tableId, key, &freeFrame);
+    if (!present && inserted)
+    {
+        CreateNewPage(freeFrame, tableId, key);
+        WriteFrame(freeFrame, timestamp, key, value);
+    }
+
+    pthread_rwlock_unlock(&MemoryLock);
+    return inserted;
 }
 
-bool Memory_UpsertValue(char const* tableName, uint16_t key, char const* value)
+bool Memory_UpsertValue(uint32_t tableId, uint16_t key, char const* value)
 {
-    PageTable* pt = SegmentTable_GetPageTable(tableName);
+    // la pagina ya esta: alcanza con la memoria compartida
+    pthread_rwlock_rdlock(&MemoryLock);
+
     size_t frame;
-    if (!pt || !PageTable_GetFrameNumber(pt, key, &frame))
+    PageTable* pt = SegmentTable_GetPageTable(tableId);
+    if (pt)
+    {
+        pthread_mutex_lock(&pt->Lock);
+        bool const present = PageTable_GetFrameNumber(pt, key, &frame);
+        if (present)
+        {
+            WriteFrame(frame, _nextTimestamp(frame), key, value);
+            PageTable_MarkDirty(pt, key);
+        }
+        pthread_mutex_unlock(&pt->Lock);
+
+        if (present)
+        {
+            pthread_rwlock_unlock(&MemoryLock);
+            LISSANDRA_LOG_TRACE("Memoria: marcada page %hu como modificada. (Frame: %zu)", key, frame);
+            return true;
+        }
+    }
+
+    pthread_rwlock_unlock(&MemoryLock);
+
+    // pagina nueva, aunque otro hilo pudo haberla creado entretanto
+    pthread_rwlock_wrlock(&MemoryLock);
+
+    pt = SegmentTable_GetPageTable(tableId);
+    bool const present = pt && PageTable_GetFrameNumber(pt, key, &frame);
+    if (!present)
     {
-        if (!GetFreeFrame(&frame))
+        if (!GetFreeFrame(tableId, key, &frame))
+        {
+            pthread_rwlock_unlock(&MemoryLock);
             return false;
+        }
 
-        pt = CreateNewPage(frame, tableName, key);
+        pt = CreateNewPage(frame, tableId, key);
     }
 
-    WriteFrame(frame, GetMSEpoch(), key, value);
+    WriteFrame(frame, present ? _nextTimestamp(frame) : GetMSEpoch(), key, value);
     PageTable_MarkDirty(pt, key);
 
-    LISSANDRA_LOG_TRACE("Memoria: marcada page %hu como modificada. (Frame: %u)", key, frame);
+    pthread_rwlock_unlock(&MemoryLock);
+
+    LISSANDRA_LOG_TRACE("Memoria: marcada page %hu como modificada. (Frame: %zu)", key, frame);
     return true;
 }
 
 void Memory_CleanFrame(size_t frameNumber)
 {
+    if (!bitarray_test_bit(FrameStatus, frameNumber))
+        return;
+
     bitarray_clean_bit(FrameStatus, frameNumber);
+    FreeFrames[NumFreeFrames++] = frameNumber;
 }
 
-void Memory_EvictPages(char const* tableName)
+void Memory_EvictPages(uint32_t tableId)
 {
-    SegmentTable_DeleteSegment(tableName);
+    pthread_rwlock_wrlock(&MemoryLock);
+    atomic_fetch_add(&Epoch, 1);
+    SegmentTable_DeleteSegment(tableId);
+    pthread_rwlock_unlock(&MemoryLock);
 }
 
-Frame* Memory_GetFrame(char const* tableName, uint16_t key)
+void Memory_EvictPage(uint32_t tableId, uint16_t key)
 {
-    PageTable* pt = SegmentTable_GetPageTable(tableName);
-    if (!pt)
-        return NULL;
+    pthread_rwlock_wrlock(&MemoryLock);
+    atomic_fetch_add(&Epoch, 1);
+    _evictPage(tableId, key);
+    pthread_rwlock_unlock(&MemoryLock);
+}
+
+void Memory_InvalidatePage(uint32_t tableId, uint16_t key)
+{
+    pthread_rwlock_wrlock(&MemoryLock);
+    atomic_fetch_add(&Epoch, 1);
+
+    PageTable* pt = SegmentTable_GetPageTable(tableId);
+    if (pt && !PageTable_IsDirty(pt, key))
+        _evictPage(tableId, key);
+
+    pthread_rwlock_unlock(&MemoryLock);
+}
+
+bool Memory_GetValue(uint32_t tableId, uint16_t key, char* value)
+{
+    bool const hit = Memory_PeekValue(tableId, key, value);
+    Replacement_RecordLookup(hit);
+    return hit;
+}
+
+bool Memory_PeekValue(uint32_t tableId, uint16_t key, char* value)
+{
+    pthread_rwlock_rdlock(&MemoryLock);
 
     size_t frame;
-    if (!PageTable_GetFrameNumber(pt, key, &frame))
-        return NULL;
+    bool hit = false;
+    PageTable* pt = SegmentTable_GetPageTable(tableId);
+    if (pt)
+    {
+        pthread_mutex_lock(&pt->Lock);
+        hit = PageTable_GetFrameNumber(pt, key, &frame);
+        if (hit)
+        {
+            *value = '\0';
+            strncat(value, Memory_Read(frame)->Value, MaxValueLength);
+        }
+        pthread_mutex_unlock(&pt->Lock);
+    }
+
+    pthread_rwlock_unlock(&MemoryLock);
+    return hit;
+}
 
-    return Memory_Read(frame);
+uint32_t Memory_GetTableId(char const* tableName)
+{
+    return SegmentTable_GetTableId(tableName);
+}
+
+uint32_t Memory_FindTableId(char const* tableName)
+{
+    uint32_t tableId;
+    if (!SegmentTable_FindTableId(tableName, &tableId))
+        return MEMORY_NO_TABLE;
+    return tableId;
+}
+
+char const* Memory_GetTableName(uint32_t tableId)
+{
+    return SegmentTable_GetTableName(tableId);
 }
 
 uint32_t Memory_GetMaxValueLength(void)
@@ -123,24 +265,126 @@ Frame* Memory_Read(size_t frameNumber)
     return (Frame*) ((uint8_t*) Memory + frameNumber * FrameSize);
 }
 
-void Memory_DoJournal(void(*insertFn)(void*))
+void Memory_DoJournal(JournalWriteFn* writeFn)
+{
+    // las modificadas quedan limpias en memoria (y las de tablas que ya no existen se desalojan)
+    size_t const pages = Memory_WriteBack(SIZE_MAX, writeFn);
+    pthread_rwlock_wrlock(&MemoryLock);
+    if (ConfigMemoria.MODO_JOURNAL == JOURNAL_CONSERVAR)
+    {
+        LISSANDRA_LOG_DEBUG("JOURNAL: %zu paginas procesadas, %zu marcos siguen en memoria", pages,
+                            NumFrames - NumFreeFrames);
+        pthread_rwlock_unlock(&MemoryLock);
+        return;
+    }
+
+    // limpiar memoria, salvo las paginas que se modificaron mientras se enviaba el journal o no llegaron al FS
+    if (!PageTable_HasDirtyPages())
+        _cleanMemory();
+    else
+    {
+        size_t frame;
+        while (SegmentTable_GetVictimFrame(&frame))
+            continue;
+    }
+
+    pthread_rwlock_unlock(&MemoryLock);
+}
+
+static void _freeDirtyFrame(void* dirtyFrame)
+{
+    DirtyFrame* const df = dirtyFrame;
+    Free((void*) df->Frame);
+}
+
+size_t Memory_WriteBack(size_t maxPages, JournalWriteFn* writeFn)
 {
     Vector v;
-    Vector_Construct(&v, sizeof(DirtyFrame), NULL, 0);
-    SegmentTable_GetDirtyFrames(&v);
+    Vector_Construct(&v, sizeof(DirtyFrame), _freeDirtyFrame, 0);
+
+    // copio las paginas y las bajo al FS sin la memoria tomada, asi se siguen atendiendo pedidos
+    pthread_rwlock_wrlock(&MemoryLock);
+    PageTable_GetOldestDirtyFrames(maxPages, &v);
+
+    size_t const pages = Vector_size(&v);
+    DirtyFrame* const dirtyFrames = Vector_data(&v);
+    for (size_t i = 0; i < pages; ++i)
+    {
+        Frame* const copy = Malloc(FrameSize);
+        memcpy(copy, dirtyFrames[i].Frame, FrameSize);
+        dirtyFrames[i].Frame = copy;
+    }
+
+    pthread_rwlock_unlock(&MemoryLock);
+
+    if (!pages)
+    {
+        Vector_Destruct(&v);
+        return 0;
+    }
+
+    writeFn(&v);
+
+    // las que se volvieron a modificar mientras tanto siguen modificadas (o en memoria si la tabla no existe)
+    pthread_rwlock_wrlock(&MemoryLock);
+
+    size_t written = 0;
+    size_t dropped = 0;
+    size_t pending = 0;
+    for (size_t i = 0; i < pages; ++i)
+    {
+        DirtyFrame const* const df = dirtyFrames + i;
+        uint16_t const key = df->Frame->Key;
+
+        PageTable* const pt = SegmentTable_GetPageTable(df->TableId);
+        if (!pt || !PageTable_HasVersion(pt, key, df->Version))
+            continue;
+
+        switch (df->Result)
+        {
+            case WriteOk:
+                PageTable_MarkClean(pt, key, df->Version);
+                ++written;
+                break;
+            case WriteNoTable:
+                _evictPage(df->TableId, key);
+                ++dropped;
+                break;
+            default:
+                ++pending;
+                break;
+        }
+    }
 
-    Vector_iterate(&v, insertFn);
+    // hay paginas para desalojar (o marcos libres)
+    Full = false;
 
-    // limpiar memoria
-    _cleanMemory();
+    pthread_rwlock_unlock(&MemoryLock);
 
     Vector_Destruct(&v);
+
+    if (written)
+        LISSANDRA_LOG_DEBUG("WRITEBACK: %zu paginas modificadas bajadas al FS", written);
+
+    if (pending)
+        LISSANDRA_LOG_ERROR("WRITEBACK: %zu paginas no llegaron al FS, siguen modificadas", pending);
+
+    return written + dropped;
+}
+
+void Memory_Report(void)
+{
+    Replacement_Report();
 }
 
 void Memory_Destroy(void)
 {
+    Replacement_Report();
+
     SegmentTable_Destroy();
+    Replacement_Destroy();
     bitarray_destroy(FrameStatus);
+    Free(FreeFrames);
     Free(FrameBitmap);
     Free(Memory);
 }
@@ -148,18 +392,42 @@ void Memory_Destroy(void)
 /* PRIVATE */
 static void _cleanMemory(void)
 {
-    memset(FrameBitmap, 0, bitarray_get_max_bit(FrameStatus) / 8);
     SegmentTable_Clean();
+    memset(FrameBitmap, 0, bitarray_get_max_bit(FrameStatus) / 8);
+    _resetFreeFrames();
     Full = false;
 
     LISSANDRA_LOG_TRACE("Memoria: limpiadas estructuras");
 }
 
-static PageTable* CreateNewPage(size_t frameNumber, char const* tableName, uint16_t key)
+static void _evictPage(uint32_t tableId, uint16_t key)
+{
+    PageTable* pt = SegmentTable_GetPageTable(tableId);
+    if (!pt)
+        return;
+
+    // era la ultima pagina de este segmento, borrarlo
+    if (PageTable_PreemptPage(pt, key))
+        SegmentTable_DeleteSegment(tableId);
+
+    // se libero un marco
+    Full = false;
+}
+
+static void _resetFreeFrames(void)
+{
+    // al reves, asi se asignan desde el marco 0
+    for (size_t i = 0; i < NumFrames; ++i)
+        FreeFrames[i] = NumFrames - 1 - i;
+
+    NumFreeFrames = NumFrames;
+}
+
+static PageTable* CreateNewPage(size_t frameNumber, uint32_t tableId, uint16_t key)
 {
-    PageTable* pt = SegmentTable_GetPageTable(tableName);
+    PageTable* pt = SegmentTable_GetPageTable(tableId);
     if (!pt)
-        pt = SegmentTable_CreateSegment(tableName);
+        pt = SegmentTable_CreateSegment(tableId);
 
     PageTable_AddPage(pt, key, frameNumber);
     return pt;
@@ -177,23 +445,31 @@ static void WriteFrame(size_t frameNumber, uint64_t timestamp, uint16_t key, cha
                                 ", key: %hu, value: '%s'", (void*) f, frameNumber, timestamp, key, value);
 }
 
-static bool GetFreeFrame(size_t* frame)
+static uint64_t _nextTimestamp(size_t frameNumber)
 {
-    if (Full)
+    // el FS se queda con el timestamp mayor: dos INSERT de la clave en el mismo milisegundo tienen que avanzarlo
+    // igual, si no el FS puede devolver el anterior despues de un write-back de cada uno
+    uint64_t const now = GetMSEpoch();
+    uint64_t const last = Memory_Read(frameNumber)->Timestamp;
+    return now > last ? now : last + 1;
+}
+
+static bool GetFreeFrame(uint32_t tableId, uint16_t key, size_t* frame)
+{
+    // un DROP pudo haber liberado marcos aunque no haya ninguna pagina para desalojar
+    if (Full && !NumFreeFrames)
         return false;
 
-    size_t i = 0;
-    for (; i < NumFrames; ++i)
-        if (!bitarray_test_bit(FrameStatus, i))
-            break;
+    // la politica puede recordar a la pagina de un desalojo anterior
+    Replacement_Admit(tableId, key);
 
-    if (i == NumFrames)
+    if (!NumFreeFrames)
     {
-        LISSANDRA_LOG_TRACE("Memoria: no hay marcos libres, iniciando LRU");
+        LISSANDRA_LOG_TRACE("Memoria: no hay marcos libres, iniciando reemplazo");
 
-        // no encontre ninguno libre, desalojar el LRU
+        // no hay ninguno libre, desalojar segun la politica: su marco vuelve a la pila
         size_t freeFrame;
-        if (!SegmentTable_GetLRUFrame(&freeFrame))
+        if (!SegmentTable_GetVictimFrame(&freeFrame))
         {
             LISSANDRA_LOG_TRACE("Memoria: estado FULL");
             Full = true;
@@ -201,10 +477,11 @@ static bool GetFreeFrame(size_t* frame)
         }
 
         LISSANDRA_LOG_TRACE("Memoria: desalojado marco %u", freeFrame);
-        i = freeFrame;
     }
-    else
-        LISSANDRA_LOG_TRACE("Memoria: asignado marco %u", i);
+
+    size_t const i = FreeFrames[--NumFreeFrames];
+    assert(!bitarray_test_bit(FrameStatus, i));
+    LISSANDRA_LOG_TRACE("Memoria: asignado marco %u", i);
 
     bitarray_set_bit(FrameStatus, i);
     *frame = i;
@@ -5,24 +5,63 @@
 #include "Frame.h"
 #include <stdbool.h>
 #include <stdint.h>
+#include <vector.h>
 
-void Memory_Initialize(uint32_t maxValueLength, char const* mountPoint);
+void Memory_Initialize(uint32_t maxValueLength);
 
-bool Memory_InsertNewValue(char const* tableName, uint64_t timestamp, uint16_t key, char const* value);
+// las paginas se buscan por el id de su tabla, que se asigna la primera vez que se la nombra
+// llamar solo con tablas que confirmo el FS o para escribir en ellas, los ids no se liberan
+uint32_t Memory_GetTableId(char const* tableName);
 
-bool Memory_UpsertValue(char const* tableName, uint16_t key, char const* value);
+// tabla que todavia no tiene id: no tiene paginas en memoria
+#define MEMORY_NO_TABLE UINT32_MAX
+
+// id de la tabla sin asignarle uno, MEMORY_NO_TABLE si no tiene
+uint32_t Memory_FindTableId(char const* tableName);
+
+char const* Memory_GetTableName(uint32_t tableId);
+
+// cuenta los DELETE y DROP, tomarla antes de pedir un valor al FS
+uint64_t Memory_GetEpoch(void);
+
+// carga un valor traido del FS. Si hubo un DELETE o DROP desde epoch no se carga (el valor puede ser anterior),
+// pero devuelve true igual: solo es false si no hay marcos
+bool Memory_InsertNewValue(uint32_t tableId, uint64_t timestamp, uint16_t key, char const* value, uint64_t epoch);
+
+bool Memory_UpsertValue(uint32_t tableId, uint16_t key, char const* value);
 
 void Memory_CleanFrame(size_t frameNumber);
 
-void Memory_EvictPages(char const* tableName);
+void Memory_EvictPages(uint32_t tableId);
+
+void Memory_EvictPage(uint32_t tableId, uint16_t key);
 
-Frame* Memory_GetFrame(char const* tableName, uint16_t key);
+// desaloja la pagina solo si esta limpia, las modificadas son INSERT que llegaron despues
+void Memory_InvalidatePage(uint32_t tableId, uint16_t key);
+
+// copia el valor de la pagina si esta en memoria, value con lugar para (maxValueLength+1) bytes
+bool Memory_GetValue(uint32_t tableId, uint16_t key, char* value);
+
+// igual pero sin contarlo como acierto o fallo, para volver a mirar despues de un fallo ya contado
+bool Memory_PeekValue(uint32_t tableId, uint16_t key, char* value);
 
 uint32_t Memory_GetMaxValueLength(void);
 
 Frame* Memory_Read(size_t frameNumber);
 
-void Memory_DoJournal(void(*insertFn)(void*));
+// baja al FS todas las paginas del vector y completa el resultado de cada una
+typedef void JournalWriteFn(Vector* dirtyFrames);
+
+// segun MODO_JOURNAL despues se vacia la memoria o se conservan las paginas, ya limpias
+void Memory_DoJournal(JournalWriteFn* writeFn);
+
+// baja al FS hasta maxPages paginas modificadas, de la mas vieja a la mas nueva, y las deja limpias en memoria
+// las de tablas que ya no existen se desalojan y las que no llegaron al FS siguen modificadas
+// devuelve cuantas dejaron de estar modificadas
+size_t Memory_WriteBack(size_t maxPages, JournalWriteFn* writeFn);
+
+// estadisticas del reemplazo de paginas
+void Memory_Report(void);
 
 void Memory_Destroy(void);
 
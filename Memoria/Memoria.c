@@ -2,9 +2,11 @@
 #include "API.h"
 #include "Config.h"
 #include "CLIHandlers.h"
-#include "FileSystemSocket.h"
+#include "FileSystemPool.h"
 #include "Gossip.h"
+#include "InFlight.h"
 #include "MainMemory.h"
+#include "Workers.h"
 #include <Appender.h>
 #include <AppenderConsole.h>
 #include <AppenderFile.h>
@@ -19,6 +21,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <Timer.h>
 
 CLICommand const CLICommands[] =
@@ -28,7 +31,9 @@ CLICommand const CLICommands[] =
     { "CREATE",   HandleCreate   },
     { "DESCRIBE", HandleDescribe },
     { "DROP",     HandleDrop     },
+    { "DELETE",   HandleDelete   },
     { "JOURNAL",  HandleJournal  },
+    { "STATS",    HandleStats    },
     { NULL,       NULL           }
 };
 
@@ -49,8 +54,7 @@ static Socket* ListeningSocket = NULL;
 
 static PeriodicTimer* JournalTimer = NULL;
 static PeriodicTimer* GossipTimer = NULL;
-
-Socket* FileSystemSocket = NULL;
+static PeriodicTimer* WriteBackTimer = NULL;
 
 static void IniciarLogger(void)
 {
@@ -77,6 +81,28 @@ static void _loadReloadableFields(t_config const* config)
     ConfigMemoria.RETARDO_FS = config_get_long_value(config, "RETARDO_FS");
     ConfigMemoria.RETARDO_JOURNAL = config_get_long_value(config, "RETARDO_JOURNAL");
     ConfigMemoria.RETARDO_GOSSIPING = config_get_long_value(config, "RETARDO_GOSSIPING");
+
+    ConfigMemoria.RETARDO_WRITEBACK = 0;
+    if (config_has_property(config, "RETARDO_WRITEBACK"))
+        ConfigMemoria.RETARDO_WRITEBACK = config_get_long_value(config, "RETARDO_WRITEBACK");
+
+    ConfigMemoria.LOTE_WRITEBACK = 16;
+    if (config_has_property(config, "LOTE_WRITEBACK"))
+        ConfigMemoria.LOTE_WRITEBACK = config_get_long_value(config, "LOTE_WRITEBACK");
+
+    ConfigMemoria.MODO_JOURNAL = JOURNAL_VACIAR;
+    if (config_has_property(config, "MODO_JOURNAL"))
+    {
+        char const* const modo = config_get_string_value(config, "MODO_JOURNAL");
+        if (!strcmp(modo, "CONSERVAR"))
+            ConfigMemoria.MODO_JOURNAL = JOURNAL_CONSERVAR;
+        else if (strcmp(modo, "VACIAR") != 0)
+            LISSANDRA_LOG_ERROR("MODO_JOURNAL invalido: %s (VACIAR o CONSERVAR), se vacia la memoria", modo);
+    }
+
+    ConfigMemoria.VENTANA_JOURNAL = 8;
+    if (config_has_property(config, "VENTANA_JOURNAL"))
+        ConfigMemoria.VENTANA_JOURNAL = config_get_long_value(config, "VENTANA_JOURNAL");
 }
 
 static void _reLoadConfig(char const* fileName)
@@ -96,6 +122,20 @@ static void _reLoadConfig(char const* fileName)
     // recargar los timers
     PeriodicTimer_ReSetTimer(JournalTimer, ConfigMemoria.RETARDO_JOURNAL);
     PeriodicTimer_ReSetTimer(GossipTimer, ConfigMemoria.RETARDO_GOSSIPING);
+    PeriodicTimer_ReSetTimer(WriteBackTimer, ConfigMemoria.RETARDO_WRITEBACK);
+}
+
+// bajar paginas al FS no puede frenar al dispatcher
+static void _journalTimer(PeriodicTimer* pt)
+{
+    (void) pt;
+    Workers_AddTask(API_Journal);
+}
+
+static void _writeBackTimer(PeriodicTimer* pt)
+{
+    (void) pt;
+    Workers_AddTask(API_WriteBack);
 }
 
 static void SetupConfigInitial(char const* fileName)
@@ -117,6 +157,23 @@ static void SetupConfigInitial(char const* fileName)
     ConfigMemoria.TAM_MEM = config_get_long_value(config, "TAM_MEM");
     ConfigMemoria.MEMORY_NUMBER = config_get_long_value(config, "MEMORY_NUMBER");
 
+    snprintf(ConfigMemoria.ALGORITMO_REEMPLAZO, sizeof ConfigMemoria.ALGORITMO_REEMPLAZO, "%s", "LRU");
+    if (config_has_property(config, "ALGORITMO_REEMPLAZO"))
+        snprintf(ConfigMemoria.ALGORITMO_REEMPLAZO, sizeof ConfigMemoria.ALGORITMO_REEMPLAZO, "%s",
+                 config_get_string_value(config, "ALGORITMO_REEMPLAZO"));
+
+    ConfigMemoria.HILOS_MEMORIA = 2;
+    if (config_has_property(config, "HILOS_MEMORIA"))
+        ConfigMemoria.HILOS_MEMORIA = config_get_long_value(config, "HILOS_MEMORIA");
+
+    ConfigMemoria.HILOS_FS = 4;
+    if (config_has_property(config, "HILOS_FS"))
+        ConfigMemoria.HILOS_FS = config_get_long_value(config, "HILOS_FS");
+
+    ConfigMemoria.CONEXIONES_FS = ConfigMemoria.HILOS_FS;
+    if (config_has_property(config, "CONEXIONES_FS"))
+        ConfigMemoria.CONEXIONES_FS = config_get_long_value(config, "CONEXIONES_FS");
+
     _loadReloadableFields(config);
 
     config_destroy(config);
@@ -127,11 +184,14 @@ static void SetupConfigInitial(char const* fileName)
     EventDispatcher_AddFDI(fw);
 
     // timers
-    JournalTimer = PeriodicTimer_Create(ConfigMemoria.RETARDO_JOURNAL, API_Journal);
+    JournalTimer = PeriodicTimer_Create(ConfigMemoria.RETARDO_JOURNAL, _journalTimer);
     EventDispatcher_AddFDI(JournalTimer);
 
     GossipTimer = PeriodicTimer_Create(ConfigMemoria.RETARDO_GOSSIPING, Gossip_Do);
     EventDispatcher_AddFDI(GossipTimer);
+
+    WriteBackTimer = PeriodicTimer_Create(ConfigMemoria.RETARDO_WRITEBACK, _writeBackTimer);
+    EventDispatcher_AddFDI(WriteBackTimer);
 }
 
 static void MainLoop(void)
@@ -146,54 +206,30 @@ static void MainLoop(void)
     pthread_join(consoleTid, NULL);
 }
 
-static void DoHandshake(uint32_t* maxValueLength, char** mountPoint)
+// los pedidos de los clientes se atienden en los hilos de Workers
+static void _acceptClient(Socket* listener, Socket* client)
 {
-    SocketOpts const so =
-    {
-        .HostName = ConfigMemoria.IP_FS,
-        .ServiceOrPort = ConfigMemoria.PUERTO_FS,
-        .SocketMode = SOCKET_CLIENT,
-        .SocketOnAcceptClient = NULL
-    };
-    FileSystemSocket = Socket_Create(&so);
-    if (!FileSystemSocket)
-    {
-        LISSANDRA_LOG_FATAL("No pude conectarme al FileSystem!!");
-        exit(1);
-    }
-
-    static uint8_t const id = MEMORIA;
-    Packet* p = Packet_Create(MSG_HANDSHAKE, 1);
-    Packet_Append(p, id);
-    Socket_SendPacket(FileSystemSocket, p);
-    Packet_Destroy(p);
+    (void) listener;
 
-    p = Socket_RecvPacket(FileSystemSocket);
-    if (!p || Packet_GetOpcode(p) != MSG_HANDSHAKE_RESPUESTA)
-    {
-        LISSANDRA_LOG_FATAL("FileSystem envió respuesta inválida.");
-        exit(1);
-    }
-
-    Packet_Read(p, maxValueLength);
-    Packet_Read(p, mountPoint);
-    Packet_Destroy(p);
+    client->_impl.ReadCallback = Workers_ReadRequest;
+    EventDispatcher_AddFDI(client);
 }
 
 static void StartMemory(void)
 {
     uint32_t maxValueLength;
-    char* mountPoint;
-    DoHandshake(&maxValueLength, &mountPoint);
-    Memory_Initialize(maxValueLength, mountPoint);
-    Free(mountPoint);
+    FileSystemPool_Initialize(&maxValueLength);
+    Memory_Initialize(maxValueLength);
+
+    InFlight_Initialize();
+    Workers_Initialize();
 
     SocketOpts const so =
     {
         .HostName = NULL,
         .ServiceOrPort = ConfigMemoria.PUERTO,
         .SocketMode = SOCKET_SERVER,
-        .SocketOnAcceptClient = NULL
+        .SocketOnAcceptClient = _acceptClient
     };
     ListeningSocket = Socket_Create(&so);
 
@@ -212,7 +248,10 @@ static void Cleanup(void)
     Vector_Destruct(&ConfigMemoria.PUERTO_SEEDS);
 
     Gossip_Terminate();
+    Workers_Terminate();
+    InFlight_Destroy();
     Memory_Destroy();
+    FileSystemPool_Destroy();
     EventDispatcher_Terminate();
     Logger_Terminate();
 }
@@ -1,81 +1,105 @@
-
 #include "PageTable.h"
 #include "MainMemory.h"
+#include "Replacement.h"
 #include <Malloc.h>
+#include <stdatomic.h>
 
-// contador de uso, común a todas las tablas de página
-static size_t MonotonicCounter = 0;
-
-typedef struct
+typedef struct Page
 {
-    size_t Counter;
     size_t Frame;
     bool Dirty;
+    uint64_t Version;
+
+    // para desalojarla sin buscarla
+    PageTable* Owner;
+
+    // politica de reemplazo, solo mientras esta limpia (las modificadas no se pueden desalojar)
+    ReplacementNode Node;
+
+    // lista de modificadas, solo mientras esta modificada
+    struct Page* DirtyPrev;
+    struct Page* DirtyNext;
 } Page;
 
-typedef struct
+// paginas modificadas, común a todas las tablas de página: la cabeza es la modificada hace mas tiempo
+static Page* DirtyHead = NULL;
+static Page* DirtyTail = NULL;
+static pthread_mutex_t DirtyLock = PTHREAD_MUTEX_INITIALIZER;
+
+// versiones unicas entre todas las paginas: una pagina desalojada y vuelta a crear nunca repite una version, asi
+// la copia de un write back en curso no se confunde con ella
+static atomic_uint_fast64_t Generation = 0;
+
+static void _cleanPage(void* page);
+
+static inline uint64_t _nextVersion(void)
 {
-    size_t* minCounter;
-    Page** minPage;
-}  SLRUPageParameters;
-static void _saveLRUPage(int key, void* page, void* param);
+    return atomic_fetch_add_explicit(&Generation, 1, memory_order_relaxed) + 1;
+}
 
-typedef struct
+static inline void _dirtyUnlink(Page* p)
 {
-    char const* tableName;
-    Vector* dirtyFrames;
-} GDFrameParameters;
-static void _addDirtyFrame(int key, void* page, void* param);
+    if (p->DirtyPrev)
+        p->DirtyPrev->DirtyNext = p->DirtyNext;
+    else
+        DirtyHead = p->DirtyNext;
 
-static void _cleanPage(void* page);
+    if (p->DirtyNext)
+        p->DirtyNext->DirtyPrev = p->DirtyPrev;
+    else
+        DirtyTail = p->DirtyPrev;
+
+    p->DirtyPrev = p->DirtyNext = NULL;
+}
 
-void PageTable_Construct(PageTable* pt)
+static inline void _dirtyPushBack(Page* p)
 {
+    p->DirtyPrev = DirtyTail;
+    p->DirtyNext = NULL;
+
+    if (DirtyTail)
+        DirtyTail->DirtyNext = p;
+    else
+        DirtyHead = p;
+
+    DirtyTail = p;
+}
+
+void PageTable_Construct(PageTable* pt, uint32_t tableId)
+{
+    pt->TableId = tableId;
+    pthread_mutex_init(&pt->Lock, NULL);
     pt->Pages = hashmap_create();
 }
 
 void PageTable_AddPage(PageTable* pt, uint16_t key, size_t frame)
 {
     Page* p = Malloc(sizeof(Page));
-    p->Counter = ++MonotonicCounter;
     p->Frame = frame;
     p->Dirty = false;
+    p->Version = _nextVersion();
+    p->Owner = pt;
+    p->Node.TableId = pt->TableId;
+    p->Node.Key = key;
+    p->DirtyPrev = p->DirtyNext = NULL;
+    Replacement_Insert(&p->Node);
 
     hashmap_put(pt->Pages, key, p);
 }
 
-bool PageTable_GetLRUFrame(PageTable const* pt, size_t* frame, size_t* timestamp)
+bool PageTable_GetVictimPage(PageTable** pt, uint16_t* key, size_t* frame)
 {
-    size_t minCounter = 0;
-    Page* minPage = NULL;
-
-    SLRUPageParameters p =
-    {
-        .minCounter = &minCounter,
-        .minPage = &minPage
-    };
-    hashmap_iterate_with_data(pt->Pages, _saveLRUPage, &p);
-
-    if (!minPage)
+    ReplacementNode* const node = Replacement_Victim();
+    if (!node)
         return false;
 
-    *timestamp = minPage->Counter;
-    *frame = minPage->Frame;
-
+    Page* const p = REPLACEMENT_CONTAINER(node, Page, Node);
+    *pt = p->Owner;
+    *key = node->Key;
+    *frame = p->Frame;
     return true;
 }
 
-void PageTable_GetDirtyFrames(PageTable const* pt, char const* tableName, Vector* dirtyFrames)
-{
-    GDFrameParameters p =
-    {
-        .tableName = tableName,
-        .dirtyFrames = dirtyFrames
-    };
-
-    hashmap_iterate_with_data(pt->Pages, _addDirtyFrame, &p);
-}
-
 bool PageTable_PreemptPage(PageTable* pt, uint16_t key)
 {
     hashmap_remove_and_destroy(pt->Pages, key, _cleanPage);
@@ -88,63 +112,108 @@ bool PageTable_GetFrameNumber(PageTable const* pt, uint16_t key, size_t* page)
     if (!p)
         return false;
 
-    // increment last used
-    p->Counter = ++MonotonicCounter;
+    Replacement_Access(&p->Node);
+
     *page = p->Frame;
     return true;
 }
 
+bool PageTable_IsDirty(PageTable const* pt, uint16_t key)
+{
+    Page* p = hashmap_get(pt->Pages, key);
+    return p && p->Dirty;
+}
+
 void PageTable_MarkDirty(PageTable const* pt, uint16_t key)
 {
     Page* p = hashmap_get(pt->Pages, key);
     if (!p)
         return;
 
-    p->Dirty = true;
-}
+    p->Version = _nextVersion();
+    if (p->Dirty)
+        return;
 
-void PageTable_Destruct(PageTable* pt)
-{
-    hashmap_destroy_and_destroy_elements(pt->Pages, _cleanPage);
+    // modificada: sale de la politica hasta que se baje al FS
+    Replacement_Remove(&p->Node);
+
+    pthread_mutex_lock(&DirtyLock);
+    _dirtyPushBack(p);
+    pthread_mutex_unlock(&DirtyLock);
+
+    p->Dirty = true;
 }
 
-/* PRIVATE */
-static void _saveLRUPage(int key, void* page, void* param)
+void PageTable_GetOldestDirtyFrames(size_t maxPages, Vector* dirtyFrames)
 {
-    (void) key;
-
-    Page* const p = page;
+    pthread_mutex_lock(&DirtyLock);
 
-    SLRUPageParameters* const data = param;
-    if (!p->Dirty && (!*data->minPage || p->Counter < *data->minCounter))
+    size_t i = 0;
+    for (Page* p = DirtyHead; p && i < maxPages; p = p->DirtyNext, ++i)
     {
-        *data->minCounter = p->Counter;
-        *data->minPage = p;
+        DirtyFrame df =
+        {
+            .TableId = p->Owner->TableId,
+            .Frame = Memory_Read(p->Frame),
+            .Version = p->Version,
+            .Result = WritePending
+        };
+
+        Vector_push_back(dirtyFrames, &df);
     }
+
+    pthread_mutex_unlock(&DirtyLock);
 }
 
-static void _addDirtyFrame(int key, void* page, void* param)
+bool PageTable_HasVersion(PageTable const* pt, uint16_t key, uint64_t version)
 {
-    (void) key;
+    Page* p = hashmap_get(pt->Pages, key);
+    return p && p->Dirty && p->Version == version;
+}
 
-    Page* const p = page;
-    if (!p->Dirty)
+void PageTable_MarkClean(PageTable const* pt, uint16_t key, uint64_t version)
+{
+    if (!PageTable_HasVersion(pt, key, version))
         return;
 
-    Frame* f = Memory_Read(p->Frame);
-    GDFrameParameters* const data = param;
-    DirtyFrame df =
-    {
-        .TableName = data->tableName,
-        .Frame = f
-    };
+    // ya esta en el FS: vuelve a la politica y se puede desalojar
+    Page* p = hashmap_get(pt->Pages, key);
+
+    pthread_mutex_lock(&DirtyLock);
+    _dirtyUnlink(p);
+    pthread_mutex_unlock(&DirtyLock);
+
+    p->Dirty = false;
+    Replacement_Insert(&p->Node);
+}
+
+bool PageTable_HasDirtyPages(void)
+{
+    pthread_mutex_lock(&DirtyLock);
+    bool const dirty = DirtyHead != NULL;
+    pthread_mutex_unlock(&DirtyLock);
+    return dirty;
+}
 
-    Vector_push_back(data->dirtyFrames, &df);
+void PageTable_Destruct(PageTable* pt)
+{
+    hashmap_destroy_and_destroy_elements(pt->Pages, _cleanPage);
+    pthread_mutex_destroy(&pt->Lock);
 }
 
+/* PRIVATE */
 static void _cleanPage(void* page)
 {
     Page* const p = page;
+    if (p->Dirty)
+    {
+        pthread_mutex_lock(&DirtyLock);
+        _dirtyUnlink(p);
+        pthread_mutex_unlock(&DirtyLock);
+    }
+    else
+        Replacement_Remove(&p->Node);
+
     Memory_CleanFrame(p->Frame);
     Free(p);
 }
@@ -2,26 +2,47 @@
 #ifndef PageTable_h__
 #define PageTable_h__
 
-#include <stdint.h>
 #include <libcommons/hashmap.h>
+#include <pthread.h>
+#include <stdint.h>
 
+/*
+ * Las paginas se agregan y se quitan solo con la memoria tomada en forma exclusiva (MainMemory). Con la memoria
+ * compartida, Lock protege el contenido de los marcos de la tabla y el estado de sus paginas.
+ */
 typedef struct
 {
+    uint32_t TableId;
+
+    pthread_mutex_t Lock;
     t_hashmap* Pages;
 } PageTable;
 
-void PageTable_Construct(PageTable* pt);
+void PageTable_Construct(PageTable* pt, uint32_t tableId);
 
 void PageTable_AddPage(PageTable* pt, uint16_t key, size_t frame);
 
-bool PageTable_GetLRUFrame(PageTable const* pt, size_t* frame, size_t* timestamp);
-
-void PageTable_GetDirtyFrames(PageTable const* pt, char const* tableName, Vector* dirtyFrames);
+// la pagina limpia a desalojar entre todas las tablas de pagina segun la politica de reemplazo
+bool PageTable_GetVictimPage(PageTable** pt, uint16_t* key, size_t* frame);
 
 bool PageTable_GetFrameNumber(PageTable const* pt, uint16_t key, size_t* page);
 
+bool PageTable_IsDirty(PageTable const* pt, uint16_t key);
+
+// cada modificacion le da a la pagina una version nueva, unica entre todas las paginas
 void PageTable_MarkDirty(PageTable const* pt, uint16_t key);
 
+// hasta maxPages paginas modificadas entre todas las tablas de pagina, de la modificada hace mas tiempo en adelante
+void PageTable_GetOldestDirtyFrames(size_t maxPages, Vector* dirtyFrames);
+
+// true si la pagina sigue modificada como en esa version (no se volvio a modificar ni se bajo al FS)
+bool PageTable_HasVersion(PageTable const* pt, uint16_t key, uint64_t version);
+
+// solo si sigue en esa version, si no la modificacion posterior todavia no esta en el FS
+void PageTable_MarkClean(PageTable const* pt, uint16_t key, uint64_t version);
+
+bool PageTable_HasDirtyPages(void);
+
 bool PageTable_PreemptPage(PageTable* pt, uint16_t key);
 
 void PageTable_Destruct(PageTable* pt);
@@ -0,0 +1,273 @@
+
+#include "Replacement.h"
+#include "ReplacementPolicy.h"
+#include <inttypes.h>
+#include <Logger.h>
+#include <Malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+static ReplacementPolicy const* const Policies[] =
+{
+    &LRUPolicy,
+    &ClockPolicy,
+    &TwoQPolicy,
+    &ARCPolicy
+};
+
+static ReplacementPolicy const* Policy = NULL;
+
+// las paginas de distintas tablas se acceden en paralelo pero las listas de la politica son una sola
+static pthread_mutex_t ReplacementLock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct
+{
+    // fuera del lock, se cuentan en cada busqueda
+    atomic_uint_fast64_t Hits;
+    atomic_uint_fast64_t Misses;
+
+    uint64_t Evictions;
+    uint64_t GhostHits;
+} Stats;
+
+// pagina del ultimo Admit, hasta que se inserte
+static struct
+{
+    bool Pending;
+    uint64_t Id;
+} Admitted;
+
+typedef struct Ghost
+{
+    ReplacementNode Node;
+    uint64_t Id;
+} Ghost;
+
+#define GHOST_INITIAL_SLOTS 64
+
+static inline size_t _ghostSlot(GhostList const* ghosts, uint64_t id)
+{
+    // las key de una tabla son consecutivas, mezclo los bits antes de quedarme con los bajos
+    uint64_t const h = id * UINT64_C(0x9E3779B97F4A7C15);
+    return (size_t) (h ^ h >> 32) & (ghosts->Capacity - 1);
+}
+
+// posicion del fantasma en el indice, o la libre donde iria
+static size_t _ghostFind(GhostList const* ghosts, uint64_t id)
+{
+    size_t i = _ghostSlot(ghosts, id);
+    while (ghosts->Slots[i] && ghosts->Slots[i]->Id != id)
+        i = (i + 1) & (ghosts->Capacity - 1);
+    return i;
+}
+
+static void _ghostGrow(GhostList* ghosts)
+{
+    Ghost** const slots = ghosts->Slots;
+    size_t const capacity = ghosts->Capacity;
+
+    ghosts->Capacity *= 2;
+    ghosts->Slots = Calloc(ghosts->Capacity, sizeof(Ghost*));
+    for (size_t i = 0; i < capacity; ++i)
+        if (slots[i])
+            ghosts->Slots[_ghostFind(ghosts, slots[i]->Id)] = slots[i];
+
+    Free(slots);
+}
+
+static void _ghostErase(GhostList* ghosts, size_t i)
+{
+    // sin lapidas: corro hacia atras los que siguen, asi una busqueda sigue cortando en el primer hueco
+    size_t const mask = ghosts->Capacity - 1;
+    for (size_t j = (i + 1) & mask; ghosts->Slots[j]; j = (j + 1) & mask)
+    {
+        // el de j puede pasar a i si su posicion ideal no esta entre i (excluida) y j
+        size_t const k = _ghostSlot(ghosts, ghosts->Slots[j]->Id);
+        if (i < j ? (k <= i || k > j) : (k <= i && k > j))
+        {
+            ghosts->Slots[i] = ghosts->Slots[j];
+            i = j;
+        }
+    }
+
+    ghosts->Slots[i] = NULL;
+}
+
+void Replacement_Initialize(char const* policyName, size_t numFrames)
+{
+    for (size_t i = 0; i < sizeof Policies / sizeof *Policies; ++i)
+    {
+        if (!strcmp(policyName, Policies[i]->Name))
+        {
+            Policy = Policies[i];
+            break;
+        }
+    }
+
+    if (!Policy)
+    {
+        LISSANDRA_LOG_FATAL("Algoritmo de reemplazo invalido: %s (LRU, CLOCK, 2Q o ARC)", policyName);
+        exit(EXIT_FAILURE);
+    }
+
+    atomic_init(&Stats.Hits, 0);
+    atomic_init(&Stats.Misses, 0);
+    Stats.Evictions = 0;
+    Stats.GhostHits = 0;
+    Policy->Initialize(numFrames);
+
+    LISSANDRA_LOG_INFO("Memoria: algoritmo de reemplazo %s", Policy->Name);
+}
+
+void Replacement_Admit(uint32_t tableId, uint16_t key)
+{
+    uint64_t const id = (uint64_t) tableId << 16 | key;
+
+    pthread_mutex_lock(&ReplacementLock);
+
+    Admitted.Pending = true;
+    Admitted.Id = id;
+
+    if (Policy->Admit(id))
+        ++Stats.GhostHits;
+
+    pthread_mutex_unlock(&ReplacementLock);
+}
+
+void Replacement_Insert(ReplacementNode* node)
+{
+    pthread_mutex_lock(&ReplacementLock);
+
+    // si el Admit no termino en una pagina nueva (memoria llena) otra pagina no hereda su estado
+    bool const admitted = Admitted.Pending && ReplacementNode_Id(node) == Admitted.Id;
+    if (admitted)
+        Admitted.Pending = false;
+
+    node->Referenced = false;
+    Policy->Insert(node, admitted);
+
+    pthread_mutex_unlock(&ReplacementLock);
+}
+
+void Replacement_Access(ReplacementNode* node)
+{
+    pthread_mutex_lock(&ReplacementLock);
+    if (node->List != REPLACEMENT_NONE)
+        Policy->Access(node);
+    pthread_mutex_unlock(&ReplacementLock);
+}
+
+void Replacement_Remove(ReplacementNode* node)
+{
+    pthread_mutex_lock(&ReplacementLock);
+    if (node->List != REPLACEMENT_NONE)
+        Policy->Remove(node);
+    pthread_mutex_unlock(&ReplacementLock);
+}
+
+ReplacementNode* Replacement_Victim(void)
+{
+    pthread_mutex_lock(&ReplacementLock);
+    ReplacementNode* const node = Policy->Victim();
+    if (node)
+        ++Stats.Evictions;
+    pthread_mutex_unlock(&ReplacementLock);
+    return node;
+}
+
+void Replacement_RecordLookup(bool hit)
+{
+    atomic_fetch_add_explicit(hit ? &Stats.Hits : &Stats.Misses, 1, memory_order_relaxed);
+}
+
+void Replacement_Report(void)
+{
+    uint64_t const hits = atomic_load_explicit(&Stats.Hits, memory_order_relaxed);
+    uint64_t const misses = atomic_load_explicit(&Stats.Misses, memory_order_relaxed);
+    uint64_t const lookups = hits + misses;
+
+    pthread_mutex_lock(&ReplacementLock);
+
+    LISSANDRA_LOG_INFO("REEMPLAZO (%s): %" PRIu64 " aciertos, %" PRIu64 " fallos (%.1f%% aciertos), %" PRIu64
+                       " desalojos, %" PRIu64 " fantasmas reincorporados", Policy->Name, hits, misses,
+                       lookups ? 100.0 * hits / lookups : 0.0, Stats.Evictions, Stats.GhostHits);
+
+    if (Policy->Report)
+        Policy->Report();
+
+    pthread_mutex_unlock(&ReplacementLock);
+}
+
+void Replacement_Destroy(void)
+{
+    Policy->Destroy();
+    Policy = NULL;
+}
+
+void GhostList_Construct(GhostList* ghosts)
+{
+    memset(&ghosts->List, 0, sizeof ghosts->List);
+    ghosts->Capacity = GHOST_INITIAL_SLOTS;
+    ghosts->Slots = Calloc(ghosts->Capacity, sizeof(Ghost*));
+}
+
+void GhostList_Add(GhostList* ghosts, uint64_t id)
+{
+    // ya estaba (no deberia): la renuevo
+    size_t const i = _ghostFind(ghosts, id);
+    Ghost* g = ghosts->Slots[i];
+    if (g)
+    {
+        ReplacementList_Unlink(&ghosts->List, &g->Node);
+        ReplacementList_PushBack(&ghosts->List, &g->Node, 1);
+        return;
+    }
+
+    g = Malloc(sizeof(Ghost));
+    g->Id = id;
+    ReplacementList_PushBack(&ghosts->List, &g->Node, 1);
+
+    if (2 * ghosts->List.Size > ghosts->Capacity)
+        _ghostGrow(ghosts);
+    ghosts->Slots[_ghostFind(ghosts, id)] = g;
+}
+
+bool GhostList_Take(GhostList* ghosts, uint64_t id)
+{
+    if (!ghosts->List.Size)
+        return false;
+
+    size_t const i = _ghostFind(ghosts, id);
+    Ghost* const g = ghosts->Slots[i];
+    if (!g)
+        return false;
+
+    _ghostErase(ghosts, i);
+    ReplacementList_Unlink(&ghosts->List, &g->Node);
+    Free(g);
+    return true;
+}
+
+void GhostList_PopOldest(GhostList* ghosts)
+{
+    ReplacementNode* const node = ReplacementList_PopFront(&ghosts->List);
+    if (!node)
+        return;
+
+    Ghost* const g = REPLACEMENT_CONTAINER(node, Ghost, Node);
+    _ghostErase(ghosts, _ghostFind(ghosts, g->Id));
+    Free(g);
+}
+
+void GhostList_Destruct(GhostList* ghosts)
+{
+    ReplacementNode* node;
+    while ((node = ReplacementList_PopFront(&ghosts->List)))
+        Free(REPLACEMENT_CONTAINER(node, Ghost, Node));
+
+    Free(ghosts->Slots);
+    ghosts->Slots = NULL;
+    ghosts->Capacity = 0;
+}
@@ -0,0 +1,60 @@
+
+#ifndef Replacement_h__
+#define Replacement_h__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Politica de reemplazo de paginas, elegida con ALGORITMO_REEMPLAZO en memoria.conf: LRU (por defecto), CLOCK,
+ * 2Q o ARC. Solo las paginas limpias estan en la politica, una modificada no se puede desalojar hasta el JOURNAL.
+ * Todas las operaciones son O(1) y toman un lock propio, se pueden llamar desde cualquier hilo.
+ */
+
+#define REPLACEMENT_NONE 0
+
+// nodo intrusivo, va dentro de cada pagina
+typedef struct ReplacementNode
+{
+    struct ReplacementNode* Prev;
+    struct ReplacementNode* Next;
+
+    // lista de la politica en la que esta, REPLACEMENT_NONE si en ninguna
+    uint8_t List;
+
+    // bit de referencia (CLOCK)
+    bool Referenced;
+
+    // identidad de la pagina, para recordarla despues de desalojada (2Q, ARC)
+    uint32_t TableId;
+    uint16_t Key;
+} ReplacementNode;
+
+#define REPLACEMENT_CONTAINER(ptr, type, member) ((type*) ((char*) (ptr) - offsetof(type, member)))
+
+void Replacement_Initialize(char const* policyName, size_t numFrames);
+
+// antes de asignar un marco a una pagina nueva
+void Replacement_Admit(uint32_t tableId, uint16_t key);
+
+// la pagina nueva ya tiene marco, o una modificada volvio a estar limpia
+void Replacement_Insert(ReplacementNode* node);
+
+// acierto sobre una pagina
+void Replacement_Access(ReplacementNode* node);
+
+// la pagina sale de la politica sin desalojo: se modifico, se borro o se limpio la memoria
+void Replacement_Remove(ReplacementNode* node);
+
+// elige y quita la pagina a desalojar. NULL si no hay ninguna limpia
+ReplacementNode* Replacement_Victim(void);
+
+// resultado de buscar una pagina para un SELECT
+void Replacement_RecordLookup(bool hit);
+
+void Replacement_Report(void);
+
+void Replacement_Destroy(void);
+
+#endif //Replacement_h__
@@ -0,0 +1,103 @@
+
+#include "ReplacementPolicy.h"
+#include <Logger.h>
+
+// 2Q (Johnson y Shasha): una pagina nueva entra a A1in (FIFO), si se la vuelve a pedir despues de desalojada
+// (esta en A1out) pasa a Am (LRU). Un scan solo recorre A1in y no desplaza a las paginas de Am
+enum
+{
+    Q_A1IN = 1,
+    Q_AM
+};
+
+static ReplacementList A1in;
+static ReplacementList Am;
+static GhostList A1out;
+
+// tamaños objetivo: A1in un cuarto de los marcos, A1out recuerda la mitad
+static size_t Kin = 1;
+static size_t Kout = 1;
+
+// la pagina a insertar estaba en A1out
+static bool Pending = false;
+
+static inline ReplacementList* _list(ReplacementNode const* node)
+{
+    return node->List == Q_A1IN ? &A1in : &Am;
+}
+
+static void _initialize(size_t numFrames)
+{
+    Kin = numFrames / 4 ? numFrames / 4 : 1;
+    Kout = numFrames / 2 ? numFrames / 2 : 1;
+    GhostList_Construct(&A1out);
+}
+
+static bool _admit(uint64_t id)
+{
+    Pending = GhostList_Take(&A1out, id);
+    return Pending;
+}
+
+static void _insert(ReplacementNode* node, bool admitted)
+{
+    if (admitted && Pending)
+        ReplacementList_PushBack(&Am, node, Q_AM);
+    else
+        ReplacementList_PushBack(&A1in, node, Q_A1IN);
+
+    Pending = false;
+}
+
+static void _access(ReplacementNode* node)
+{
+    // en A1in no se mueve: los accesos seguidos a una pagina nueva cuentan como uno solo
+    if (node->List != Q_AM)
+        return;
+
+    ReplacementList_Unlink(&Am, node);
+    ReplacementList_PushBack(&Am, node, Q_AM);
+}
+
+static void _remove(ReplacementNode* node)
+{
+    ReplacementList_Unlink(_list(node), node);
+}
+
+static ReplacementNode* _victim(void)
+{
+    if (A1in.Size && (A1in.Size > Kin || !Am.Size))
+    {
+        ReplacementNode* const node = ReplacementList_PopFront(&A1in);
+        GhostList_Add(&A1out, ReplacementNode_Id(node));
+        if (A1out.List.Size > Kout)
+            GhostList_PopOldest(&A1out);
+        return node;
+    }
+
+    return ReplacementList_PopFront(&Am);
+}
+
+static void _report(void)
+{
+    LISSANDRA_LOG_INFO("REEMPLAZO (2Q): A1in %zu/%zu, Am %zu, A1out %zu/%zu", A1in.Size, Kin, Am.Size,
+                       A1out.List.Size, Kout);
+}
+
+static void _destroy(void)
+{
+    GhostList_Destruct(&A1out);
+}
+
+ReplacementPolicy const TwoQPolicy =
+{
+    .Name = "2Q",
+    .Initialize = _initialize,
+    .Admit = _admit,
+    .Insert = _insert,
+    .Access = _access,
+    .Remove = _remove,
+    .Victim = _victim,
+    .Report = _report,
+    .Destroy = _destroy
+};
@@ -0,0 +1,133 @@
+
+#include "ReplacementPolicy.h"
+#include <Logger.h>
+
+// ARC (Megiddo y Modha): T1 tiene las paginas vistas una sola vez, T2 las vistas mas de una. B1 y B2 recuerdan
+// las desalojadas de cada una. Un acierto en B1 agranda el objetivo P de T1, uno en B2 lo achica
+enum
+{
+    ARC_T1 = 1,
+    ARC_T2
+};
+
+enum
+{
+    PENDING_NONE,
+    PENDING_B1,
+    PENDING_B2
+};
+
+static ReplacementList T1;
+static ReplacementList T2;
+static GhostList B1;
+static GhostList B2;
+
+static size_t C = 1;
+static size_t P = 0;
+
+// en que lista fantasma estaba la pagina a insertar
+static uint8_t Pending = PENDING_NONE;
+
+static inline ReplacementList* _list(ReplacementNode const* node)
+{
+    return node->List == ARC_T1 ? &T1 : &T2;
+}
+
+static void _initialize(size_t numFrames)
+{
+    C = numFrames;
+    P = 0;
+    GhostList_Construct(&B1);
+    GhostList_Construct(&B2);
+}
+
+static bool _admit(uint64_t id)
+{
+    size_t const b1 = B1.List.Size;
+    size_t const b2 = B2.List.Size;
+
+    Pending = PENDING_NONE;
+    if (GhostList_Take(&B1, id))
+    {
+        size_t const delta = b1 >= b2 ? 1 : b2 / b1;
+        P = P + delta < C ? P + delta : C;
+        Pending = PENDING_B1;
+        return true;
+    }
+
+    if (GhostList_Take(&B2, id))
+    {
+        size_t const delta = b2 >= b1 ? 1 : b1 / b2;
+        P = P > delta ? P - delta : 0;
+        Pending = PENDING_B2;
+        return true;
+    }
+
+    // pagina nueva: mantengo |T1| + |B1| <= C y el total <= 2C
+    if (T1.Size + B1.List.Size >= C)
+    {
+        if (B1.List.Size)
+            GhostList_PopOldest(&B1);
+    }
+    else if (T1.Size + T2.Size + B1.List.Size + B2.List.Size >= 2 * C && B2.List.Size)
+        GhostList_PopOldest(&B2);
+
+    return false;
+}
+
+static void _insert(ReplacementNode* node, bool admitted)
+{
+    if (admitted && Pending != PENDING_NONE)
+        ReplacementList_PushBack(&T2, node, ARC_T2);
+    else
+        ReplacementList_PushBack(&T1, node, ARC_T1);
+
+    Pending = PENDING_NONE;
+}
+
+static void _access(ReplacementNode* node)
+{
+    ReplacementList_Unlink(_list(node), node);
+    ReplacementList_PushBack(&T2, node, ARC_T2);
+}
+
+static void _remove(ReplacementNode* node)
+{
+    ReplacementList_Unlink(_list(node), node);
+}
+
+static ReplacementNode* _victim(void)
+{
+    bool const fromT1 = T1.Size && (T1.Size > P || (Pending == PENDING_B2 && T1.Size == P) || !T2.Size);
+
+    ReplacementNode* const node = ReplacementList_PopFront(fromT1 ? &T1 : &T2);
+    if (node)
+        GhostList_Add(fromT1 ? &B1 : &B2, ReplacementNode_Id(node));
+
+    return node;
+}
+
+static void _report(void)
+{
+    LISSANDRA_LOG_INFO("REEMPLAZO (ARC): T1 %zu, T2 %zu, B1 %zu, B2 %zu, objetivo de T1 %zu/%zu", T1.Size, T2.Size,
+                       B1.List.Size, B2.List.Size, P, C);
+}
+
+static void _destroy(void)
+{
+    GhostList_Destruct(&B2);
+    GhostList_Destruct(&B1);
+}
+
+ReplacementPolicy const ARCPolicy =
+{
+    .Name = "ARC",
+    .Initialize = _initialize,
+    .Admit = _admit,
+    .Insert = _insert,
+    .Access = _access,
+    .Remove = _remove,
+    .Victim = _victim,
+    .Report = _report,
+    .Destroy = _destroy
+};
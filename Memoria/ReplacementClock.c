@@ -0,0 +1,75 @@
+
+#include "ReplacementPolicy.h"
+#include <inttypes.h>
+#include <Logger.h>
+
+// CLOCK (segunda oportunidad): un acierto solo prende el bit de referencia, sin mover la pagina
+// la cabeza de la lista hace de aguja: si la pagina fue referenciada se le apaga el bit y pasa al final
+#define CLOCK_LIST 1
+
+static ReplacementList List;
+static uint64_t SecondChances = 0;
+
+static void _initialize(size_t numFrames)
+{
+    (void) numFrames;
+}
+
+static bool _admit(uint64_t id)
+{
+    (void) id;
+    return false;
+}
+
+static void _insert(ReplacementNode* node, bool admitted)
+{
+    (void) admitted;
+
+    ReplacementList_PushBack(&List, node, CLOCK_LIST);
+}
+
+static void _access(ReplacementNode* node)
+{
+    node->Referenced = true;
+}
+
+static void _remove(ReplacementNode* node)
+{
+    ReplacementList_Unlink(&List, node);
+}
+
+static ReplacementNode* _victim(void)
+{
+    // a lo sumo una vuelta apagando bits
+    ReplacementNode* node;
+    while ((node = ReplacementList_PopFront(&List)) && node->Referenced)
+    {
+        node->Referenced = false;
+        ReplacementList_PushBack(&List, node, CLOCK_LIST);
+        ++SecondChances;
+    }
+
+    return node;
+}
+
+static void _report(void)
+{
+    LISSANDRA_LOG_INFO("REEMPLAZO (CLOCK): %zu paginas, %" PRIu64 " segundas oportunidades", List.Size, SecondChances);
+}
+
+static void _destroy(void)
+{
+}
+
+ReplacementPolicy const ClockPolicy =
+{
+    .Name = "CLOCK",
+    .Initialize = _initialize,
+    .Admit = _admit,
+    .Insert = _insert,
+    .Access = _access,
+    .Remove = _remove,
+    .Victim = _victim,
+    .Report = _report,
+    .Destroy = _destroy
+};
@@ -0,0 +1,58 @@
+
+#include "ReplacementPolicy.h"
+
+// LRU exacto: una sola lista, cada acierto mueve la pagina al final
+#define LRU_LIST 1
+
+static ReplacementList List;
+
+static void _initialize(size_t numFrames)
+{
+    (void) numFrames;
+}
+
+static bool _admit(uint64_t id)
+{
+    (void) id;
+    return false;
+}
+
+static void _insert(ReplacementNode* node, bool admitted)
+{
+    (void) admitted;
+
+    ReplacementList_PushBack(&List, node, LRU_LIST);
+}
+
+static void _access(ReplacementNode* node)
+{
+    ReplacementList_Unlink(&List, node);
+    ReplacementList_PushBack(&List, node, LRU_LIST);
+}
+
+static void _remove(ReplacementNode* node)
+{
+    ReplacementList_Unlink(&List, node);
+}
+
+static ReplacementNode* _victim(void)
+{
+    return ReplacementList_PopFront(&List);
+}
+
+static void _destroy(void)
+{
+}
+
+ReplacementPolicy const LRUPolicy =
+{
+    .Name = "LRU",
+    .Initialize = _initialize,
+    .Admit = _admit,
+    .Insert = _insert,
+    .Access = _access,
+    .Remove = _remove,
+    .Victim = _victim,
+    .Report = NULL,
+    .Destroy = _destroy
+};
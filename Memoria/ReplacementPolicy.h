@@ -0,0 +1,110 @@
+
+#ifndef ReplacementPolicy_h__
+#define ReplacementPolicy_h__
+
+#include "Replacement.h"
+
+// interfaz que implementa cada politica, ver Replacement.h
+typedef struct
+{
+    char const* Name;
+
+    void(*Initialize)(size_t numFrames);
+
+    // true si la pagina estaba en una lista fantasma (fue desalojada hace poco)
+    bool(*Admit)(uint64_t id);
+
+    // admitted: es la pagina del ultimo Admit (si estaba en una lista fantasma lo sabe la politica)
+    void(*Insert)(ReplacementNode* node, bool admitted);
+    void(*Access)(ReplacementNode* node);
+    void(*Remove)(ReplacementNode* node);
+    ReplacementNode*(*Victim)(void);
+
+    // estado propio de la politica
+    void(*Report)(void);
+
+    void(*Destroy)(void);
+} ReplacementPolicy;
+
+extern ReplacementPolicy const LRUPolicy;
+extern ReplacementPolicy const ClockPolicy;
+extern ReplacementPolicy const TwoQPolicy;
+extern ReplacementPolicy const ARCPolicy;
+
+// lista doblemente enlazada: la cabeza es la mas vieja, la cola la mas reciente
+typedef struct
+{
+    ReplacementNode* Head;
+    ReplacementNode* Tail;
+    size_t Size;
+} ReplacementList;
+
+static inline void ReplacementList_PushBack(ReplacementList* list, ReplacementNode* node, uint8_t id)
+{
+    node->List = id;
+    node->Prev = list->Tail;
+    node->Next = NULL;
+
+    if (list->Tail)
+        list->Tail->Next = node;
+    else
+        list->Head = node;
+
+    list->Tail = node;
+    ++list->Size;
+}
+
+static inline void ReplacementList_Unlink(ReplacementList* list, ReplacementNode* node)
+{
+    if (node->Prev)
+        node->Prev->Next = node->Next;
+    else
+        list->Head = node->Next;
+
+    if (node->Next)
+        node->Next->Prev = node->Prev;
+    else
+        list->Tail = node->Prev;
+
+    node->Prev = node->Next = NULL;
+    node->List = REPLACEMENT_NONE;
+    --list->Size;
+}
+
+static inline ReplacementNode* ReplacementList_PopFront(ReplacementList* list)
+{
+    ReplacementNode* const node = list->Head;
+    if (node)
+        ReplacementList_Unlink(list, node);
+    return node;
+}
+
+// identidad de una pagina en un entero: id de tabla y key
+static inline uint64_t ReplacementNode_Id(ReplacementNode const* node)
+{
+    return (uint64_t) node->TableId << 16 | node->Key;
+}
+
+// paginas desalojadas recientemente, solo su identidad, en orden de desalojo
+typedef struct
+{
+    ReplacementList List;
+
+    // indice por identidad: direccionamiento abierto con sondeo lineal, a lo sumo a la mitad
+    struct Ghost** Slots;
+    size_t Capacity;
+} GhostList;
+
+void GhostList_Construct(GhostList* ghosts);
+
+void GhostList_Add(GhostList* ghosts, uint64_t id);
+
+// la quita si esta. false si no estaba
+bool GhostList_Take(GhostList* ghosts, uint64_t id);
+
+// olvida la mas vieja
+void GhostList_PopOldest(GhostList* ghosts);
+
+void GhostList_Destruct(GhostList* ghosts);
+
+#endif //ReplacementPolicy_h__
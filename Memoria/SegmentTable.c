@@ -2,157 +2,156 @@
 #include "SegmentTable.h"
 #include "MainMemory.h"
 #include <libcommons/dictionary.h>
-#include <linux/limits.h>
 #include <Malloc.h>
-#include <stdio.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <string.h>
 
 typedef struct
 {
-    char Table[NAME_MAX];
+    uint32_t TableId;
     PageTable Pages;
 } Segment;
 
-static t_dictionary* SegmentTable = NULL;
-static char TablePath[PATH_MAX] = { 0 };
+// indexado por id de tabla, NULL si la tabla no tiene paginas en memoria
+static Segment** Segments = NULL;
+static size_t NumSegmentSlots = 0;
 
-static void _segmentDestroy(void* segment);
+// nombres internados: el id es la posicion en Names. No se liberan hasta el final, solo se internan tablas
+// confirmadas por el FS (o con un INSERT), que son pocas
+static t_dictionary* TableIds = NULL;
+static char** Names = NULL;
+static uint32_t NumNames = 0;
+static uint32_t NamesCapacity = 0;
+static pthread_rwlock_t NamesLock = PTHREAD_RWLOCK_INITIALIZER;
 
-typedef struct
-{
-    size_t* minCounter;
-    size_t* minFrame;
-    Segment** minPageSegment;
-} SLRUPageParameters;
-static void _saveLRUPage(char const* qualifiedPath, void* segment, void* param);
+static void _segmentDestroy(Segment* s);
 
-static inline void _printFullKey(char const* tableName, char* tablePathBuf)
+void SegmentTable_Initialize(void)
 {
-    snprintf(tablePathBuf, PATH_MAX, "%sTables/%s", TablePath, tableName);
+    TableIds = dictionary_create();
 }
 
-void SegmentTable_Initialize(char const* tablePath)
+uint32_t SegmentTable_GetTableId(char const* tableName)
 {
-    SegmentTable = dictionary_create();
+    pthread_rwlock_rdlock(&NamesLock);
+    uint32_t* id = dictionary_get(TableIds, tableName);
+    pthread_rwlock_unlock(&NamesLock);
+    if (id)
+        return *id;
+
+    // primera vez que se nombra, otro hilo pudo haberla agregado entretanto
+    pthread_rwlock_wrlock(&NamesLock);
+    id = dictionary_get(TableIds, tableName);
+    if (!id)
+    {
+        if (NumNames == NamesCapacity)
+        {
+            NamesCapacity = NamesCapacity ? NamesCapacity * 2 : 16;
+            Names = Realloc(Names, NamesCapacity * sizeof(char*));
+        }
+
+        size_t const len = strlen(tableName) + 1;
+        Names[NumNames] = Malloc(len);
+        memcpy(Names[NumNames], tableName, len);
+
+        id = Malloc(sizeof(uint32_t));
+        *id = NumNames++;
+        dictionary_put(TableIds, tableName, id);
+    }
 
-    snprintf(TablePath, PATH_MAX, "%s", tablePath);
+    uint32_t const tableId = *id;
+    pthread_rwlock_unlock(&NamesLock);
+    return tableId;
 }
 
-PageTable* SegmentTable_CreateSegment(char const* tableName)
+bool SegmentTable_FindTableId(char const* tableName, uint32_t* tableId)
 {
-    Segment* s = Malloc(sizeof(Segment));
-    snprintf(s->Table, NAME_MAX, "%s", tableName);
-    PageTable_Construct(&s->Pages);
-
-    char qualifiedPath[PATH_MAX];
-    _printFullKey(tableName, qualifiedPath);
-    dictionary_put(SegmentTable, qualifiedPath, s);
-
-    return &s->Pages;
+    pthread_rwlock_rdlock(&NamesLock);
+    uint32_t const* const id = dictionary_get(TableIds, tableName);
+    if (id)
+        *tableId = *id;
+    pthread_rwlock_unlock(&NamesLock);
+    return id != NULL;
 }
 
-PageTable* SegmentTable_GetPageTable(char const* tableName)
+char const* SegmentTable_GetTableName(uint32_t tableId)
 {
-    char qualifiedPath[PATH_MAX];
-    _printFullKey(tableName, qualifiedPath);
-
-    Segment* s = dictionary_get(SegmentTable, qualifiedPath);
-    if (!s)
-        return NULL;
-
-    return &s->Pages;
+    pthread_rwlock_rdlock(&NamesLock);
+    char const* const name = Names[tableId];
+    pthread_rwlock_unlock(&NamesLock);
+    return name;
 }
 
-bool SegmentTable_GetLRUFrame(size_t* frame)
+PageTable* SegmentTable_CreateSegment(uint32_t tableId)
 {
-    if (dictionary_is_empty(SegmentTable))
-        return false;
-
-    // entre los segmentos busco la pagina con menor timestamp
-    size_t minCounter = 0;
-    size_t minFrame = 0;
-    Segment* minPageSegment = NULL;
-
-    SLRUPageParameters p =
-    {
-        .minCounter = &minCounter,
-        .minFrame = &minFrame,
-        .minPageSegment = &minPageSegment
-    };
-    dictionary_iterator_with_data(SegmentTable, _saveLRUPage, &p);
-
-    if (!minPageSegment)
-        return false;
-
-    *frame = minFrame;
-
-    Frame* f = Memory_Read(minFrame);
-    if (PageTable_PreemptPage(&minPageSegment->Pages, f->Key))
+    if (tableId >= NumSegmentSlots)
     {
-        // era la ultima pagina de este segmento, borrarlo
-        char qualifiedPath[PATH_MAX];
-        _printFullKey(minPageSegment->Table, qualifiedPath);
-
-        dictionary_remove_and_destroy(SegmentTable, qualifiedPath, _segmentDestroy);
+        size_t const numSlots = tableId < 8 ? 16 : 2 * tableId;
+        Segments = Realloc(Segments, numSlots * sizeof(Segment*));
+        memset(Segments + NumSegmentSlots, 0, (numSlots - NumSegmentSlots) * sizeof(Segment*));
+        NumSegmentSlots = numSlots;
     }
 
-    return true;
+    Segment* s = Malloc(sizeof(Segment));
+    s->TableId = tableId;
+    PageTable_Construct(&s->Pages, tableId);
+    Segments[tableId] = s;
+
+    return &s->Pages;
 }
 
-static void _getDirtyFrames(char const* qualifiedPath, void* segment, void* vec)
+PageTable* SegmentTable_GetPageTable(uint32_t tableId)
 {
-    (void) qualifiedPath;
+    if (tableId >= NumSegmentSlots || !Segments[tableId])
+        return NULL;
 
-    Segment* const s = segment;
-    PageTable_GetDirtyFrames(&s->Pages, s->Table, vec);
+    return &Segments[tableId]->Pages;
 }
 
-void SegmentTable_GetDirtyFrames(Vector* dirtyFrames)
+bool SegmentTable_GetVictimFrame(size_t* frame)
 {
-    dictionary_iterator_with_data(SegmentTable, _getDirtyFrames, dirtyFrames);
+    PageTable* pt;
+    uint16_t key;
+    if (!PageTable_GetVictimPage(&pt, &key, frame))
+        return false;
+
+    // era la ultima pagina de este segmento, borrarlo
+    if (PageTable_PreemptPage(pt, key))
+        SegmentTable_DeleteSegment(pt->TableId);
+
+    return true;
 }
 
-void SegmentTable_DeleteSegment(char const* tableName)
+void SegmentTable_DeleteSegment(uint32_t tableId)
 {
-    char qualifiedPath[PATH_MAX];
-    _printFullKey(tableName, qualifiedPath);
+    if (tableId >= NumSegmentSlots || !Segments[tableId])
+        return;
 
-    dictionary_remove_and_destroy(SegmentTable, qualifiedPath, _segmentDestroy);
+    _segmentDestroy(Segments[tableId]);
+    Segments[tableId] = NULL;
 }
 
 void SegmentTable_Clean(void)
 {
-    dictionary_clean_and_destroy_elements(SegmentTable, _segmentDestroy);
+    for (size_t i = 0; i < NumSegmentSlots; ++i)
+        SegmentTable_DeleteSegment(i);
 }
 
 void SegmentTable_Destroy(void)
 {
-    dictionary_destroy_and_destroy_elements(SegmentTable, _segmentDestroy);
+    SegmentTable_Clean();
+    Free(Segments);
+
+    dictionary_destroy_and_destroy_elements(TableIds, Free);
+    for (uint32_t i = 0; i < NumNames; ++i)
+        Free(Names[i]);
+    Free(Names);
 }
 
 /* PRIVATE */
-static void _segmentDestroy(void* segment)
+static void _segmentDestroy(Segment* s)
 {
-    Segment* const s = segment;
     PageTable_Destruct(&s->Pages);
     Free(s);
 }
-
-static void _saveLRUPage(char const* qualifiedPath, void* segment, void* param)
-{
-    (void) qualifiedPath;
-
-    Segment* const s = segment;
-
-    size_t lruFrame;
-    size_t timestamp;
-    bool hasLRU = PageTable_GetLRUFrame(&s->Pages, &lruFrame, &timestamp);
-
-    SLRUPageParameters* const p = param;
-    if (hasLRU && (!*p->minPageSegment || timestamp < *p->minCounter))
-    {
-        *p->minCounter = timestamp;
-        *p->minFrame = lruFrame;
-        *p->minPageSegment = s;
-    }
-}
@@ -4,17 +4,31 @@
 
 #include "PageTable.h"
 
-void SegmentTable_Initialize(char const* tablePath);
+/*
+ * Cada tabla se identifica con un id chico, y los segmentos se buscan por id en un arreglo. El nombre se resuelve
+ * una sola vez por pedido, el resto de la memoria trabaja con el id. Los ids no se liberan: solo se asignan a tablas
+ * que el FS confirmo o a las que se escribio, no a cualquier nombre que mande un cliente.
+ *
+ * Los segmentos se crean, borran y buscan con la memoria tomada (MainMemory). Los nombres tienen un lock propio.
+ */
 
-PageTable* SegmentTable_CreateSegment(char const* tableName);
+void SegmentTable_Initialize(void);
 
-PageTable* SegmentTable_GetPageTable(char const* tableName);
+// id de la tabla, si es la primera vez que se nombra se le asigna uno nuevo
+uint32_t SegmentTable_GetTableId(char const* tableName);
 
-bool SegmentTable_GetLRUFrame(size_t* frame);
+// id de la tabla sin asignarle uno. false si todavia no tiene
+bool SegmentTable_FindTableId(char const* tableName, uint32_t* tableId);
 
-void SegmentTable_GetDirtyFrames(Vector* dirtyFrames);
+char const* SegmentTable_GetTableName(uint32_t tableId);
 
-void SegmentTable_DeleteSegment(char const* tableName);
+PageTable* SegmentTable_CreateSegment(uint32_t tableId);
+
+PageTable* SegmentTable_GetPageTable(uint32_t tableId);
+
+bool SegmentTable_GetVictimFrame(size_t* frame);
+
+void SegmentTable_DeleteSegment(uint32_t tableId);
 
 void SegmentTable_Clean(void);
 
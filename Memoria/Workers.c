@@ -0,0 +1,202 @@
+
+#include "Workers.h"
+#include "Config.h"
+#include "Handlers.h"
+#include <Console.h>
+#include <EventDispatcher.h>
+#include <libcommons/queue.h>
+#include <Logger.h>
+#include <Malloc.h>
+#include <Opcodes.h>
+#include <Packet.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <Socket.h>
+
+typedef struct
+{
+    // NULL en las tareas propias
+    Socket* Client;
+    Packet* Request;
+
+    void(*Task)(void);
+} Job;
+
+typedef struct
+{
+    char const* Name;
+
+    t_queue* Jobs;
+    pthread_mutex_t Lock;
+    pthread_cond_t Cond;
+
+    size_t NumThreads;
+    pthread_t* Threads;
+} WorkQueue;
+
+static WorkQueue MemoryQueue = { .Name = "memoria" };
+static WorkQueue FileSystemQueue = { .Name = "FS" };
+
+static atomic_bool Stopping = false;
+
+static void _startQueue(WorkQueue* wq, uint32_t numThreads);
+static void _stopQueue(WorkQueue* wq);
+static void _push(WorkQueue* wq, Job* job);
+static void* _workerThread(void* queue);
+static void _destroyJob(void* job);
+
+void Workers_Initialize(void)
+{
+    _startQueue(&MemoryQueue, ConfigMemoria.HILOS_MEMORIA);
+    _startQueue(&FileSystemQueue, ConfigMemoria.HILOS_FS);
+}
+
+bool Workers_ReadRequest(void* socket)
+{
+    Socket* const s = socket;
+
+    Packet* p = Socket_RecvPacket(s);
+    if (!p)
+        return false;
+
+    uint16_t const opc = Packet_GetOpcode(p);
+    if (opc >= NUM_HANDLED_OPCODES || !OpcodeTable[opc])
+    {
+        LISSANDRA_LOG_DEBUG("Workers_ReadRequest: recibido paquete no soportado! (cmd: %hu)", opc);
+        Packet_Destroy(p);
+        return false;
+    }
+
+    // el handshake solo toca la tabla de gossip, lo respondo aca
+    if (opc == MSG_HANDSHAKE)
+    {
+        OpcodeTable[opc](s, p);
+        Packet_Destroy(p);
+        return true;
+    }
+
+    // hasta responder no leo mas de este cliente, y el dispatcher no lo destruye si se desconecta
+    EventDispatcher_SuspendFDI(s);
+
+    Job* job = Malloc(sizeof(Job));
+    job->Client = s;
+    job->Request = p;
+    job->Task = NULL;
+
+    _push(CachedOpcodeTable[opc] ? &MemoryQueue : &FileSystemQueue, job);
+    return true;
+}
+
+void Workers_AddTask(void(*task)(void))
+{
+    Job* job = Malloc(sizeof(Job));
+    job->Client = NULL;
+    job->Request = NULL;
+    job->Task = task;
+
+    _push(&FileSystemQueue, job);
+}
+
+void Workers_Terminate(void)
+{
+    _stopQueue(&MemoryQueue);
+    _stopQueue(&FileSystemQueue);
+}
+
+/* PRIVATE */
+static void _startQueue(WorkQueue* wq, uint32_t numThreads)
+{
+    wq->Jobs = queue_create();
+    pthread_mutex_init(&wq->Lock, NULL);
+    pthread_cond_init(&wq->Cond, NULL);
+
+    wq->NumThreads = numThreads ? numThreads : 1;
+    wq->Threads = Malloc(wq->NumThreads * sizeof(pthread_t));
+    for (size_t i = 0; i < wq->NumThreads; ++i)
+        pthread_create(wq->Threads + i, NULL, _workerThread, wq);
+
+    LISSANDRA_LOG_TRACE("WORKERS: %zu hilos de %s", wq->NumThreads, wq->Name);
+}
+
+static void _stopQueue(WorkQueue* wq)
+{
+    pthread_mutex_lock(&wq->Lock);
+    Stopping = true;
+    pthread_cond_broadcast(&wq->Cond);
+    pthread_mutex_unlock(&wq->Lock);
+
+    for (size_t i = 0; i < wq->NumThreads; ++i)
+        pthread_join(wq->Threads[i], NULL);
+
+    // los clientes de lo que quedo en la cola los destruye el dispatcher
+    queue_destroy_and_destroy_elements(wq->Jobs, _destroyJob);
+    pthread_cond_destroy(&wq->Cond);
+    pthread_mutex_destroy(&wq->Lock);
+    Free(wq->Threads);
+}
+
+static void _push(WorkQueue* wq, Job* job)
+{
+    pthread_mutex_lock(&wq->Lock);
+    queue_push(wq->Jobs, job);
+    pthread_cond_signal(&wq->Cond);
+    pthread_mutex_unlock(&wq->Lock);
+}
+
+static void _run(WorkQueue* wq, Job* job)
+{
+    if (job->Task)
+    {
+        job->Task();
+        Free(job);
+        return;
+    }
+
+    uint16_t const opc = Packet_GetOpcode(job->Request);
+    if (wq == &MemoryQueue)
+    {
+        if (!CachedOpcodeTable[opc](job->Client, job->Request))
+        {
+            // fallo o memoria llena, lo sigue un hilo del FS
+            Packet_Rewind(job->Request);
+            _push(&FileSystemQueue, job);
+            return;
+        }
+    }
+    else
+        OpcodeTable[opc](job->Client, job->Request);
+
+    EventDispatcher_ResumeFDI(job->Client);
+
+    Packet_Destroy(job->Request);
+    Free(job);
+}
+
+static void* _workerThread(void* queue)
+{
+    WorkQueue* const wq = queue;
+
+    while (true)
+    {
+        Job* job = NULL;
+        pthread_mutex_lock(&wq->Lock);
+        while (!Stopping && !(job = queue_pop(wq->Jobs)))
+            pthread_cond_wait(&wq->Cond, &wq->Lock);
+        pthread_mutex_unlock(&wq->Lock);
+
+        if (!job)
+            break;
+
+        _run(wq, job);
+    }
+
+    return NULL;
+}
+
+static void _destroyJob(void* job)
+{
+    Job* const j = job;
+    if (j->Request)
+        Packet_Destroy(j->Request);
+    Free(j);
+}
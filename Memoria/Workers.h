@@ -0,0 +1,26 @@
+
+#ifndef Workers_h__
+#define Workers_h__
+
+#include <stdbool.h>
+
+/*
+ * Los pedidos del kernel y de otras memorias se atienden en dos grupos de hilos. HILOS_MEMORIA atienden lo que
+ * se resuelve solo con la memoria (SELECT que aciertan, INSERT con lugar) y HILOS_FS todo lo que espera al FS,
+ * asi un acierto nunca queda en la cola detras de un fallo. Un SELECT que falla o un INSERT con la memoria llena
+ * pasan de un grupo al otro.
+ *
+ * Mientras se atiende un pedido no se lee nada mas de ese cliente: las respuestas salen en el orden de los pedidos.
+ */
+
+void Workers_Initialize(void);
+
+// callback de lectura de los sockets de los clientes
+bool Workers_ReadRequest(void* socket);
+
+// tarea propia de la memoria (journal, write-back) para los hilos del FS
+void Workers_AddTask(void(*task)(void));
+
+void Workers_Terminate(void);
+
+#endif //Workers_h__
@@ -115,6 +115,12 @@ static inline void Packet_Clear(Packet* p)
     p->wpos = 0;
 }
 
+// vuelve a leer el paquete desde el principio
+static inline void Packet_Rewind(Packet* p)
+{
+    p->rpos = 0;
+}
+
 /*
  * Packet_Append: inserta el valor X en el buffer
  */
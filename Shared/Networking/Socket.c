@@ -127,7 +127,7 @@ Packet* Socket_RecvPacket(Socket* s)
     header.size = EndianConvert(header.size);
     header.cmd = EndianConvert(header.cmd);
 
-    if (header.size >= 10240 || header.cmd >= NUM_OPCODES)
+    if (header.size >= SOCKET_MAX_PACKET_SIZE || header.cmd >= NUM_OPCODES)
     {
         LISSANDRA_LOG_DEBUG("_readHeaderHandler(): Cliente %s ha enviado paquete no válido (tam: %hu, opc: %u)",
                             s->Address.HostIP, header.size, header.cmd);
@@ -11,6 +11,9 @@
 typedef struct Socket Socket;
 typedef struct Packet Packet;
 
+// tamaño maximo del contenido de un paquete, los de este tamaño o mas se rechazan al recibir
+#define SOCKET_MAX_PACKET_SIZE 10240
+
 typedef void SocketAcceptFn(Socket* s, Socket* client);
 
 typedef struct Socket
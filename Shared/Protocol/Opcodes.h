@@ -47,6 +47,7 @@ enum
                       * uint8: tipo consistencia (ver Consistency.h)           \
                       * uint16: numero particiones                             \
                       * uint32: tiempo entre compactaciones, en milisegundos   \
+                      * uint32: TTL de los registros en milisegundos, 0 sin TTL\
                       */                                                       \
                                                                                \
     OPC(LQL_DESCRIBE) /* char* OPCIONAL: nombre tabla                          \
@@ -56,6 +57,28 @@ enum
                                                                                \
     OPC(LQL_DROP)     /* char*: nombre tabla */                                \
                                                                                \
+    OPC(LQL_DELETE)   /* char*: nombre tabla                                   \
+                       * uint16: key                                           \
+                       * uint64: timestamp (de K->M no posee)                  \
+                       *                                                       \
+                       * Responde: MSG_DELETE_RESPUESTA                        \
+                       */                                                      \
+                                                                               \
+    OPC(LQL_INSERT_BATCH) /* varios INSERT con timestamp agrupados por tabla   \
+                           * (journal de memoria al FS)                        \
+                           *                                                   \
+                           * uint16: cantidad de tablas                        \
+                           * por cada una:                                     \
+                           *   char*: nombre tabla                             \
+                           *   uint32: cantidad de registros                   \
+                           *   por cada uno:                                   \
+                           *     uint16: key                                   \
+                           *     char*: value                                  \
+                           *     uint64: timestamp                             \
+                           *                                                   \
+                           * Responde: MSG_INSERT_BATCH_RESPUESTA              \
+                           */                                                  \
+                                                                               \
     /* Mensajes a memoria */                                                   \
     OPC(LQL_JOURNAL)        /* nada */                                         \
 
@@ -70,6 +93,8 @@ enum
                        * uint8: tipo de consistencia (ver Consistency.h)       \
                        * uint16: numero de particiones                         \
                        * uint32: tiempo entre compactaciones, en milisegundos  \
+                       * uint32: TTL en milisegundos, 0 sin TTL                \
+                       * uint64: registros expirados descartados al compactar  \
                        */                                                      \
                                                                                \
     OPC(MSG_DESCRIBE_GLOBAL) /* uint32: cantidad de tablas                     \
@@ -90,6 +115,14 @@ enum
     OPC(MSG_INSERT_RESPUESTA)   /* uint8: EXIT_SUCCESS o EXIT_FAILURE          \
                                  */                                            \
                                                                                \
+    OPC(MSG_INSERT_BATCH_RESPUESTA) /* uint16: cantidad de tablas              \
+                                     * por cada una, en el orden del pedido:   \
+                                     * uint8: EXIT_SUCCESS o EXIT_FAILURE      \
+                                     */                                        \
+                                                                               \
+    OPC(MSG_DELETE_RESPUESTA)   /* uint8: EXIT_SUCCESS o EXIT_FAILURE          \
+                                 */                                            \
+                                                                               \
     /* erores */                                                               \
     OPC(MSG_ERR_VALUE_TOO_LONG) /* valor demasiado largo */                    \
                                                                                \
@@ -103,6 +136,9 @@ enum
     OPC(MSG_ERR_TABLE_NOT_EXISTS) /* tabla no existe                           \
                                    */                                          \
                                                                                \
+    OPC(MSG_ERR_FS_UNAVAILABLE) /* la memoria no pudo comunicarse con el FS    \
+                                 */                                            \
+                                                                               \
     /* gossiping */                                                            \
     OPC(MSG_GOSSIP_LIST)  /* uint32: cantidad de entradas                      \
                            *                                                   \
@@ -64,6 +64,29 @@ void EventDispatcher_RemoveFDI(void* interface)
     hashmap_remove_and_destroy(sDispatcher._fdiMap, fdi->Handle, FDI_Destroy);
 }
 
+void EventDispatcher_SuspendFDI(void* interface)
+{
+    // sigue en el mapa: ni un error ni un cierre del fd lo destruyen mientras esta suspendido
+    FDI* fdi = interface;
+
+    static struct epoll_event dummy;
+    if (epoll_ctl(sDispatcher.Handle, EPOLL_CTL_DEL, fdi->Handle, &dummy) < 0)
+        LISSANDRA_LOG_SYSERROR("epoll_ctl DEL");
+}
+
+void EventDispatcher_ResumeFDI(void* interface)
+{
+    FDI* fdi = interface;
+
+    struct epoll_event evt =
+    {
+        .events = EPOLLIN,
+        .data = { .ptr = interface }
+    };
+    if (epoll_ctl(sDispatcher.Handle, EPOLL_CTL_ADD, fdi->Handle, &evt) < 0)
+        LISSANDRA_LOG_SYSERROR("epoll_ctl ADD");
+}
+
 void EventDispatcher_Dispatch(void)
 {
     int res = epoll_wait(sDispatcher.Handle, sDispatcher._events, PER_LOOP_FDS, -1);
@@ -20,6 +20,16 @@ void EventDispatcher_AddFDI(void* interface);
  */
 void EventDispatcher_RemoveFDI(void* interface);
 
+/*
+ * Deja de escuchar los eventos de un item sin destruirlo, por ejemplo mientras otro hilo lo usa
+ */
+void EventDispatcher_SuspendFDI(void* interface);
+
+/*
+ * Vuelve a escuchar los eventos de un item suspendido, puede llamarse desde cualquier hilo
+ */
+void EventDispatcher_ResumeFDI(void* interface);
+
 /*
  * Chequea la existencia de eventos, en cuyo caso invoca los callback correspondientes
  */
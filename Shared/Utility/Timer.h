@@ -67,6 +67,14 @@ static inline uint64_t GetMSTime(void)
     return TimeSpecToMS(&ts);
 }
 
+// monotonic tick in nanoseconds, for measuring short intervals
+static inline uint64_t GetNSTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 // sleep for some ms
 static inline void MSSleep(uint32_t ms)
 {
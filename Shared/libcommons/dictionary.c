@@ -101,7 +101,7 @@ void* dictionary_get(t_dictionary* self, char const* key)
     return element != NULL ? element->data : NULL;
 }
 
-void* dictionary_remove(t_dictionary* self, char* key)
+void* dictionary_remove(t_dictionary* self, char const* key)
 {
     void* data = dictionary_remove_element(self, key);
     if (data != NULL)
@@ -61,7 +61,7 @@ void* dictionary_get(t_dictionary*, char const* key);
 * @NAME: dictionary_remove
 * @DESC: Remueve un elemento del diccionario y lo retorna.
 */
-void* dictionary_remove(t_dictionary*, char* key);
+void* dictionary_remove(t_dictionary*, char const* key);
 
 /**
 * @NAME: dictionary_remove_and_destroy